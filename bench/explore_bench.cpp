@@ -0,0 +1,385 @@
+/**
+ * @file explore_bench.cpp
+ * @brief Benchmark of the exploration stages on synthetic trees.
+ *
+ * This program generates synthetic directory trees (deep, wide, many tiny files, a few huge
+ * files, and a mix of text and binary files), then times every stage of the exploration on each
+ * of them: `FileManager::getAllFiles`, `FileManager::isTextMimeType`, `FileReader::readFile`,
+ * `Outputs::convertToHex` and `Outputs::displayFileContent`, followed by the whole pipeline of
+ * `FileExplorer::explore` with the default number of threads and with a single thread.
+ *
+ * The trees are generated from a fixed seed, so two runs at the same scale work on identical
+ * content. The results are written as JSON, to compare releases and execution modes; a short
+ * summary is printed on the standard error stream. The output of the display stages is sent to
+ * `/dev/null`.
+ *
+ * Usage: explore_bench [--scale X] [--output FILE] [--keep] [--tree NAME] [DIRECTORY]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <getopt.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+#include "globals.h"
+#include "FileExplorer.h"
+#include "FileManager.h"
+#include "FileReader.h"
+#include "FileTable.h"
+#include "HexEncoder.h"
+#include "OutputWriter.h"
+#include "Outputs.h"
+#include "ThreadPool.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+/**
+ * @struct Generator
+ * @brief Writes deterministic text and binary files.
+ */
+struct Generator {
+    std::mt19937_64 random{42}; ///< Fixed seed: the same scale always gives the same trees.
+
+    /**
+     * @brief Writes a file of `size` bytes of text made of words and lines.
+     */
+    void writeText(const fs::path& path, std::size_t size) {
+        static const char* words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+                                      "adipiscing", "elit", "sed", "do", "eiusmod", "tempor"};
+        std::string content;
+        content.reserve(size);
+        std::size_t column = 0;
+        while (content.size() < size) {
+            const char* word = words[random() % (sizeof(words) / sizeof(words[0]))];
+            content += word;
+            column += std::char_traits<char>::length(word) + 1;
+            if (column > 72) {
+                content += '\n';
+                column = 0;
+            } else {
+                content += ' ';
+            }
+        }
+        content.resize(size);
+        write(path, content);
+    }
+
+    /**
+     * @brief Writes a file of `size` random bytes, which libmagic reports as binary.
+     */
+    void writeBinary(const fs::path& path, std::size_t size) {
+        std::string content(size, '\0');
+        for (char& byte : content) {
+            byte = static_cast<char>(random());
+        }
+        // Make sure the content cannot be mistaken for text
+        if (size > 0) {
+            content[0] = '\0';
+        }
+        write(path, content);
+    }
+
+    /**
+     * @brief Returns a size in `[min, max]`.
+     */
+    std::size_t size(std::size_t min, std::size_t max) {
+        return min + random() % (max - min + 1);
+    }
+
+private:
+    static void write(const fs::path& path, const std::string& content) {
+        std::ofstream file(path, std::ios::binary);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+};
+
+/**
+ * @brief Scales a count, keeping at least one element.
+ */
+std::size_t scaled(double scale, std::size_t count) {
+    return std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(count) * scale));
+}
+
+/**
+ * @brief A chain of nested directories, with a few small files at every level.
+ */
+void generateDeep(Generator& generator, const fs::path& root, double scale) {
+    fs::path directory = root;
+    for (std::size_t level = 0; level < scaled(scale, 64); ++level) {
+        directory /= "level" + std::to_string(level);
+        fs::create_directories(directory);
+        generator.writeText(directory / "notes.txt", generator.size(512, 4096));
+        generator.writeText(directory / "readme", generator.size(512, 4096));
+    }
+}
+
+/**
+ * @brief A single directory holding thousands of files.
+ */
+void generateWide(Generator& generator, const fs::path& root, double scale) {
+    fs::create_directories(root);
+    for (std::size_t i = 0; i < scaled(scale, 4000); ++i) {
+        generator.writeText(root / ("file" + std::to_string(i) + ".txt"), generator.size(256, 2048));
+    }
+}
+
+/**
+ * @brief Many directories of very small files, where per-file costs dominate.
+ */
+void generateTiny(Generator& generator, const fs::path& root, double scale) {
+    for (std::size_t d = 0; d < 40; ++d) {
+        fs::path directory = root / ("dir" + std::to_string(d));
+        fs::create_directories(directory);
+        for (std::size_t i = 0; i < scaled(scale, 250); ++i) {
+            generator.writeText(directory / ("f" + std::to_string(i)), generator.size(16, 200));
+        }
+    }
+}
+
+/**
+ * @brief A few files larger than the streaming threshold, text and binary.
+ */
+void generateHuge(Generator& generator, const fs::path& root, double scale) {
+    fs::create_directories(root);
+    std::size_t size = scaled(scale, 24) * 1024 * 1024;
+    generator.writeText(root / "huge1.log", size);
+    generator.writeText(root / "huge2.log", size);
+    generator.writeBinary(root / "huge1.dat", size);
+    generator.writeBinary(root / "huge2.dat", size);
+}
+
+/**
+ * @brief A realistic mix: text, binary content without extension, and known binary extensions.
+ */
+void generateMixed(Generator& generator, const fs::path& root, double scale) {
+    static const char* binaryExtensions[] = {".png", ".zip", ".so", ".jpg"};
+    for (std::size_t d = 0; d < 10; ++d) {
+        fs::path directory = root / ("src" + std::to_string(d));
+        fs::create_directories(directory);
+        for (std::size_t i = 0; i < scaled(scale, 200); ++i) {
+            std::size_t kind = generator.random() % 10;
+            std::string name = "item" + std::to_string(i);
+            std::size_t size = generator.size(1024, 64 * 1024);
+            if (kind < 5) {
+                generator.writeText(directory / (name + ".txt"), size);
+            } else if (kind < 8) {
+                generator.writeBinary(directory / (name + ".bin"), size);
+            } else {
+                generator.writeBinary(directory / (name + binaryExtensions[kind % 4]), size);
+            }
+        }
+    }
+}
+
+/**
+ * @struct Tree
+ * @brief A synthetic tree and the function generating it.
+ */
+struct Tree {
+    const char* name;
+    void (*generate)(Generator&, const fs::path&, double);
+};
+
+const Tree trees[] = {
+    {"deep", &generateDeep},
+    {"wide", &generateWide},
+    {"tiny", &generateTiny},
+    {"huge", &generateHuge},
+    {"mixed", &generateMixed},
+};
+
+/**
+ * @struct Stage
+ * @brief The measurements of one stage on one tree.
+ */
+struct Stage {
+    const char* name;
+    double seconds;
+    std::uint64_t files;
+    std::uint64_t bytes;
+};
+
+/**
+ * @brief Runs a function and returns its duration in seconds.
+ */
+double timed(const std::function<void()>& function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/**
+ * @brief Times every stage of the exploration on a tree.
+ */
+std::vector<Stage> benchmarkTree(const fs::path& root) {
+    std::vector<Stage> stages;
+    Configuration::showBinaryFiles = true;
+    Configuration::showHiddenFiles = true;
+    FileManager fileManager(root.string());
+
+    // Traversal only: every file is kept, so nothing is classified
+    FileTable files(root.string());
+    double seconds = timed([&] { files = fileManager.getAllFiles(); });
+    stages.push_back({"getAllFiles", seconds, files.size(), 0});
+    std::fprintf(stderr, "file table: %zu files in %zu bytes\n", files.size(), files.memoryUsage());
+
+    std::string path;
+    std::uint64_t textFiles = 0;
+    seconds = timed([&] {
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            files.path(i, path);
+            textFiles += fileManager.isTextMimeType(path) ? 1 : 0;
+        }
+    });
+    stages.push_back({"isTextMimeType", seconds, files.size(), 0});
+
+    std::vector<std::string> contents(files.size());
+    std::uint64_t bytes = 0;
+    seconds = timed([&] {
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            files.path(i, path);
+            contents[i] = FileReader::readFile(path);
+            bytes += contents[i].size();
+        }
+    });
+    stages.push_back({"readFile", seconds, files.size(), bytes});
+
+    seconds = timed([&] {
+        for (const std::string& content : contents) {
+            std::string hexContent = Outputs::convertToHex(content);
+        }
+    });
+    stages.push_back({"convertToHex", seconds, files.size(), bytes});
+
+    seconds = timed([&] {
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            files.relativePath(i, path);
+            Outputs::displayFileContent(path, contents[i]);
+        }
+        OutputWriter::standardOutput().flush();
+    });
+    stages.push_back({"displayFileContent", seconds, files.size(), bytes});
+    contents.clear();
+
+    // The whole pipeline, with the default number of threads and with a single thread
+    for (unsigned threads : {0u, 1u}) {
+        Configuration::threadCount = threads;
+        seconds = timed([&] {
+            FileExplorer explorer(root.string());
+            explorer.explore();
+            OutputWriter::standardOutput().flush();
+        });
+        stages.push_back({threads == 0 ? "explore" : "exploreSingleThread", seconds, files.size(), bytes});
+    }
+    Configuration::threadCount = 0;
+    return stages;
+}
+
+void printUsage() {
+    std::fprintf(stderr, "Usage: explore_bench [--scale X] [--output FILE] [--keep] [--tree NAME] [DIRECTORY]\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    double scale = 1.0;
+    std::string outputPath;
+    std::string onlyTree;
+    bool keep = false;
+
+    const struct option longOptions[] = {
+        {"scale", required_argument, nullptr, 's'},
+        {"output", required_argument, nullptr, 'o'},
+        {"keep", no_argument, nullptr, 'k'},
+        {"tree", required_argument, nullptr, 't'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "s:o:kt:", longOptions, nullptr)) != -1) {
+        switch (option) {
+            case 's':
+                scale = std::strtod(optarg, nullptr);
+                if (scale <= 0) {
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'o':
+                outputPath = optarg;
+                break;
+            case 'k':
+                keep = true;
+                break;
+            case 't':
+                onlyTree = optarg;
+                break;
+            default:
+                printUsage();
+                return 1;
+        }
+    }
+    fs::path workDirectory = optind < argc ? fs::path(argv[optind]) : fs::temp_directory_path() / "mavu-bench";
+    bool created = !fs::exists(workDirectory);
+
+    // The display stages write to the standard output: send it to /dev/null
+    std::FILE* results = outputPath.empty() ? fdopen(dup(STDOUT_FILENO), "w") : std::fopen(outputPath.c_str(), "w");
+    if (results == nullptr) {
+        std::perror("explore_bench: cannot open the output");
+        return 1;
+    }
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    std::fprintf(results, "{\n  \"version\": \"%s\",\n  \"scale\": %g,\n  \"threads\": %u,\n  \"hexKernel\": \"%s\",\n  \"trees\": [",
+                 SOFTWARE_VERSION, scale, ThreadPool::resolveThreadCount(0), HexEncoder::kernelName());
+    bool firstTree = true;
+    for (const Tree& tree : trees) {
+        if (!onlyTree.empty() && onlyTree != tree.name) {
+            continue;
+        }
+
+        // Reuse a tree left by a previous run with --keep
+        fs::path root = workDirectory / tree.name;
+        if (!fs::exists(root)) {
+            Generator generator;
+            std::fprintf(stderr, "generating %s...\n", tree.name);
+            tree.generate(generator, root, scale);
+        }
+
+        std::vector<Stage> stages = benchmarkTree(root);
+        std::fprintf(results, "%s\n    {\n      \"name\": \"%s\",\n      \"stages\": {", firstTree ? "" : ",", tree.name);
+        firstTree = false;
+        for (std::size_t i = 0; i < stages.size(); ++i) {
+            const Stage& stage = stages[i];
+            std::fprintf(results, "%s\n        \"%s\": {\"seconds\": %.6f, \"files\": %llu, \"bytes\": %llu}",
+                         i == 0 ? "" : ",", stage.name, stage.seconds,
+                         static_cast<unsigned long long>(stage.files), static_cast<unsigned long long>(stage.bytes));
+            std::fprintf(stderr, "%-6s %-20s %10.3f ms %8llu files %8.1f MB/s\n", tree.name, stage.name,
+                         stage.seconds * 1e3, static_cast<unsigned long long>(stage.files),
+                         stage.bytes > 0 ? static_cast<double>(stage.bytes) / stage.seconds / 1e6 : 0.0);
+        }
+        std::fprintf(results, "\n      }\n    }");
+    }
+    std::fprintf(results, "\n  ]\n}\n");
+    std::fclose(results);
+
+    if (created && !keep) {
+        std::error_code error;
+        fs::remove_all(workDirectory, error);
+    }
+    return 0;
+}
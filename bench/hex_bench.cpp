@@ -0,0 +1,168 @@
+/**
+ * @file hex_bench.cpp
+ * @brief Microbenchmark of the hexadecimal encoders.
+ *
+ * This program compares the `HexEncoder` kernels with the former `std::ostringstream` based
+ * implementation of `Outputs::convertToHex`. Every kernel is first checked against the former
+ * implementation, then timed on the same random buffer; the throughput is reported in input
+ * bytes per second. The `HexDumper` kernels of `--hex-style=canonical` are checked against each
+ * other and timed the same way, on the random buffer and on a zero-filled one.
+ *
+ * Usage: hex_bench [size in MiB] (default: 64)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "HexDumper.h"
+#include "HexEncoder.h"
+
+namespace {
+
+/**
+ * @brief The former implementation of `Outputs::convertToHex`, kept as the reference.
+ */
+std::string legacyConvertToHex(std::string_view content) {
+    std::ostringstream hexStream;
+    hexStream << std::hex << std::setfill('0');
+    for (unsigned char c : content) {
+        hexStream << std::setw(2) << static_cast<int>(c) << ' ';
+    }
+    return hexStream.str();
+}
+
+/**
+ * @brief Runs a kernel several times over the input and returns the best time in seconds.
+ */
+double bestTime(HexEncoder::Kernel kernel, std::string_view input, std::string& output, int runs) {
+    double best = 1e30;
+    for (int run = 0; run < runs; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        kernel(input, output.data());
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+/**
+ * @brief Runs a canonical dump kernel several times over the input and returns the best time in seconds.
+ */
+double bestDumpTime(HexDumper::Kernel kernel, std::string_view input, std::string& output, int runs) {
+    double best = 1e30;
+    for (int run = 0; run < runs; ++run) {
+        HexDumper dumper;
+        auto start = std::chrono::steady_clock::now();
+        kernel(dumper, input.data(), input.size() / HexDumper::rowSize, output.data());
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void report(const char* name, std::size_t bytes, double seconds) {
+    std::printf("%-10s %10.3f ms %10.2f GB/s\n", name, seconds * 1e3, static_cast<double>(bytes) / seconds / 1e9);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t mebibytes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 64;
+    std::size_t size = std::max<std::size_t>(mebibytes, 1) * 1024 * 1024;
+
+    std::string input(size, '\0');
+    std::mt19937_64 random(42);
+    for (char& byte : input) {
+        byte = static_cast<char>(random());
+    }
+
+    struct Candidate {
+        const char* name;
+        HexEncoder::Kernel kernel;
+    };
+    std::vector<Candidate> candidates = {{"scalar", &HexEncoder::encodeScalar}};
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        candidates.push_back({"ssse3", &HexEncoder::encodeSsse3});
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        candidates.push_back({"avx2", &HexEncoder::encodeAvx2});
+    }
+#endif
+
+    // Check every kernel against the reference, including the scalar tails
+    std::string output(HexEncoder::encodedSize(size), '\0');
+    for (std::size_t length : {std::size_t{0}, std::size_t{1}, std::size_t{15}, std::size_t{16}, std::size_t{33},
+                               std::size_t{100}, std::size_t{4099}}) {
+        std::string_view sample(input.data(), length);
+        std::string expected = legacyConvertToHex(sample);
+        for (const auto& candidate : candidates) {
+            candidate.kernel(sample, output.data());
+            if (std::string_view(output.data(), expected.size()) != expected) {
+                std::fprintf(stderr, "hex_bench: %s kernel output differs for %zu bytes\n", candidate.name, length);
+                return 1;
+            }
+        }
+    }
+
+    std::printf("input: %zu MiB, dispatch: %s\n", size / (1024 * 1024), HexEncoder::kernelName());
+
+    // The reference implementation is much slower; time it on a smaller slice
+    std::string_view slice(input.data(), std::min<std::size_t>(size, 8 * 1024 * 1024));
+    auto start = std::chrono::steady_clock::now();
+    std::string legacy = legacyConvertToHex(slice);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    report("ostream", slice.size(), elapsed.count());
+
+    for (const auto& candidate : candidates) {
+        report(candidate.name, size, bestTime(candidate.kernel, input, output, 5));
+    }
+
+    struct DumpCandidate {
+        const char* name;
+        HexDumper::Kernel kernel;
+    };
+    std::vector<DumpCandidate> dumpCandidates = {{"scalar", &HexDumper::dumpScalar}};
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("ssse3")) {
+        dumpCandidates.push_back({"ssse3", &HexDumper::dumpSsse3});
+    }
+#endif
+
+    // Check the dump kernels against the scalar one, on rows with repeats
+    std::string zeros(size, '\0');
+    std::string mixed = input.substr(0, 4096) + zeros.substr(0, 4096) + input.substr(0, 64) + input.substr(0, 64);
+    std::string dump(size / HexDumper::rowSize * HexDumper::maxLineSize, '\0');
+    std::string expected(dump.size(), '\0');
+    for (std::string_view sample : {std::string_view(input.data(), 4096), std::string_view(zeros.data(), 4096),
+                                    std::string_view(mixed)}) {
+        std::size_t rowCount = sample.size() / HexDumper::rowSize;
+        HexDumper reference;
+        std::size_t expectedSize = HexDumper::dumpScalar(reference, sample.data(), rowCount, expected.data()) - expected.data();
+        for (const auto& candidate : dumpCandidates) {
+            HexDumper dumper;
+            std::size_t dumpSize = candidate.kernel(dumper, sample.data(), rowCount, dump.data()) - dump.data();
+            if (std::string_view(dump.data(), dumpSize) != std::string_view(expected.data(), expectedSize)) {
+                std::fprintf(stderr, "hex_bench: %s dump kernel output differs for %zu bytes\n", candidate.name, sample.size());
+                return 1;
+            }
+        }
+    }
+
+    std::printf("canonical dump, dispatch: %s\n", HexDumper::kernelName());
+    for (const auto& candidate : dumpCandidates) {
+        std::string name = std::string(candidate.name) + "-rows";
+        report(name.c_str(), size, bestDumpTime(candidate.kernel, input, dump, 5));
+        name = std::string(candidate.name) + "-zeros";
+        report(name.c_str(), size, bestDumpTime(candidate.kernel, zeros, dump, 5));
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file Archive.h
+ * @brief This file contains the declaration of the Archive class.
+ *
+ * The Archive class implements the `--archives` option: it lists the members of tar archives,
+ * plain or compressed with gzip, xz or bzip2, and of zip archives, and reads their content on
+ * demand. The members of a plain tar archive are found by reading its headers and skipping the
+ * content between them, and the members of a zip archive are read from its central directory,
+ * so listing a large archive reads a small part of it. A member is displayed under the path of
+ * the archive followed by `!/` and its name, like `bundle.tar.gz!/etc/config.yml`.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "Decompressor.h"
+#include "FileReader.h"
+
+/**
+ * @class Archive
+ * @brief Lists the regular files of an archive, one after the other.
+ *
+ * A compressed tar archive can only be read from its start, so its listing decompresses it
+ * whole; the content of a member can then be kept on the way with `hold`, rather than being
+ * decompressed again later. The other archives are read at random, and their members are only
+ * read when they are displayed, through `openMember`.
+ */
+class Archive {
+public:
+    /**
+     * @enum Format
+     * @brief The archive formats explored by `--archives`.
+     */
+    enum class Format {
+        Tar, ///< POSIX ustar, with the GNU and pax extensions for long names and large sizes.
+        Zip, ///< zip, with the zip64 extensions, holding stored or deflated members.
+    };
+
+    /**
+     * @struct Member
+     * @brief A regular file of an archive, with what is needed to read it again.
+     */
+    struct Member {
+        std::string name;                            ///< The path of the member in the archive.
+        std::uint64_t size = 0;                      ///< The size of its content in bytes.
+        std::uint64_t offset = 0;                    ///< tar: the offset of the content in the decompressed archive; zip: the offset of the local header.
+        std::uint64_t packedSize = 0;                ///< zip: the size of the compressed content.
+        bool deflated = false;                       ///< zip: whether the content is compressed with deflate rather than stored.
+        unsigned method = 0;                         ///< zip: the compression method, to report the unsupported ones.
+        bool encrypted = false;                      ///< zip: whether the content is encrypted, and cannot be read.
+        Format format = Format::Tar;                 ///< The format of the archive.
+        Compression compression = Compression::None; ///< tar: the compression of the whole archive.
+    };
+
+    /**
+     * @brief Checks whether a file name ends with the extension of an archive explored by `--archives`.
+     *
+     * The extensions are `.tar`, `.tar.gz`, `.tgz`, `.tar.xz`, `.txz`, `.tar.bz2`, `.tbz2` and
+     * `.zip`, whatever their case.
+     *
+     * @param fileName The name of the file, without directories.
+     */
+    static bool hasArchiveExtension(std::string_view fileName);
+
+    /**
+     * @brief Returns the path under which a member of an archive is displayed: `archive!/name`.
+     */
+    static std::string memberPath(std::string_view archivePath, std::string_view name);
+
+    /**
+     * @brief Opens an archive and recognizes its format from its content.
+     *
+     * @param filePath The path of the archive.
+     * @throw std::filesystem::filesystem_error If the archive cannot be opened.
+     * @throw std::runtime_error If the file is not a tar or zip archive.
+     */
+    explicit Archive(const std::string& filePath);
+
+    /**
+     * @brief Closes the archive.
+     */
+    ~Archive();
+
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    /**
+     * @brief Finds the next regular file of the archive, in archive order.
+     *
+     * Directories, links and other special members are skipped.
+     *
+     * @param member Receives the member.
+     * @return `true` if a member was found, `false` at the end of the archive.
+     * @throw std::runtime_error If the archive is corrupt or truncated.
+     */
+    bool next(Member& member);
+
+    /**
+     * @brief Reads the content of the member found last, when the archive is read sequentially anyway.
+     *
+     * Only the members of compressed tar archives up to `maxHeldSize` bytes are read; the others
+     * are left to `openMember`.
+     *
+     * @param content Receives the content.
+     * @return `true` if the content was read.
+     * @throw std::runtime_error If the archive is corrupt or truncated.
+     */
+    bool hold(std::string& content);
+
+    /**
+     * @brief Opens the content of a member for reading, in chunks of at most `FileReader::chunkSize` bytes.
+     *
+     * @param archivePath The path of the archive.
+     * @param member The member, as found by `next`.
+     * @return The content of the member.
+     * @throw std::filesystem::filesystem_error If the archive cannot be opened.
+     * @throw std::runtime_error If the member cannot be read.
+     */
+    static std::unique_ptr<ChunkSource> openMember(const std::string& archivePath, const Member& member);
+
+    static constexpr std::size_t blockSize = 512;                            ///< The size of tar blocks.
+    static constexpr std::size_t maxHeldSize = FileReader::streamThreshold;  ///< Largest member content read by `hold`.
+
+private:
+    /**
+     * @brief Reads bytes of a tar archive at the current position.
+     *
+     * @param buffer Receives the bytes.
+     * @param size The number of bytes to read.
+     * @return The number of bytes read, less than `size` only at the end of the archive.
+     */
+    std::size_t read(char* buffer, std::size_t size);
+
+    /**
+     * @brief Skips bytes of a tar archive, decompressing them if needed.
+     *
+     * @param size The number of bytes to skip.
+     * @throw std::runtime_error If the archive ends before.
+     */
+    void skip(std::uint64_t size);
+
+    /**
+     * @brief Finds the next regular file of a tar archive.
+     */
+    bool nextTar(Member& member);
+
+    /**
+     * @brief Finds the next regular file in the central directory of a zip archive.
+     */
+    bool nextZip(Member& member);
+
+    /**
+     * @brief Reads the central directory of a zip archive.
+     *
+     * @throw std::runtime_error If the end of the central directory cannot be found.
+     */
+    void readCentralDirectory();
+
+    int fd = -1;                                ///< The archive, open for reading.
+    std::uint64_t fileSize = 0;                 ///< The size of the archive file.
+    Format format = Format::Tar;                ///< The format of the archive.
+    Compression compression = Compression::None; ///< tar: the compression of the whole archive.
+    std::unique_ptr<Decompressor> decompressor; ///< tar: the decompressed content of a compressed archive.
+    std::string_view pending;                   ///< tar: decompressed bytes not yet consumed.
+    std::uint64_t position = 0;                 ///< tar: the position in the (decompressed) archive.
+    std::uint64_t unread = 0;                   ///< tar: the bytes of the current member and its padding not yet consumed.
+    std::uint64_t memberSize = 0;               ///< tar: the size of the current member.
+    bool holdable = false;                      ///< tar: whether the content of the current member was not consumed yet.
+    std::string directory;                      ///< zip: the central directory.
+    std::size_t entry = 0;                      ///< zip: the offset of the next entry in `directory`.
+    std::uint64_t entriesLeft = 0;              ///< zip: the entries not yet listed.
+};
@@ -0,0 +1,90 @@
+/**
+ * @file BoundedQueue.h
+ * @brief This file contains the implementation of the BoundedQueue class template.
+ *
+ * The BoundedQueue class template is a first-in first-out queue shared between threads. Its
+ * capacity is fixed: producers block while it is full, consumers block while it is empty. It is
+ * used to connect the stages of the exploration pipeline while keeping memory use bounded.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/**
+ * @class BoundedQueue
+ * @brief A blocking FIFO queue with a fixed capacity.
+ *
+ * Once the queue is closed, `push` fails and `pop` drains the remaining items before failing.
+ *
+ * @tparam T The type of the queued items.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief Constructs an empty queue.
+     *
+     * @param capacity The maximum number of items held at once (at least 1).
+     */
+    explicit BoundedQueue(std::size_t capacity) : capacity(capacity == 0 ? 1 : capacity) {}
+
+    /**
+     * @brief Appends an item, waiting while the queue is full.
+     *
+     * @param item The item to append.
+     * @return `true` if the item was appended, `false` if the queue was closed.
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item, waiting while the queue is empty.
+     *
+     * @param item Receives the removed item.
+     * @return `true` if an item was removed, `false` if the queue is closed and empty.
+     */
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Closes the queue, waking up every waiting producer and consumer.
+     */
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    std::size_t capacity;             ///< The maximum number of queued items.
+    std::deque<T> items;              ///< The queued items, oldest first.
+    std::mutex mutex;                 ///< Guards `items` and `closed`.
+    std::condition_variable notFull;  ///< Signalled when an item is removed or the queue closes.
+    std::condition_variable notEmpty; ///< Signalled when an item is added or the queue closes.
+    bool closed = false;              ///< Set once `close` has been called.
+};
@@ -0,0 +1,141 @@
+/**
+ * @file ClassificationCache.h
+ * @brief This file contains the declaration of the ClassificationCache class.
+ *
+ * The ClassificationCache class remembers, from one run to the next, whether files hold text or
+ * binary content. Files are identified by their device, inode, size and modification time, so a
+ * file that has not changed since the previous run is not read nor handed to libmagic again.
+ *
+ * The cache is a single file, `$XDG_CACHE_HOME/mavu/classification.cache` by default. It starts
+ * with a sorted table of records, memory-mapped and binary-searched at startup, followed by a
+ * journal of records appended by later runs. When the journal grows too large, the whole file is
+ * compacted into a new sorted table. Once the table exceeds `maxRecords`, compaction only keeps
+ * the files seen during the run, so records of deleted files do not accumulate forever.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/stat.h>
+
+/**
+ * @class ClassificationCache
+ * @brief Persistent map from file identities to classification results.
+ *
+ * The cache is loaded once at startup with `load` and written back once at exit with `save`.
+ * In between, `lookup` and `store` may be called concurrently from any thread. Results are kept
+ * separately for each classifier mode, since the modes may disagree on some files. Until `load`
+ * succeeds the cache is disabled: lookups miss and stores are ignored.
+ */
+class ClassificationCache {
+public:
+    /**
+     * @struct Key
+     * @brief Identity of a file in a given state.
+     */
+    struct Key {
+        std::uint64_t device = 0; ///< The device holding the file.
+        std::uint64_t inode = 0;  ///< The inode number of the file.
+        std::uint64_t size = 0;   ///< The size of the file in bytes.
+        std::int64_t mtimeNs = 0; ///< The modification time in nanoseconds since the epoch.
+    };
+
+    /**
+     * @struct Statistics
+     * @brief Counters describing the use of the cache during the run.
+     */
+    struct Statistics {
+        std::uint64_t hits = 0;    ///< Lookups answered by the cache.
+        std::uint64_t misses = 0;  ///< Lookups of files unknown to the cache.
+        std::uint64_t stored = 0;  ///< New results recorded during the run.
+        bool compacted = false;    ///< Whether `save` rewrote the cache file.
+    };
+
+    /**
+     * @brief Loads the cache from the default cache file, creating its directory if needed.
+     *
+     * @return `true` if the cache is enabled, even if the file did not exist yet.
+     */
+    static bool load();
+
+    /**
+     * @brief Loads the cache from a file.
+     *
+     * A missing file gives an empty cache. A file written by another version of the format, or
+     * against another version of libmagic, is ignored and replaced when the cache is saved.
+     *
+     * @param cachePath The path of the cache file.
+     * @return `true` if the cache is enabled.
+     */
+    static bool load(const std::string& cachePath);
+
+    /**
+     * @brief Writes the results recorded during the run to the cache file.
+     *
+     * New records are appended to the journal of the file. If the journal has grown larger than
+     * half the sorted table, the file is compacted instead: the table and the journal are merged,
+     * outdated records of files that changed are dropped, and the result replaces the file
+     * atomically. If more than `maxRecords` records remain, only those looked up or stored during
+     * the run are kept. Errors are silently ignored: the cache is only an optimization.
+     */
+    static void save();
+
+    /**
+     * @brief Deletes the default cache file.
+     *
+     * @return `true` if there was no cache file or it was deleted.
+     */
+    static bool clear();
+
+    /**
+     * @brief Returns the path of the default cache file, or an empty string if unknown.
+     */
+    static std::string defaultPath();
+
+    /**
+     * @brief Computes the key of a file.
+     *
+     * Files whose modification time is very recent are not keyed: they may still be modified
+     * within the resolution of the timestamps, which would leave an outdated result in the cache.
+     *
+     * @param filePath The path of the file.
+     * @param key Receives the key of the file.
+     * @return `true` if the cache is enabled and `filePath` is a regular file that can be cached.
+     */
+    static bool keyOf(const std::string& filePath, Key& key);
+
+    /**
+     * @brief Computes the key of a file from its status, already read by the caller.
+     *
+     * @param info The status of the file.
+     * @param key Receives the key of the file.
+     * @return `true` if the cache is enabled and `info` describes a regular file that can be cached.
+     */
+    static bool keyOf(const struct stat& info, Key& key);
+
+    /**
+     * @brief Looks the result of a file up.
+     *
+     * @param key The key of the file.
+     * @param isText Receives whether the file is text, if the cache knows the file.
+     * @return `true` if the cache knows the file.
+     */
+    static bool lookup(const Key& key, bool& isText);
+
+    /**
+     * @brief Records the result of a file, to be written by `save`.
+     *
+     * @param key The key of the file.
+     * @param isText Whether the file is text.
+     */
+    static void store(const Key& key, bool isText);
+
+    /**
+     * @brief Returns the counters of the cache.
+     */
+    static Statistics statistics();
+
+    static constexpr std::int64_t racyWindowNs = 2'000'000'000; ///< Files modified this recently are not cached.
+    static constexpr std::size_t maxRecords = 1 << 20;          ///< Records kept by compaction before it drops the files not seen in the run.
+};
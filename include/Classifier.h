@@ -0,0 +1,104 @@
+/**
+ * @file Classifier.h
+ * @brief This file contains the declaration of the Classifier class.
+ *
+ * The Classifier class decides whether a file holds text or binary content. It wraps libmagic
+ * and keeps one loaded magic database per thread for the whole run, so the (expensive) database
+ * load happens once per worker instead of once per file.
+ *
+ * Before asking libmagic, the content can be sniffed in-process: a vectorized scan for NUL bytes,
+ * control characters and invalid UTF-8, plus magic-number checks for common binary formats,
+ * settles most files without libmagic. Only ambiguous content is handed over to libmagic.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+/**
+ * @class Classifier
+ * @brief Classifies file contents as text or binary.
+ *
+ * The `Classifier` class provides static methods backed by a thread-local libmagic cookie.
+ * The cookie is opened and loaded lazily the first time a thread classifies a file and is
+ * released when that thread exits. Callers never deal with libmagic directly.
+ */
+class Classifier {
+public:
+    /**
+     * @brief Checks if a file has a text MIME type.
+     *
+     * This static method asks libmagic for the MIME type of the file and reports whether it
+     * starts with `text/`. The libmagic database of the calling thread is reused between calls.
+     *
+     * @param filePath The path of the file to check.
+     * @return `true` if the file has a text MIME type, otherwise `false`.
+     */
+    static bool isText(const std::filesystem::path& filePath);
+
+    /**
+     * @brief Checks if a buffer holding the content of a file is text.
+     *
+     * This static method classifies content that has already been read or mapped, so the file
+     * does not need to be opened again. Depending on `Configuration::classifierMode`, the content
+     * is sniffed in-process, handed to libmagic, or sniffed first and handed to libmagic only when
+     * the sniffer cannot decide. At most `sniffLength` bytes are examined.
+     *
+     * @param content The content to check.
+     * @return `true` if the content is text, otherwise `false`.
+     */
+    static bool isTextContent(std::string_view content);
+
+    /**
+     * @brief Checks if a buffer has a text MIME type according to libmagic.
+     *
+     * Like libmagic does for files, only the first bytes of the buffer (up to the libmagic
+     * `bytes_max` parameter) are examined.
+     *
+     * @param content The content to check.
+     * @return `true` if the content has a text MIME type, otherwise `false`.
+     */
+    static bool isTextMagic(std::string_view content);
+
+    /**
+     * @brief The outcome of sniffing content in-process.
+     */
+    enum class Verdict {
+        Text,    ///< The content is text.
+        Binary,  ///< The content is binary.
+        Unknown, ///< The content needs a closer look (e.g. by libmagic).
+    };
+
+    /**
+     * @brief Sniffs the beginning of a buffer without libmagic.
+     *
+     * Content starting with the signature of a common binary format, or holding NUL bytes, is
+     * binary. Content made of printable characters, usual control characters and valid UTF-8 is
+     * text, unless it starts like one of the textual formats that libmagic does not report as
+     * `text/` (JSON, XML, PostScript, mail messages, scripts, ...). Anything else is unknown.
+     *
+     * @param content The content to sniff; only the first `sniffLength` bytes are examined.
+     * @return The verdict.
+     */
+    static Verdict sniff(std::string_view content);
+
+    /**
+     * @struct Statistics
+     * @brief How many classifications were decided by each path.
+     */
+    struct Statistics {
+        std::uint64_t sniffedText = 0;   ///< Decided as text by the sniffer.
+        std::uint64_t sniffedBinary = 0; ///< Decided as binary by the sniffer.
+        std::uint64_t magic = 0;         ///< Decided by libmagic.
+        std::uint64_t guessed = 0;       ///< Undecided by the sniffer, guessed in `fast` mode.
+    };
+
+    /**
+     * @brief Returns the classification counters, summed over all threads.
+     */
+    static Statistics statistics();
+
+    static constexpr std::size_t sniffLength = 1024 * 1024; ///< Bytes examined by the classifier.
+};
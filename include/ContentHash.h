@@ -0,0 +1,51 @@
+/**
+ * @file ContentHash.h
+ * @brief This file contains the declaration of the ContentHash class.
+ *
+ * The ContentHash class computes the 64-bit hash used by `--dedupe` to find files with the same
+ * content. It follows the structure of XXH3: eight 64-bit accumulators absorb 64-byte stripes with
+ * a 32x32-bit multiply per lane and are scrambled after every 1 KiB block. It provides a portable
+ * kernel and, on x86, an AVX2 kernel selected at runtime; both compute the same value.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @class ContentHash
+ * @brief Hashes file contents for deduplication.
+ *
+ * The hash is not cryptographic and its values are not stored anywhere: they only need to be the
+ * same for the same content within a run. Files are compared on their size and hash.
+ */
+class ContentHash {
+public:
+    /**
+     * @brief Signature shared by all hashing kernels.
+     */
+    using Kernel = std::uint64_t (*)(std::string_view input);
+
+    /**
+     * @brief Hashes the input with the fastest kernel supported by the CPU.
+     */
+    static std::uint64_t hash(std::string_view input);
+
+    /**
+     * @brief Returns the name of the kernel used by `hash` (`"avx2"` or `"scalar"`).
+     */
+    static const char* kernelName();
+
+    /**
+     * @brief Hashes the input with the portable kernel.
+     */
+    static std::uint64_t hashScalar(std::string_view input);
+
+#if defined(__x86_64__) || defined(__i386__)
+    /**
+     * @brief Hashes the input with the AVX2 kernel. The CPU must support AVX2.
+     */
+    static std::uint64_t hashAvx2(std::string_view input);
+#endif
+};
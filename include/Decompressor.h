@@ -0,0 +1,123 @@
+/**
+ * @file Decompressor.h
+ * @brief This file contains the declaration of the Decompressor class.
+ *
+ * The Decompressor class implements the `-z` option: it recognizes gzip, xz and bzip2 files by
+ * their magic number and decompresses them as a stream, chunk by chunk, with the zlib, liblzma
+ * and libbz2 libraries linked into the binary. Neither the compressed nor the decompressed
+ * content is ever held whole, so a large rotated log costs the same memory as a small one.
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "FileReader.h"
+
+/**
+ * @enum Compression
+ * @brief The compression formats decompressed by `-z`.
+ */
+enum class Compression {
+    None,  ///< Not a compressed file.
+    Gzip,  ///< gzip (RFC 1952), possibly several members in a row.
+    Xz,    ///< xz, possibly several streams in a row.
+    Bzip2, ///< bzip2, possibly several streams in a row.
+};
+
+/**
+ * @class Decompressor
+ * @brief Reads the decompressed content of a file sequentially, in bounded chunks.
+ *
+ * The compressed file is read with a `FileChunkReader`, and every call to `next` decompresses
+ * into the same output buffer, so the memory used does not depend on the size of the file.
+ * Concatenated members or streams, as produced by `cat a.gz b.gz`, are decompressed one after
+ * the other, like the command-line tools do.
+ */
+class Decompressor : public ChunkSource {
+public:
+    /**
+     * @brief Recognizes a compression format from the first bytes of a file.
+     *
+     * @param head The first bytes of the file, at least `magicLength` of them unless the file is shorter.
+     * @return The format of the file, or `Compression::None`.
+     */
+    static Compression detect(std::string_view head);
+
+    /**
+     * @brief Recognizes the compression format of a file by reading its first bytes.
+     *
+     * @param filePath The path of the file.
+     * @return The format of the file, or `Compression::None` if it is not compressed or cannot be read.
+     */
+    static Compression detectFile(const std::string& filePath);
+
+    /**
+     * @brief Checks whether a file name ends with the extension of a format decompressed by `-z`.
+     *
+     * Such files are not hidden by their binary extension with `-z`, since their decompressed
+     * content may be text.
+     *
+     * @param fileName The name of the file, without directories.
+     */
+    static bool hasCompressedExtension(std::string_view fileName);
+
+    /**
+     * @brief Opens a compressed file for decompression.
+     *
+     * @param filePath The path of the file.
+     * @param compression The format of the file, as returned by `detect`.
+     * @throw std::filesystem::filesystem_error If the file cannot be opened.
+     * @throw std::runtime_error If the decompressor cannot be initialized.
+     */
+    Decompressor(const std::string& filePath, Compression compression);
+
+    /**
+     * @brief Releases the decompressor and closes the file.
+     */
+    ~Decompressor() override;
+
+    Decompressor(const Decompressor&) = delete;
+    Decompressor& operator=(const Decompressor&) = delete;
+
+    /**
+     * @brief Decompresses the next chunk of the content.
+     *
+     * @param chunk Receives a view of at most `chunkSize` decompressed bytes, valid until the next call.
+     * @return `true` if a chunk was decompressed, `false` at the end of the content.
+     * @throw std::system_error If reading fails.
+     * @throw std::runtime_error If the compressed data is corrupt or truncated.
+     */
+    bool next(std::string_view& chunk) override;
+
+    static constexpr std::size_t magicLength = 6;                     ///< Bytes needed by `detect`.
+    static constexpr std::size_t chunkSize = FileReader::chunkSize;   ///< The size of the decompressed chunks.
+
+private:
+    struct Stream;
+
+    /**
+     * @brief Decompresses the available input into the output buffer, from `produced` bytes on.
+     *
+     * @param produced The bytes already in the output buffer.
+     * @return The bytes in the output buffer afterwards.
+     * @throw std::runtime_error If the compressed data is corrupt.
+     */
+    std::size_t inflate(std::size_t produced);
+
+    /**
+     * @brief Starts the next member or stream, if the input holds one after the end of the current one.
+     *
+     * @return `true` if a new member was started, `false` if the content ends.
+     */
+    bool restart();
+
+    Compression compression;        ///< The format of the file.
+    FileChunkReader reader;         ///< The reader of the compressed file.
+    std::string_view input;         ///< The compressed bytes read but not yet decompressed.
+    bool inputEnded = false;        ///< Whether the whole compressed file was read.
+    bool streamEnded = false;       ///< Whether the current member or stream ended.
+    std::unique_ptr<Stream> stream; ///< The state of the decompression library.
+    std::unique_ptr<char[]> output; ///< The output buffer, reused for every chunk.
+};
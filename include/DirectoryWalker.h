@@ -0,0 +1,216 @@
+/**
+ * @file DirectoryWalker.h
+ * @brief This file contains the declaration of the DirectoryWalker class.
+ *
+ * The DirectoryWalker class enumerates a directory tree concurrently on a `ThreadPool`. Every
+ * directory is read by one task with `readdir`, using the entry type it reports (`d_type`) to
+ * avoid a `stat` call per entry whenever possible. The entries of each directory are sorted by
+ * name, and the walker hands files back in depth-first order, so the result does not depend on
+ * the number of threads or on the order in which directories finish. Entries excluded by ignore
+ * files or by the `--exclude` globs are dropped while their directory is read, so ignored
+ * directories are never opened.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FileTable.h"
+#include "IgnoreRules.h"
+#include "ThreadPool.h"
+
+/**
+ * @class DirectoryWalker
+ * @brief Concurrent, deterministic directory traversal.
+ *
+ * Directories are enumerated in parallel as soon as they are discovered, while `next` returns
+ * the regular files in a fixed order: the entries of a directory in byte-wise name order, with
+ * the content of each subdirectory listed where the subdirectory appears. `next` blocks only
+ * when the next file in that order belongs to a directory that has not been read yet, so files
+ * can be consumed while the rest of the tree is still being enumerated.
+ */
+class DirectoryWalker {
+public:
+    /**
+     * @class Filter
+     * @brief Decides which entries of the walked directories are kept.
+     *
+     * The filter holds the settings that do not depend on the directory: whether hidden entries
+     * are skipped, whether ignore files are honoured, and the compiled `--exclude` and `--include`
+     * globs. It is immutable once built and can be shared by any number of threads.
+     */
+    class Filter {
+    public:
+        /**
+         * @brief Builds a filter.
+         *
+         * @param skipHidden Whether hidden entries (names starting with a dot) are skipped.
+         * @param applyFilters Whether the ignore files (unless `Configuration::useIgnoreFiles` is
+         *                     unset) and the `--exclude` and `--include` globs of the configuration
+         *                     filter the entries.
+         */
+        Filter(bool skipHidden, bool applyFilters);
+
+        /**
+         * @brief Checks whether an entry is filtered out by the ignore rules or the globs.
+         *
+         * @param rules The ignore rules in force in the directory of the entry, or `nullptr`.
+         * @param relativePath The path of the entry relative to the root.
+         * @param isDirectory Whether the entry is a directory.
+         * @return `true` if the entry must be dropped.
+         */
+        bool isFiltered(const IgnoreRules* rules, const std::string& relativePath, bool isDirectory) const;
+
+        /**
+         * @brief Checks whether any glob was given, so entries must be matched even without ignore rules.
+         */
+        bool hasGlobs() const { return excludes || includes; }
+
+        bool skipHidden;     ///< Whether hidden entries are skipped.
+        bool useIgnoreFiles; ///< Whether the ignore files found in the directories are honoured.
+        std::vector<std::string> skippedDirectories; ///< The relative paths of the directories not descended into, such as nested roots walked on their own.
+
+    private:
+        std::shared_ptr<const IgnoreRules> excludes; ///< The `--exclude` globs, or `nullptr`.
+        std::shared_ptr<const IgnoreRules> includes; ///< The `--include` globs, or `nullptr`.
+    };
+
+    /**
+     * @brief Called with the path, the path relative to the root and the ignore rules in force of
+     *        every directory read. It is called on the worker threads, possibly concurrently.
+     */
+    using DirectoryCallback = std::function<void(const std::string& path, const std::string& relativePath,
+                                                 const std::shared_ptr<const IgnoreRules>& rules)>;
+
+    /**
+     * @brief Constructs a DirectoryWalker and starts enumerating the given directory.
+     *
+     * @param pool The pool on which directories are enumerated. It must outlive the walker.
+     * @param rootPath The directory to walk.
+     * @param skipHidden Whether hidden entries (names starting with a dot) are skipped, in which
+     *                   case hidden directories are not descended into.
+     * @param applyFilters Whether the ignore files (unless `Configuration::useIgnoreFiles` is
+     *                     unset) and the `--exclude` and `--include` globs of the configuration
+     *                     filter the entries.
+     */
+    DirectoryWalker(ThreadPool& pool, const std::string& rootPath, bool skipHidden, bool applyFilters = false)
+        : DirectoryWalker(pool, rootPath, Filter(skipHidden, applyFilters)) {}
+
+    /**
+     * @brief Constructs a DirectoryWalker that walks part of a larger tree and starts enumerating.
+     *
+     * @param pool The pool on which directories are enumerated. It must outlive the walker.
+     * @param rootPath The directory to walk.
+     * @param filter The filter applied to the entries.
+     * @param onDirectory Called for every directory read, or `nullptr`.
+     * @param rootRelativePath The path of `rootPath` relative to the root of the larger tree, used
+     *                         to match ignore rules and globs; empty if `rootPath` is that root.
+     * @param rootRules The ignore rules in force in the parent of `rootPath`, or `nullptr`.
+     * @param measureFiles Whether the size of every file is read with `fstatat` while its
+     *                     directory is read, for `next(FileTable&)`.
+     */
+    DirectoryWalker(ThreadPool& pool, const std::string& rootPath, Filter filter,
+                    DirectoryCallback onDirectory = nullptr, std::string rootRelativePath = std::string(),
+                    std::shared_ptr<const IgnoreRules> rootRules = nullptr, bool measureFiles = false);
+
+    /**
+     * @brief Waits for the enumeration tasks that are still running.
+     */
+    ~DirectoryWalker();
+
+    DirectoryWalker(const DirectoryWalker&) = delete;
+    DirectoryWalker& operator=(const DirectoryWalker&) = delete;
+
+    /**
+     * @brief Returns the next regular file of the walk.
+     *
+     * @param filePath Receives the path of the file, built by joining the root path and the
+     *                 names of the entries leading to the file.
+     * @return `true` if a file was returned, `false` once the walk is complete.
+     */
+    bool next(std::string& filePath);
+
+    /**
+     * @brief Adds the next regular file of the walk to a table.
+     *
+     * The directories leading to the file are added to the table the first time one of their
+     * files is returned, so empty directories take no room.
+     *
+     * @param table The table receiving the file. It must be the table of this walk's root, and
+     *              receive every file of the walk.
+     * @return `true` if a file was added, `false` once the walk is complete.
+     */
+    bool next(FileTable& table);
+
+private:
+    /**
+     * @struct Node
+     * @brief A directory of the tree, filled in by the task that enumerates it.
+     */
+    struct Node {
+        /**
+         * @struct Entry
+         * @brief A regular file or subdirectory of the directory.
+         */
+        struct Entry {
+            std::string name;            ///< The entry name.
+            std::unique_ptr<Node> child; ///< The subdirectory node, or `nullptr` for a file.
+            std::uint64_t size = FileTable::unknownSize; ///< The size of a file, if the walk measures files.
+            bool isLink = false;         ///< Whether `readdir` reported a symbolic link.
+        };
+
+        std::string path;           ///< The path of the directory.
+        std::string relativePath;   ///< The path of the directory relative to the root, empty for the root.
+        std::shared_ptr<const IgnoreRules> ignoreRules; ///< The rules of the ignore files of the parents, or `nullptr`.
+        std::vector<Entry> entries; ///< The entries, sorted by name once `ready` is set.
+        bool ready = false;         ///< Set (under `stateMutex`) once the directory has been read.
+    };
+
+    /**
+     * @brief Reads one directory, sorts its entries and schedules its subdirectories.
+     *
+     * @param node The node of the directory to read.
+     */
+    void enumerate(Node* node);
+
+    /**
+     * @brief Schedules the enumeration of a directory on the pool.
+     *
+     * @param node The node of the directory to read.
+     */
+    void schedule(Node* node);
+
+    /**
+     * @brief Moves to the next regular file of the walk.
+     *
+     * @return The entry of the file, whose directory is the top of `stack`, or `nullptr` once
+     *         the walk is complete.
+     */
+    const Node::Entry* advance();
+
+    /**
+     * @struct Frame
+     * @brief A directory being consumed by `next`, with the position of the next entry.
+     */
+    struct Frame {
+        Node* node;        ///< The directory.
+        std::size_t index; ///< The index of the next entry to return.
+        std::uint32_t tableDirectory; ///< The index of the directory in the table of `next`, or `FileTable::noDirectory`.
+    };
+
+    ThreadPool& pool;          ///< The pool running the enumeration tasks.
+    Filter filter;             ///< Decides which entries are kept.
+    DirectoryCallback onDirectory; ///< Called for every directory read, or empty.
+    bool measureFiles;          ///< Whether the size of every file is read during the walk.
+    std::unique_ptr<Node> root; ///< The root of the tree.
+    std::vector<Frame> stack;   ///< The consumption position, from the root down.
+
+    std::mutex stateMutex;             ///< Guards the `ready` flags and `outstanding`.
+    std::condition_variable nodeReady; ///< Signalled whenever a directory has been read.
+    std::size_t outstanding = 0;       ///< Number of scheduled directories not yet read.
+};
@@ -0,0 +1,59 @@
+/**
+ * @file ExtensionTable.h
+ * @brief This file contains the declaration of the ExtensionTable class.
+ *
+ * The ExtensionTable class recognizes the file extensions of binary formats. The built-in
+ * extensions form a sorted array checked at compile time, so the table costs nothing at startup;
+ * users can add their own extensions in a configuration file read once when the program starts.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @class ExtensionTable
+ * @brief Case-insensitive lookup of binary file extensions, including multi-part ones.
+ *
+ * A file name matches when any of its suffixes starting at a dot is a known extension, so
+ * `archive.TAR.GZ` matches both `.tar.gz` and `.gz`. A leading dot does not start an extension:
+ * `.gz` alone is a hidden file without extension.
+ */
+class ExtensionTable {
+public:
+    /**
+     * @brief Checks whether a file name ends with a binary extension.
+     *
+     * @param fileName The name of the file, without directories.
+     * @return `true` if the name ends with a built-in or user-defined binary extension.
+     */
+    static bool isBinary(std::string_view fileName);
+
+    /**
+     * @brief Loads user-defined extensions from the default configuration file, if it exists.
+     *
+     * The file is `$XDG_CONFIG_HOME/mavu/binary-extensions`, or
+     * `~/.config/mavu/binary-extensions` when `XDG_CONFIG_HOME` is not set. It must be called
+     * once at startup, before any lookup.
+     */
+    static void loadUserExtensions();
+
+    /**
+     * @brief Loads user-defined extensions from a file.
+     *
+     * The file holds one extension per line, with or without the leading dot. Empty lines and
+     * lines starting with `#` are ignored. Extensions are matched case-insensitively.
+     *
+     * @param configPath The path of the file.
+     * @return The number of extensions loaded, or 0 if the file cannot be read.
+     */
+    static std::size_t loadUserExtensions(const std::string& configPath);
+
+    /**
+     * @brief Returns the path of the default configuration file, or an empty string if unknown.
+     */
+    static std::string userConfigPath();
+
+    static constexpr std::size_t maxExtensionLength = 32; ///< Longer suffixes are never looked up.
+};
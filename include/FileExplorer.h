@@ -2,9 +2,9 @@
  * @file FileExplorer.h
  * @brief This file contains the implementation of the FileExplorer class.
  * 
- * The FileExplorer class is responsible for exploring files in a directory. It interacts with 
- * FileManager to retrieve the list of files, uses FileReader to read the contents of the files, 
- * and displays the file contents using the Outputs class. Binary files are displayed in hexadecimal 
+ * The FileExplorer class is responsible for exploring files in a directory. It walks the directory,
+ * uses FileReader to read the contents of the files, and displays the file contents using the
+ * Outputs class. Reading and classification overlap with output through a bounded pipeline. Binary files are displayed in hexadecimal 
  * format, while text files are displayed as they are.
  * 
  * The implementation relies on C++ Standard Library's filesystem and string classes for file 
@@ -12,10 +12,17 @@
  */
 
 #pragma once
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <utility>
 #include "FileManager.h"
+#include "ThreadPool.h"
+
+class Matcher;
 
 /**
  * @class FileExplorer
@@ -28,6 +35,15 @@
  */
 class FileExplorer {
 public:
+    /**
+     * @struct RootDirectory
+     * @brief A directory to explore, with the other directories nested in it.
+     */
+    struct RootDirectory {
+        std::string path;                           ///< The path of the directory, as given.
+        std::vector<std::string> nestedDirectories; ///< The relative paths of the other roots nested in this one, left out of its walk.
+    };
+
     /**
      * @brief Constructs a FileExplorer object with a specific directory path.
      * 
@@ -35,18 +51,101 @@ public:
      * directory path to it for file exploration.
      *
      * @param path The directory path to explore.
+     * @param matcher The pattern to search in the files, or `nullptr` to display whole files. It
+     *                must outlive the explorer.
+     */
+    explicit FileExplorer(const std::string& path, const Matcher* matcher = nullptr)
+        : FileExplorer(std::vector<std::string>{path}, matcher) {}
+
+    /**
+     * @brief Constructs a FileExplorer object over several directories, such as the matches of a glob.
+     *
+     * The directories are explored in the given order by a single pipeline. A directory that
+     * is the same as an earlier one is dropped, and a directory nested in another one is left
+     * out of the walk of the other one, so no file is displayed twice.
+     *
+     * @param paths The directory paths to explore, in display order.
+     * @param matcher The pattern to search in the files, or `nullptr` to display whole files. It
+     *                must outlive the explorer.
+     */
+    explicit FileExplorer(const std::vector<std::string>& paths, const Matcher* matcher = nullptr);
+
+    /**
+     * @brief Constructs a FileExplorer object over directories already resolved by `resolveRoots`.
+     *
+     * @param roots The directories to explore, in display order.
+     * @param matcher The pattern to search in the files, or `nullptr` to display whole files. It
+     *                must outlive the explorer.
      */
-    explicit FileExplorer(const std::string& path) : fileManager(path) {}
+    explicit FileExplorer(std::vector<RootDirectory> roots, const Matcher* matcher = nullptr);
 
     /**
-     * @brief Explores the files in the specified directory.
+     * @brief Explores the files in the specified directories.
      * 
-     * This method uses the `FileManager` to retrieve all files in the directory and then applies
-     * any necessary logic (e.g., filtering binary or hidden files) based on the current configuration.
-     * The method handles the display and organization of the exploration results.
+     * This method walks the directories and then applies any necessary logic (e.g., filtering binary
+     * or hidden files) based on the current configuration. Files are read and classified on worker
+     * threads while earlier files are being written, and the output keeps the traversal order,
+     * directory after directory. With `--dedupe`, files with the same content are displayed once.
      */
     void explore();
 
+    /**
+     * @brief Displays the given files the way `explore` displays the files it finds.
+     *
+     * @param pool The pool running the workers. It can be shared by successive calls.
+     * @param files The paths of the files to display, each with the index of its directory, in
+     *              display order.
+     */
+    void exploreFiles(ThreadPool& pool, const std::vector<std::pair<std::string, std::size_t>>& files);
+
+    /**
+     * @brief Drops the directories that are the same as an earlier one and finds the nested ones.
+     *
+     * @param paths The directory paths, in display order.
+     * @return The remaining directories, in display order.
+     */
+    static std::vector<RootDirectory> resolveRoots(const std::vector<std::string>& paths);
+
 private:
-    FileManager fileManager; ///< The `FileManager` instance used to handle file operations.
+    /**
+     * @brief Returns the next file to display and the index of its root, or `false` once there are no more.
+     */
+    using FileSource = std::function<bool(std::string& filePath, std::size_t& root)>;
+
+    /**
+     * @struct Root
+     * @brief A directory explored by the explorer.
+     */
+    struct Root {
+        FileManager fileManager;                    ///< The `FileManager` instance used to handle the files of the directory.
+        std::vector<std::string> nestedDirectories; ///< The relative paths of the other roots nested in this one, left out of its walk.
+    };
+
+    /**
+     * @brief Runs the read, classify and write pipeline over the files produced by a source.
+     *
+     * @param pool The pool running the workers.
+     * @param nextFile The source of the files.
+     */
+    void display(ThreadPool& pool, const FileSource& nextFile);
+
+    /**
+     * @brief Builds the filter of the walk of a root.
+     */
+    DirectoryWalker::Filter walkFilter(const Root& root) const;
+
+    /**
+     * @brief Explores the directories, displaying the files with the same content once.
+     *
+     * @param pool The pool running the walks, the hashing and the workers.
+     */
+    void exploreDeduplicated(ThreadPool& pool);
+
+    static constexpr std::size_t minQueueDepth = 16; ///< Minimum number of files in flight in the pipeline.
+    static constexpr std::size_t hashBatchSize = 64; ///< Number of files hashed by one task of `--dedupe`.
+    static constexpr std::size_t segmentsInFlight = 2; ///< Segments of a large binary file converted at once, per worker.
+
+    std::vector<Root> roots; ///< The explored directories, in display order.
+    const Matcher* matcher;  ///< The pattern searched by `--grep`, or `nullptr`.
+    std::unordered_map<std::string, std::vector<std::string>> duplicates; ///< The relative paths of the copies of each displayed file, with `--dedupe`.
 };
@@ -3,17 +3,19 @@
  * @brief This file contains the implementation of the FileManager class.
  * 
  * The FileManager class is responsible for managing and processing files in a specified directory.
- * It includes functions for retrieving all files, checking if a file is hidden, and determining 
- * if a file has a binary extension. The class allows filtering files based on visibility 
+ * It includes functions for retrieving all files and determining if a file has a binary extension. The class allows filtering files based on visibility 
  * settings for hidden and binary files.
  * 
- * The implementation uses the C++ Standard Library's filesystem and set functionality.
+ * The implementation uses the C++ Standard Library's filesystem functionality.
  */
 
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <filesystem>
+#include "DirectoryWalker.h"
+#include "FileTable.h"
 
 /**
  * @class FileManager
@@ -21,7 +23,7 @@
  * 
  * The `FileManager` class provides functionality to explore files in a specified directory.
  * It allows the retrieval of all regular files (excluding hidden or binary files, based on configuration)
- * and provides methods for identifying binary files and hidden files.
+ * and provides methods for identifying binary files.
  * This class encapsulates file system operations, making it easier to interact with files
  * based on specific criteria like file extensions or visibility.
  */
@@ -44,16 +46,35 @@ public:
      * 
      * This method recursively explores the directory specified by `dirPath` and returns
      * a list of regular files, excluding binary and hidden files based on the current configuration.
+     * Directories are enumerated concurrently, but the files are always returned in the same order:
+     * the entries of each directory sorted by name, depth first.
      * 
-     * @return A vector containing the paths of all regular files.
+     * @param onDirectory Called for every directory read, possibly concurrently, or `nullptr`.
+     * @param skippedDirectories The relative paths of the directories not descended into.
+     * @return A table of all regular files, with the sizes read during the walk.
      */
-    std::vector<std::filesystem::path> getAllFiles();
+    FileTable getAllFiles(DirectoryWalker::DirectoryCallback onDirectory = nullptr,
+                          const std::vector<std::string>& skippedDirectories = {});
+
+    /**
+     * @brief Returns the path of a file relative to the explored directory.
+     * 
+     * Paths produced by the walk start with `dirPath`, so the relative path is cut from the path
+     * itself, without normalizing or allocating anything. Other paths go through
+     * `std::filesystem::relative`.
+     *
+     * @param filePath The path of the file.
+     * @param storage Holds the relative path when it cannot be cut from `filePath`.
+     * @return The relative path, a view into `filePath` or `storage`.
+     */
+    std::string_view relativePath(std::string_view filePath, std::string& storage) const;
 
     /**
      * @brief Checks if a file has a binary extension.
      * 
      * This method checks the extension of the provided file path to determine whether the file
-     * has a binary extension. It uses a predefined set of known binary extensions to perform the check.
+     * has a binary extension. It uses the `ExtensionTable` of known binary extensions, extended by
+     * the user configuration file, to perform a case-insensitive check.
      * 
      * @param filePath The path to the file.
      * @return `true` if the file has a binary extension, otherwise `false`.
@@ -63,23 +84,11 @@ public:
     /**
     * @brief Checks if a file has a text MIME type.
     *
-    * This function checks the file extension against a predefined set of text file extensions.
-    * Common text file extensions like .txt, .md, .html, etc., are included in this set.
+    * This function classifies the file content through the `Classifier`, which keeps one loaded
+    * libmagic database per thread.
     *
     * @param filePath The path of the file to check.
     * @return True if the file has a text MIME type, otherwise false.
     */
     bool isTextMimeType(const std::filesystem::path& filePath) const;
-
-private:
-    /**
-     * @brief Checks if a file is hidden.
-     * 
-     * This method checks if a file is hidden based on its name. In Unix-like systems,
-     * files starting with a dot (.) are considered hidden.
-     * 
-     * @param filePath The path to the file.
-     * @return `true` if the file is hidden, otherwise `false`.
-     */
-    bool isHiddenFile(const std::filesystem::path& filePath) const;
 };
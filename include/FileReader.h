@@ -1,31 +1,172 @@
 /**
  * @file FileReader.h
  * @brief This file contains the implementation of the FileReader class.
- * 
+ *
  * The FileReader class is responsible for reading the content of files. It handles exceptions
- * related to file opening and reading, such as missing files, permissions errors, and other 
+ * related to file opening and reading, such as missing files, permissions errors, and other
  * system-related issues.
- * 
- * Functions in this file make use of C++ Standard Library features such as ifstream, filesystem,
- * and exception handling.
+ *
+ * Regular files are memory-mapped and exposed as read-only views, so their content is never
+ * copied; other files (pipes, procfs entries, files that cannot be mapped) are read with
+ * buffered `read()` calls instead.
  */
 
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
+
+/**
+ * @class FileBuffer
+ * @brief Holds the content of a file, either memory-mapped or read into memory.
+ *
+ * A `FileBuffer` owns its storage: the mapping is released (or the string freed) when the
+ * buffer is destroyed. It can be moved but not copied.
+ *
+ * Mappings are guarded against files truncated while they are mapped: reading past the new end
+ * of the file raises `SIGBUS`, which would kill the process. The guard replaces the missing page
+ * with a page of zeros and counts the fault on the reading thread, so the reader can report the
+ * file as changed (see `FileReader::truncatedReads`).
+ */
+class FileBuffer {
+public:
+    FileBuffer() = default;
+
+    /**
+     * @brief Creates a buffer holding content read into memory.
+     *
+     * @param content The content of the file.
+     */
+    explicit FileBuffer(std::string content) : content(std::move(content)), fileSize(this->content.size()) {}
+
+    /**
+     * @brief Creates a buffer over a read-only memory mapping, taking ownership of it.
+     *
+     * @param mapping The address of the mapping.
+     * @param length The length of the mapping in bytes.
+     * @param fileSize The size of the whole file, larger than `length` if only a prefix is mapped.
+     */
+    FileBuffer(void* mapping, std::size_t length, std::uint64_t fileSize);
+
+    ~FileBuffer();
+
+    FileBuffer(FileBuffer&& other) noexcept;
+    FileBuffer& operator=(FileBuffer&& other) noexcept;
+    FileBuffer(const FileBuffer&) = delete;
+    FileBuffer& operator=(const FileBuffer&) = delete;
+
+    /**
+     * @brief Returns a read-only view of the content, valid as long as the buffer lives.
+     */
+    std::string_view view() const {
+        return mapping != nullptr ? std::string_view(static_cast<const char*>(mapping), length) : std::string_view(content);
+    }
+
+    /**
+     * @brief Checks whether the content is memory-mapped.
+     */
+    bool isMapped() const { return mapping != nullptr; }
+
+    /**
+     * @brief Checks whether the buffer holds the whole file, rather than only its first bytes.
+     */
+    bool isComplete() const { return view().size() == fileSize; }
+
+    /**
+     * @brief Returns the size of the whole file in bytes.
+     */
+    std::uint64_t size() const { return fileSize; }
+
+private:
+    /**
+     * @brief Stops guarding the mapping and releases it.
+     */
+    void release();
+
+    void* mapping = nullptr;    ///< The memory mapping, or `nullptr` if the content is in `content`.
+    std::size_t length = 0;     ///< The length of the mapping in bytes.
+    int guard = -1;             ///< The slot guarding the mapping against truncation, or -1.
+    std::string content;        ///< The content read into memory, when not mapped.
+    std::uint64_t fileSize = 0; ///< The size of the whole file in bytes.
+};
+
+/**
+ * @class ChunkSource
+ * @brief A content read sequentially in chunks that does not come straight from a file, such as
+ *        the decompressed content of a file or a member of an archive.
+ */
+class ChunkSource {
+public:
+    virtual ~ChunkSource() = default;
+
+    /**
+     * @brief Reads the next chunk of the content.
+     *
+     * @param chunk Receives a view of the chunk, valid until the next call; empty at the end.
+     * @return `true` if a chunk was read, `false` at the end of the content.
+     * @throw std::exception If the content cannot be read.
+     */
+    virtual bool next(std::string_view& chunk) = 0;
+};
+
+/**
+ * @class FileChunkReader
+ * @brief Reads a file sequentially in fixed-size chunks.
+ *
+ * The reader owns a single buffer of the chunk size, reused for every chunk, so the memory it
+ * needs does not depend on the size of the file.
+ */
+class FileChunkReader {
+public:
+    /**
+     * @brief Opens a file for chunked reading.
+     *
+     * @param filePath The path to the file to be read.
+     * @param chunkSize The size of the chunks in bytes.
+     * @throw std::filesystem::filesystem_error If the file cannot be opened.
+     */
+    explicit FileChunkReader(const std::string& filePath, std::size_t chunkSize);
+
+    /**
+     * @brief Closes the file.
+     */
+    ~FileChunkReader();
+
+    FileChunkReader(const FileChunkReader&) = delete;
+    FileChunkReader& operator=(const FileChunkReader&) = delete;
+
+    /**
+     * @brief Reads the next chunk of the file.
+     *
+     * @param chunk Receives a view of the chunk, valid until the next call. Only the last chunk
+     *              may be shorter than the chunk size.
+     * @return `true` if a chunk was read, `false` at the end of the file.
+     * @throw std::system_error If reading fails.
+     */
+    bool next(std::string_view& chunk);
+
+private:
+    int fd;                           ///< The file descriptor of the open file.
+    std::size_t chunkSize;            ///< The size of the chunks in bytes.
+    std::unique_ptr<char[]> buffer;   ///< The chunk buffer, reused for every chunk.
+};
 
 /**
  * @class FileReader
  * @brief Handles file reading operations.
- * 
- * The `FileReader` class provides static methods to read the contents of a file. 
- * It can be used to load the content of text files for further processing or display. 
+ *
+ * The `FileReader` class provides static methods to read the contents of a file.
+ * It can be used to load the content of text files for further processing or display.
  * The class is designed to be simple and only deals with file reading operations.
  */
 class FileReader {
 public:
     /**
      * @brief Reads the contents of a file.
-     * 
+     *
      * This static method reads the entire content of the specified file and returns it as a string.
      * If the file cannot be opened or read, an exception will be thrown.
      *
@@ -34,4 +175,93 @@ public:
      * @throw std::ios_base::failure If the file cannot be opened or read.
      */
     static std::string readFile(const std::string& filePath);
+
+    /**
+     * @brief Opens a file and returns its content without copying it.
+     *
+     * This static method memory-maps regular files. Files that cannot be mapped (pipes, procfs
+     * entries reporting a size of zero, or any file where `mmap` fails) are read into memory
+     * with buffered `read()` calls instead. If the file cannot be opened, an error message is
+     * printed and the buffer holds a short notice in place of the content, as `readFile` does.
+     *
+     * Regular files larger than `maxLength` are only mapped up to `maxLength` bytes; the returned
+     * buffer then reports that it is not complete, and the file is meant to be streamed with a
+     * `FileChunkReader`.
+     *
+     * @param filePath The path to the file to be read.
+     * @param maxLength The maximum number of bytes of a regular file to map.
+     * @return A buffer holding the content of the file.
+     */
+    static FileBuffer mapFile(const std::string& filePath,
+                              std::size_t maxLength = std::numeric_limits<std::size_t>::max());
+
+    /**
+     * @brief Maps a whole file for a bounded preview, without reading it.
+     *
+     * Unlike `mapFile`, the mapping is not advised for sequential reading and its bytes are not
+     * counted as read: only the pages touched by the classification and by `previewWindow` are
+     * read from the disk, whatever the size of the file.
+     *
+     * @param filePath The path to the file to be read.
+     * @return A buffer holding the content of the file.
+     */
+    static FileBuffer mapForPreview(const std::string& filePath);
+
+    /**
+     * @brief Checks whether `--head`, `--tail` or `--max-bytes` limit the displayed content.
+     */
+    static bool isPreviewing();
+
+    /**
+     * @brief Selects the part of a file displayed by `--head`, `--tail` and `--max-bytes`.
+     *
+     * The first lines are found by scanning forward from the start of the content, and the last
+     * lines by scanning backwards from its end, block by block, so only the displayed bytes (and
+     * the block holding the first of them) are touched. A final newline does not start a line.
+     * Binary content counts rows of `binaryRowLength` bytes instead of lines. `--max-bytes` then
+     * keeps at most that many bytes, from the start or, with `--tail`, from the end.
+     *
+     * @param buffer The content of the file.
+     * @param isBinary Whether the file is binary.
+     * @return A view of the displayed part of the content, pointing into `buffer`.
+     */
+    static std::string_view previewWindow(const FileBuffer& buffer, bool isBinary);
+
+    /**
+     * @brief Reads part of an open file at a given offset, retrying short reads.
+     *
+     * @param fd The open file.
+     * @param offset The offset of the first byte to read.
+     * @param buffer Receives the bytes.
+     * @param size The number of bytes to read.
+     * @return The number of bytes read, less than `size` only at the end of the file.
+     * @throw std::system_error If reading fails.
+     */
+    static std::size_t readAt(int fd, std::uint64_t offset, char* buffer, std::size_t size);
+
+    /**
+     * @brief Returns the number of reads of truncated mappings made by the calling thread.
+     *
+     * A file truncated while it is mapped reads as zeros past its new end. Comparing the count
+     * before and after handling a file tells whether its content changed under the reader, in
+     * which case the file must be reported as an error rather than displayed.
+     */
+    static std::uint64_t truncatedReads();
+
+    static constexpr std::size_t streamThreshold = 8 * 1024 * 1024; ///< Files larger than this are streamed.
+    static constexpr std::size_t chunkSize = 1024 * 1024;           ///< The chunk size used when streaming.
+    static constexpr std::size_t previewSniffLength = 64 * 1024;    ///< Bytes classified when previewing.
+    static constexpr std::size_t previewBlockSize = 64 * 1024;      ///< The block size of backward scans.
+    static constexpr std::size_t binaryRowLength = 16;              ///< The bytes of a binary "line".
+
+private:
+    /**
+     * @brief Opens a file and maps it, or reads it if it cannot be mapped.
+     *
+     * @param filePath The path to the file to be read.
+     * @param maxLength The maximum number of bytes of a regular file to map.
+     * @param preview Whether the mapping is read on demand by a preview rather than sequentially.
+     * @return A buffer holding the content of the file, or an error message.
+     */
+    static FileBuffer map(const std::string& filePath, std::size_t maxLength, bool preview);
 };
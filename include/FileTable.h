@@ -0,0 +1,158 @@
+/**
+ * @file FileTable.h
+ * @brief This file contains the declaration of the FileTable class.
+ *
+ * The FileTable class stores the list of files found by a walk compactly: every file and
+ * directory is a fixed-size record holding the index of its parent directory and the position of
+ * its name in a shared string arena, so the table needs no allocation per entry. Paths are
+ * rebuilt on demand by concatenating the names into a buffer supplied by the caller.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class FileTable
+ * @brief Compact, append-only table of the files of a directory tree.
+ *
+ * Directory 0 is the root of the tree. Names are appended to a single arena; records refer to
+ * them by offset, so growing the arena never invalidates them. A relative path costs one append
+ * per directory level and no allocation once the caller's buffer is large enough.
+ */
+class FileTable {
+public:
+    /**
+     * @enum Type
+     * @brief The type of a file, as reported by the walk.
+     */
+    enum class Type : std::uint8_t {
+        Regular, ///< A regular file.
+        Link,    ///< A symbolic link to a regular file.
+    };
+
+    static constexpr std::uint32_t rootDirectory = 0;                                     ///< The index of the root directory.
+    static constexpr std::uint32_t noDirectory = std::numeric_limits<std::uint32_t>::max(); ///< The parent of the root.
+    static constexpr std::uint64_t unknownSize = std::numeric_limits<std::uint64_t>::max(); ///< The size of a file that was not measured.
+
+    /**
+     * @brief Creates an empty table for the tree at a given path.
+     *
+     * @param rootPath The path of the root directory, as given to the walk.
+     */
+    explicit FileTable(std::string rootPath);
+
+    /**
+     * @brief Adds a directory.
+     *
+     * @param parent The index of the parent directory.
+     * @param name The name of the directory.
+     * @return The index of the new directory.
+     */
+    std::uint32_t addDirectory(std::uint32_t parent, std::string_view name);
+
+    /**
+     * @brief Adds a file.
+     *
+     * @param directory The index of the directory holding the file.
+     * @param name The name of the file.
+     * @param type The type of the file.
+     * @param size The size of the file in bytes, or `unknownSize`.
+     */
+    void addFile(std::uint32_t directory, std::string_view name, Type type, std::uint64_t size);
+
+    /**
+     * @brief Removes the last file added, releasing its name from the arena.
+     */
+    void removeLastFile();
+
+    /**
+     * @brief Returns the number of files.
+     */
+    std::size_t size() const { return files.size(); }
+
+    /**
+     * @brief Checks whether the table holds no file.
+     */
+    bool empty() const { return files.empty(); }
+
+    /**
+     * @brief Returns the name of a file, valid until the next file or directory is added.
+     */
+    std::string_view name(std::size_t file) const {
+        return std::string_view(names).substr(files[file].nameOffset, files[file].nameLength);
+    }
+
+    /**
+     * @brief Returns the size of a file in bytes, or `unknownSize` if the walk did not measure it.
+     */
+    std::uint64_t fileSize(std::size_t file) const { return files[file].size; }
+
+    /**
+     * @brief Returns the type of a file.
+     */
+    Type type(std::size_t file) const { return files[file].type; }
+
+    /**
+     * @brief Returns the path of the root directory.
+     */
+    const std::string& rootPath() const { return root; }
+
+    /**
+     * @brief Writes the path of a file relative to the root.
+     *
+     * @param file The index of the file.
+     * @param output Receives the path, replacing its content. Its capacity is reused.
+     */
+    void relativePath(std::size_t file, std::string& output) const;
+
+    /**
+     * @brief Writes the path of a file, starting with the root path as the walk does.
+     *
+     * @param file The index of the file.
+     * @param output Receives the path, replacing its content. Its capacity is reused.
+     */
+    void path(std::size_t file, std::string& output) const;
+
+    /**
+     * @brief Returns the number of bytes allocated by the table.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    /**
+     * @struct Directory
+     * @brief A directory of the tree.
+     */
+    struct Directory {
+        std::size_t nameOffset;  ///< The position of the name in `names`.
+        std::uint32_t nameLength; ///< The length of the name.
+        std::uint32_t parent;    ///< The index of the parent directory, or `noDirectory` for the root.
+    };
+
+    /**
+     * @struct File
+     * @brief A file of the tree.
+     */
+    struct File {
+        std::size_t nameOffset;   ///< The position of the name in `names`.
+        std::uint64_t size;       ///< The size of the file in bytes, or `unknownSize`.
+        std::uint32_t nameLength; ///< The length of the name.
+        std::uint32_t directory;  ///< The index of the directory holding the file.
+        Type type;                ///< The type of the file.
+    };
+
+    /**
+     * @brief Appends the path of a directory relative to the root, followed by a slash unless it is the root.
+     */
+    void appendDirectory(std::uint32_t directory, std::string& output) const;
+
+    std::string root;                   ///< The path of the root directory.
+    std::string names;                  ///< The arena holding the names of all entries.
+    std::vector<Directory> directories; ///< The directories, the root first.
+    std::vector<File> files;            ///< The files, in the order of the walk.
+};
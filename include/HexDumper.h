@@ -0,0 +1,100 @@
+/**
+ * @file HexDumper.h
+ * @brief This file contains the declaration of the HexDumper class.
+ *
+ * The HexDumper class renders binary content in the canonical hexdump format selected by
+ * `--hex-style=canonical`, the one of `hexdump -C`: an offset, 16 bytes per row in two groups of
+ * eight, and the printable characters between bars. A row equal to the previous one is replaced
+ * by a `*` line, like `hexdump` does, so long runs of identical rows cost one comparison each.
+ * It provides a scalar kernel and, on x86, an SSSE3 kernel selected at runtime.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @class HexDumper
+ * @brief Renders content as canonical hexdump rows, one piece after the other.
+ *
+ * A dumper keeps the offset, the last row and the bytes of an incomplete row between calls, so
+ * a file can be dumped chunk by chunk with the same output as when it is dumped at once.
+ */
+class HexDumper {
+public:
+    /**
+     * @brief Signature shared by all row kernels: formats `rowCount` complete rows and returns
+     *        the end of the output.
+     */
+    using Kernel = char* (*)(HexDumper& dumper, const char* rows, std::size_t rowCount, char* output);
+
+    /**
+     * @brief Creates a dumper whose first row starts at the given offset.
+     *
+     * @param offset The offset displayed for the first byte, such as the bytes skipped by a preview.
+     */
+    explicit HexDumper(std::uint64_t offset = 0) : offset(offset) {}
+
+    /**
+     * @brief Creates a dumper resuming a dump at a row boundary, from the rows that precede it.
+     *
+     * The output of a dump only depends on the two rows before each row, so a dumper resumed
+     * from them writes the same rows as a dumper that went through all the previous bytes.
+     * Segments of a file can thus be dumped independently and their outputs concatenated.
+     *
+     * @param offset The offset of the first byte to dump, a multiple of `rowSize`.
+     * @param before The up to two complete rows just before `offset`.
+     */
+    HexDumper(std::uint64_t offset, std::string_view before);
+
+    /**
+     * @brief Appends the rows completed by a piece of content.
+     *
+     * @param input The next bytes of the content.
+     * @param output The buffer receiving the rows.
+     */
+    void dump(std::string_view input, std::string& output);
+
+    /**
+     * @brief Appends the incomplete last row, if any, and the line holding the final offset.
+     *
+     * Nothing is appended if no byte was dumped.
+     *
+     * @param output The buffer receiving the rows.
+     */
+    void finish(std::string& output);
+
+    /**
+     * @brief Returns the name of the kernel used by `dump` (`"ssse3"` or `"scalar"`).
+     */
+    static const char* kernelName();
+
+    /**
+     * @brief Formats complete rows with the portable kernel.
+     */
+    static char* dumpScalar(HexDumper& dumper, const char* rows, std::size_t rowCount, char* output);
+
+#if defined(__x86_64__) || defined(__i386__)
+    /**
+     * @brief Formats complete rows with the SSSE3 kernel. The CPU must support SSSE3.
+     */
+    static char* dumpSsse3(HexDumper& dumper, const char* rows, std::size_t rowCount, char* output);
+#endif
+
+    static constexpr std::size_t rowSize = 16;    ///< Number of bytes per row.
+    static constexpr std::size_t maxLineSize = 87; ///< Longest formatted row, with a 16-digit offset.
+
+private:
+    /**
+     * @brief Appends complete rows with the fastest kernel supported by the CPU.
+     */
+    void dumpRows(const char* rows, std::size_t rowCount, std::string& output);
+
+    std::uint64_t offset;        ///< The offset of the next row.
+    bool dumped = false;         ///< Whether any byte was dumped.
+    bool squeezing = false;      ///< Whether the last rows were replaced by a `*` line.
+    char previous[rowSize] = {}; ///< The last complete row, valid once `dumped` is set.
+    std::string pending;         ///< The bytes of the incomplete row, fewer than `rowSize`.
+};
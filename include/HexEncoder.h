@@ -0,0 +1,62 @@
+/**
+ * @file HexEncoder.h
+ * @brief This file contains the declaration of the HexEncoder class.
+ *
+ * The HexEncoder class converts bytes to the hexadecimal format used to display binary files:
+ * two lowercase digits followed by a space for every byte. It provides a scalar lookup-table
+ * kernel and, on x86, SSSE3 and AVX2 kernels selected at runtime according to the CPU.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @class HexEncoder
+ * @brief Encodes bytes as `"xx "` hexadecimal tokens into a caller-provided buffer.
+ *
+ * The encoders write exactly `encodedSize(input.size())` bytes and never allocate, so they can
+ * fill a preallocated output buffer or a reusable streaming buffer directly.
+ */
+class HexEncoder {
+public:
+    /**
+     * @brief Signature shared by all encoding kernels.
+     */
+    using Kernel = void (*)(std::string_view input, char* output);
+
+    /**
+     * @brief Returns the number of bytes produced when encoding `inputSize` bytes.
+     */
+    static constexpr std::size_t encodedSize(std::size_t inputSize) { return inputSize * 3; }
+
+    /**
+     * @brief Encodes the input with the fastest kernel supported by the CPU.
+     *
+     * @param input The bytes to encode.
+     * @param output The destination, at least `encodedSize(input.size())` bytes long.
+     */
+    static void encode(std::string_view input, char* output);
+
+    /**
+     * @brief Returns the name of the kernel used by `encode` (`"avx2"`, `"ssse3"` or `"scalar"`).
+     */
+    static const char* kernelName();
+
+    /**
+     * @brief Encodes the input with the portable lookup-table kernel.
+     */
+    static void encodeScalar(std::string_view input, char* output);
+
+#if defined(__x86_64__) || defined(__i386__)
+    /**
+     * @brief Encodes the input with the SSSE3 kernel. The CPU must support SSSE3.
+     */
+    static void encodeSsse3(std::string_view input, char* output);
+
+    /**
+     * @brief Encodes the input with the AVX2 kernel. The CPU must support AVX2.
+     */
+    static void encodeAvx2(std::string_view input, char* output);
+#endif
+};
@@ -0,0 +1,110 @@
+/**
+ * @file IgnoreRules.h
+ * @brief This file contains the declaration of the IgnoreRules class.
+ *
+ * The IgnoreRules class holds the patterns of one `.gitignore`-style source (an ignore file, or
+ * the `--exclude` and `--include` globs) compiled into automata, and links to the rules of the
+ * parent directory. The directory walker attaches the rules in force to every directory it reads,
+ * so ignored directories are pruned before they are enumerated.
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Matcher.h"
+
+/**
+ * @class IgnoreRules
+ * @brief Compiled `.gitignore`-style patterns of one directory, chained to those of its parents.
+ *
+ * The patterns follow the `.gitignore` syntax: `*`, `?` and `[...]` do not match `/`, `**` matches
+ * any number of directories, a leading `!` re-includes what an earlier pattern excluded, a
+ * trailing `/` restricts the pattern to directories, and a pattern holding a `/` is anchored to
+ * the directory of the source while other patterns match names at any depth below it. The last
+ * matching pattern decides, and the rules of a directory take precedence over those of its parents.
+ *
+ * Consecutive patterns of the same kind (excluding or re-including) are merged into a single
+ * automaton, so a typical ignore file is matched in one pass over the path whatever its number of
+ * patterns. Rules are immutable once built and can be shared by any number of threads.
+ */
+class IgnoreRules {
+public:
+    /**
+     * @enum Verdict
+     * @brief The outcome of matching a path against the rules.
+     */
+    enum class Verdict {
+        None,    ///< No pattern matches.
+        Matched, ///< The last matching pattern is a plain one: the path is ignored.
+        Negated, ///< The last matching pattern starts with `!`: the path is re-included.
+    };
+
+    /**
+     * @brief Compiles a list of patterns.
+     *
+     * @param patterns The patterns, in the syntax of `.gitignore` lines. Blank lines and comments
+     *                 are skipped.
+     * @param basePath The directory the patterns are relative to, as a path relative to the root
+     *                 of the walk (empty for the root itself).
+     * @param parent The rules in force in the parent directory, or `nullptr`.
+     */
+    IgnoreRules(const std::vector<std::string>& patterns, std::string basePath,
+                std::shared_ptr<const IgnoreRules> parent = nullptr);
+
+    /**
+     * @brief Reads the lines of an ignore file.
+     *
+     * @param filePath The path of the file.
+     * @param patterns Receives the lines of the file, appended.
+     * @return `true` if the file could be read.
+     */
+    static bool readPatterns(const std::string& filePath, std::vector<std::string>& patterns);
+
+    /**
+     * @brief Matches a path against these rules and those of the parent directories.
+     *
+     * @param relativePath The path, relative to the root of the walk.
+     * @param isDirectory Whether the path is a directory.
+     * @return The verdict of the last matching pattern of the innermost rules that match.
+     */
+    Verdict match(std::string_view relativePath, bool isDirectory) const;
+
+    /**
+     * @brief Checks whether a path is ignored by these rules or those of the parent directories.
+     */
+    bool isIgnored(std::string_view relativePath, bool isDirectory) const {
+        return match(relativePath, isDirectory) == Verdict::Matched;
+    }
+
+    /**
+     * @brief Checks whether these rules hold no pattern at all (ignoring the parent rules).
+     */
+    bool empty() const { return runs.empty(); }
+
+    static constexpr const char* fileNames[] = {".gitignore", ".ignore"}; ///< Ignore files, by increasing precedence.
+
+private:
+    /**
+     * @struct Run
+     * @brief Consecutive patterns of the same kind, compiled together.
+     *
+     * The patterns are usually compiled into one automaton per list; they are only compiled one
+     * by one when the merged automaton would be too large.
+     */
+    struct Run {
+        bool negated = false;                ///< Whether the patterns start with `!`.
+        std::vector<Matcher> directoryMatchers; ///< Match all the patterns of the run.
+        std::vector<Matcher> fileMatchers;   ///< Match the patterns that are not restricted to directories.
+    };
+
+    /**
+     * @brief Checks whether one level of rules matches a path, without looking at the parents.
+     */
+    Verdict matchLocal(std::string_view relativePath, bool isDirectory) const;
+
+    std::string basePath;                      ///< The directory of the source, with a trailing `/` unless it is the root.
+    std::vector<Run> runs;                     ///< The runs, in source order.
+    std::shared_ptr<const IgnoreRules> parent; ///< The rules of the parent directory, or `nullptr`.
+};
@@ -0,0 +1,93 @@
+/**
+ * @file Matcher.h
+ * @brief This file contains the declaration of the Matcher class.
+ *
+ * The Matcher class finds the lines of a buffer that match a search pattern. Plain literals are
+ * searched with a vectorized filter comparing the first and last bytes of the literal at every
+ * position of a block, and only the candidates are compared in full. Regular expressions are
+ * compiled once into a deterministic automaton that reads every byte at most once.
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class Matcher
+ * @brief Line-oriented search of a literal or a regular expression in raw content.
+ *
+ * The supported regular expression syntax is a subset of POSIX extended expressions: literals,
+ * `.`, bracket expressions (`[a-z]`, `[^0-9]`), the escapes `\d`, `\w`, `\s` and their negations,
+ * escaped punctuation, anchors `^` and `$`, groups, alternation `|`, and the repetitions `*`,
+ * `+`, `?` and `{m,n}`. A match never spans several lines. A compiled matcher is immutable and
+ * can be shared by any number of threads.
+ */
+class Matcher {
+public:
+    /**
+     * @brief Compiles a pattern.
+     *
+     * Patterns without any special character are searched as literals, as are all patterns when
+     * `fixedStrings` is set. Other patterns, and literals searched without case, are compiled
+     * into an automaton.
+     *
+     * @param pattern The pattern to search.
+     * @param fixedStrings Whether the pattern is a literal, even if it holds special characters.
+     * @param ignoreCase Whether ASCII letters match regardless of their case.
+     * @throw std::invalid_argument If the pattern is malformed or its automaton is too large.
+     */
+    explicit Matcher(const std::string& pattern, bool fixedStrings = false, bool ignoreCase = false);
+
+    /**
+     * @brief Finds the next line holding a match.
+     *
+     * @param content The content to search.
+     * @param from The offset where the search starts; it must be the start of a line.
+     * @param lineBegin Receives the offset of the first byte of the matching line.
+     * @param lineEnd Receives the offset of the end of the matching line, excluding the newline.
+     * @return `true` if a matching line was found, `false` if there is none after `from`.
+     */
+    bool findLine(std::string_view content, std::size_t from, std::size_t& lineBegin, std::size_t& lineEnd) const;
+
+    /**
+     * @brief Checks whether a single line holds a match.
+     *
+     * Unlike `findLine`, this is not accounted to the search stage of the profiler, so it can be
+     * used to match paths and names.
+     *
+     * @param line The line, without any newline.
+     * @return `true` if the line holds a match.
+     */
+    bool matches(std::string_view line) const;
+
+    /**
+     * @brief Returns the name of the search engine in use (`"literal"` or `"dfa"`).
+     */
+    const char* engineName() const { return literalSearch ? "literal" : "dfa"; }
+
+    /**
+     * @brief Returns the number of states of the automaton, or 0 for literal searches.
+     */
+    std::size_t stateCount() const { return flags.size(); }
+
+    static constexpr std::size_t maxStates = 4096; ///< Larger automata are rejected.
+    static constexpr int maxRepeat = 1000;          ///< Larger repetition counts are rejected.
+
+private:
+    bool findLineLiteral(std::string_view content, std::size_t from, std::size_t& lineBegin, std::size_t& lineEnd) const;
+    bool findLineDfa(std::string_view content, std::size_t from, std::size_t& lineBegin, std::size_t& lineEnd) const;
+
+    bool literalSearch = false;                ///< Whether `literal` is searched instead of running the automaton.
+    std::string literal;                       ///< The literal searched.
+
+    std::array<std::uint8_t, 256> byteClasses{}; ///< The equivalence class of every byte.
+    std::size_t classCount = 0;                ///< The number of byte classes.
+    std::vector<std::int32_t> transitions;     ///< The next state, indexed by `state * classCount + class`.
+    std::vector<std::uint8_t> flags;           ///< Whether each state matches, or matches at the end of a line.
+    std::int32_t lineStartState = 0;           ///< The state at the start of every line.
+    std::int32_t deadState = -1;               ///< The state that can never match on this line, if any.
+};
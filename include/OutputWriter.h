@@ -0,0 +1,135 @@
+/**
+ * @file OutputWriter.h
+ * @brief This file contains the declaration of the OutputWriter class.
+ *
+ * The OutputWriter class batches everything written to a file descriptor into a large reusable
+ * buffer and issues it with `writev`. Small pieces (separators, colorized paths, short files)
+ * are copied into the buffer; large pieces (the content of big files) are written in place,
+ * together with the buffered bytes, in a single system call. A piece written in place that can
+ * no longer be read, such as a mapped file truncated meanwhile, is cut short and counted as a
+ * fault instead of failing the writer.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @class OutputWriter
+ * @brief Buffered writer issuing `writev` calls, flushed at file boundaries or when full.
+ *
+ * The writer is not thread-safe: it is meant to be used by the single thread that writes the
+ * output of the exploration. When the output is a terminal, the buffer is flushed at the end of
+ * every file so the output appears file by file; otherwise it is only flushed when full.
+ *
+ * A write error is reported once on the standard error stream. The output that failed is lost,
+ * but later output is still written, unless the descriptor is closed or its reader is gone.
+ */
+class OutputWriter {
+public:
+    /**
+     * @struct Statistics
+     * @brief Counters describing the work done by the writer.
+     */
+    struct Statistics {
+        std::uint64_t bytes = 0;    ///< Number of bytes written.
+        std::uint64_t segments = 0; ///< Number of pieces handed to `write`.
+        std::uint64_t syscalls = 0; ///< Number of `writev` calls issued.
+    };
+
+    /**
+     * @brief Constructs a writer for a file descriptor.
+     *
+     * @param fd The file descriptor to write to. It is not closed by the writer.
+     */
+    explicit OutputWriter(int fd);
+
+    /**
+     * @brief Flushes the pending output.
+     */
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    /**
+     * @brief Returns the writer of the standard output.
+     */
+    static OutputWriter& standardOutput();
+
+    /**
+     * @brief Appends data to the output.
+     *
+     * Data that fits in the buffer is copied; larger data is written immediately, after the
+     * buffered bytes and in the same `writev` call, without being copied.
+     *
+     * @param data The data to write. It only needs to stay valid for the duration of the call.
+     */
+    void write(std::string_view data);
+
+    /**
+     * @brief Returns free space at the end of the buffer, for an encoder to write into.
+     *
+     * The buffered bytes are written first if less than `size` bytes are free.
+     *
+     * @param size The number of bytes needed, at most `bufferCapacity`.
+     * @return The address of `size` writable bytes, valid until the next call to the writer.
+     */
+    char* reserve(std::size_t size);
+
+    /**
+     * @brief Adds to the output the bytes written at the address returned by `reserve`.
+     *
+     * @param size The number of bytes written, at most the size passed to `reserve`.
+     */
+    void commit(std::size_t size);
+
+    /**
+     * @brief Marks the end of the output of a file, flushing if the output is a terminal.
+     */
+    void endFile();
+
+    /**
+     * @brief Writes all buffered data.
+     */
+    void flush();
+
+    /**
+     * @brief Returns the counters of the writer.
+     */
+    const Statistics& statistics() const { return stats; }
+
+    /**
+     * @brief Returns the number of pieces written in place that were cut short because their
+     *        memory could not be read, such as the mapping of a file truncated while written.
+     */
+    std::uint64_t faults() const { return faultCount; }
+
+    /**
+     * @brief Checks whether any output could not be written.
+     */
+    bool hasError() const { return error != 0; }
+
+    static constexpr std::size_t bufferCapacity = 256 * 1024; ///< Size of the reusable buffer.
+    static constexpr std::size_t copyThreshold = 64 * 1024;   ///< Larger pieces are written in place.
+
+private:
+    /**
+     * @brief Writes the buffered bytes followed by `extra` with as few `writev` calls as possible.
+     *
+     * @param extra Data written after the buffered bytes, possibly empty.
+     */
+    void writeOut(std::string_view extra);
+
+    int fd;                         ///< The file descriptor written to.
+    bool isTerminal;                ///< Whether `fd` refers to a terminal.
+    bool closed = false;            ///< Set once the descriptor is closed or broken; further output is discarded.
+    int error = 0;                  ///< The first write error, or 0.
+    std::unique_ptr<char[]> buffer; ///< The buffered bytes, `bufferCapacity` long, reused between flushes.
+    std::size_t buffered = 0;       ///< The number of bytes used in `buffer`.
+    Statistics stats;               ///< The counters of the writer.
+    std::uint64_t faultCount = 0;   ///< The pieces written in place that could not be read.
+};
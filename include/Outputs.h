@@ -10,8 +10,11 @@
  */
 
 #pragma once
-#include <filesystem>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 /**
  * @class Outputs
@@ -52,7 +55,30 @@ public:
      * @param content The input string to be converted to hexadecimal.
      * @return A string containing the hexadecimal representation of the input string.
      */
-    static std::string convertToHex(const std::string& content);
+    static std::string convertToHex(std::string_view content);
+
+    /**
+     * @brief Converts the input string to its hexadecimal representation into an existing buffer.
+     * 
+     * This static function produces the same output as `convertToHex(std::string_view)` but
+     * writes it into `hexContent`, so a buffer can be reused when converting a file chunk by chunk.
+     *
+     * @param content The input string to be converted to hexadecimal.
+     * @param hexContent Receives the hexadecimal representation, replacing its previous content.
+     */
+    static void convertToHex(std::string_view content, std::string& hexContent);
+
+    /**
+     * @brief Converts the input string to canonical hexdump rows, as `hexdump -C` does.
+     * 
+     * This static function renders rows of 16 bytes with their offset and printable characters,
+     * replacing repeated rows with a `*` line, followed by the final offset.
+     *
+     * @param content The input string to be converted.
+     * @param offset The offset of the first byte of `content` in its file.
+     * @return A string containing the rows.
+     */
+    static std::string convertToHexDump(std::string_view content, std::uint64_t offset);
 
     /**
      * @brief Displays the content of a file in a formatted manner.
@@ -61,13 +87,107 @@ public:
      * in a formatted way. The file path is colorized, with directories shown in green and the file name
      * in white. The content is displayed in gray. It also adds separators for readability.
      *
-     * @param baseDir The base directory to compute relative paths.
-     * @param filePath The full path of the file to be displayed.
+     * @param relativePath The path of the file relative to the explored directory.
      * @param content The content of the file to be displayed.
+     * @param duplicates The other files with the same content, listed under the path.
+     */
+    static void displayFileContent(std::string_view relativePath, std::string_view content,
+                                   const std::vector<std::string>& duplicates = {});
+
+    /**
+     * @brief Displays part of the content of a file, with markers for the bytes left out.
+     * 
+     * This static function displays the file as `displayFileContent` does, preceded by a marker
+     * giving the number of bytes skipped before the content, and followed by a marker giving the
+     * number of bytes left after it. Markers are displayed in yellow, and only when bytes are left out.
+     *
+     * @param relativePath The path of the file relative to the explored directory.
+     * @param content The displayed part of the content.
+     * @param skippedBefore The number of bytes of the file before `content`.
+     * @param skippedAfter The number of bytes of the file after `content`.
+     * @param duplicates The other files with the same content, listed under the path.
+     */
+    static void displayFilePreview(std::string_view relativePath,
+                                   std::string_view content,
+                                   std::uint64_t skippedBefore,
+                                   std::uint64_t skippedAfter,
+                                   const std::vector<std::string>& duplicates = {});
+
+    /**
+     * @brief Displays the header introducing the content of a file.
+     * 
+     * This static function displays the colorized relative path of the file between separators,
+     * as `displayFileContent` does, and leaves the output ready for the content. It is used with
+     * `displayContentChunk` and `displayFileFooter` to display a file piece by piece.
+     *
+     * @param relativePath The path of the file relative to the explored directory.
+     * @param duplicates The other files with the same content, listed under the path.
+     */
+    static void displayFileHeader(std::string_view relativePath, const std::vector<std::string>& duplicates = {});
+
+    /**
+     * @brief Displays a piece of the content of a file.
+     * 
+     * @param content The piece of content to be displayed.
+     */
+    static void displayContentChunk(std::string_view content);
+
+    /**
+     * @brief Displays the end of the content of a file, after its last chunk.
+     */
+    static void displayFileFooter();
+
+    /**
+     * @brief Appends a line matching the searched pattern, preceded by its line number.
+     * 
+     * The line number is displayed in green, the line itself in gray like any other content.
+     *
+     * @param output The buffer receiving the formatted line.
+     * @param lineNumber The number of the line, starting at 1.
+     * @param line The content of the line, without its newline.
+     */
+    static void appendMatchingLine(std::string& output, std::size_t lineNumber, std::string_view line);
+
+    /**
+     * @brief Displays the statistics of the output writer.
+     * 
+     * This static function flushes the standard output and reports, on the standard error
+     * stream, the bytes written and the number of write calls saved by batching.
+     */
+    static void displayOutputStatistics();
+
+    /**
+     * @brief Displays the classification statistics.
+     * 
+     * This static function reports, on the standard error stream, how many files were decided by
+     * the in-process sniffer and how many by libmagic.
+     */
+    static void displayClassifierStatistics();
+
+    /**
+     * @brief Displays the statistics of the classification cache.
+     * 
+     * This static function reports, on the standard error stream, how many files were found in
+     * the persistent cache and how many results were added to it.
+     */
+    static void displayCacheStatistics();
+
+    /**
+     * @brief Displays the profile of the run.
+     * 
+     * This static function reports, on the standard error stream, the files visited and
+     * displayed, the bytes read and emitted, the system calls issued, the time spent in each
+     * stage (summed over threads) and the median and 99th percentile of the per-file latency.
+     */
+    static void displayProfileStatistics();
+
+    /**
+     * @brief Displays all statistics as a single JSON object.
+     * 
+     * This static function flushes the standard output and writes, on the standard error stream,
+     * the output, classifier, cache and profile statistics as one JSON object.
      */
-    static void displayFileContent(const std::filesystem::path& baseDir,
-                                    const std::filesystem::path& filePath,
-                                    const std::string& content);
+    static void displayStatisticsJson();
 
     /**
      * @brief Displays an error message for an invalid argument.
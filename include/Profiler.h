@@ -0,0 +1,143 @@
+/**
+ * @file Profiler.h
+ * @brief This file contains the declaration of the Profiler class.
+ *
+ * The Profiler class measures where the time of a run goes: directory traversal, in-process
+ * sniffing, libmagic, file reads, hexadecimal conversion, pattern search and writes. Every thread accumulates its
+ * own timers and counters, without any synchronization; the figures of all threads are merged
+ * when the report is displayed at exit. When profiling is disabled (the default), timers do not
+ * even read the clock.
+ */
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class Profiler
+ * @brief Per-thread stage timers, counters and per-file latency histogram, merged at exit.
+ */
+class Profiler {
+public:
+    /**
+     * @enum Stage
+     * @brief The stages of a run whose time is measured.
+     */
+    enum class Stage {
+        Traversal,  ///< Reading directories.
+        Sniff,      ///< In-process classification.
+        Libmagic,   ///< Classification by libmagic.
+        Read,       ///< Opening, mapping and reading files.
+        Hex,        ///< Hexadecimal conversion.
+        Write,      ///< Handing the output to the writer and writing it.
+        Search,     ///< Searching the pattern of `--grep`.
+        Encode,     ///< Encoding the records of the structured output formats.
+        Hash,       ///< Hashing file contents for `--dedupe`.
+        Decompress, ///< Decompressing compressed files for `-z`.
+        Count,
+    };
+
+    /**
+     * @enum Counter
+     * @brief The quantities counted during a run.
+     */
+    enum class Counter {
+        FilesVisited,   ///< Files found by the traversal.
+        FilesDisplayed, ///< Files whose content was displayed.
+        BytesRead,      ///< Bytes mapped or read from files.
+        ReadCalls,      ///< `open`, `mmap` and `read` system calls issued to read files.
+        Count,
+    };
+
+    /**
+     * @class ScopedTimer
+     * @brief Adds the time spent in a scope to a stage of the calling thread.
+     */
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Stage stage) : stage(stage), active(enabled) {
+            if (active) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~ScopedTimer() {
+            if (active) {
+                addTime(stage, std::chrono::steady_clock::now() - start);
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Stage stage;
+        bool active;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /**
+     * @brief Enables profiling and starts the wall clock. It must be called before any thread starts.
+     */
+    static void enable();
+
+    /**
+     * @brief Checks whether profiling is enabled.
+     */
+    static bool isEnabled() { return enabled; }
+
+    /**
+     * @brief Adds to a counter of the calling thread.
+     */
+    static void count(Counter counter, std::uint64_t amount = 1) {
+        if (enabled) {
+            addCount(counter, amount);
+        }
+    }
+
+    /**
+     * @brief Records the processing latency of one file in the histogram of the calling thread.
+     */
+    static void recordLatency(std::chrono::steady_clock::duration latency) {
+        if (enabled) {
+            addLatency(latency);
+        }
+    }
+
+    /**
+     * @struct Report
+     * @brief The figures of all threads, merged.
+     */
+    struct Report {
+        double wallSeconds = 0;                                    ///< Time since `enable`.
+        double stageSeconds[static_cast<std::size_t>(Stage::Count)] = {}; ///< Time per stage, summed over threads.
+        std::uint64_t stageCalls[static_cast<std::size_t>(Stage::Count)] = {}; ///< Timed scopes per stage.
+        std::uint64_t counters[static_cast<std::size_t>(Counter::Count)] = {}; ///< Counters, summed over threads.
+        std::uint64_t latencySamples = 0;                          ///< Files whose latency was recorded.
+        double latencyP50 = 0;                                     ///< Median per-file latency in seconds.
+        double latencyP99 = 0;                                     ///< 99th percentile per-file latency in seconds.
+    };
+
+    /**
+     * @brief Merges the figures of all threads. The threads that recorded them must be finished.
+     */
+    static Report report();
+
+    /**
+     * @brief Returns the name of a stage, as used in the report.
+     */
+    static const char* stageName(Stage stage);
+
+    /**
+     * @brief Returns the name of a counter, as used in the report.
+     */
+    static const char* counterName(Counter counter);
+
+private:
+    static void addTime(Stage stage, std::chrono::steady_clock::duration elapsed);
+    static void addCount(Counter counter, std::uint64_t amount);
+    static void addLatency(std::chrono::steady_clock::duration latency);
+
+    static bool enabled; ///< Set once at startup, then only read.
+};
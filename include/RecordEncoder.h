@@ -0,0 +1,116 @@
+/**
+ * @file RecordEncoder.h
+ * @brief This file contains the declaration of the RecordEncoder class.
+ *
+ * The RecordEncoder class writes the files in the structured output formats selected by
+ * `--format`: JSON Lines, NUL-separated records and length-prefixed raw records. The content is
+ * encoded as it arrives, whole or chunk by chunk, straight into the buffer of the output writer,
+ * so a record is never assembled in a string of its own.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class OutputWriter;
+
+/**
+ * @class RecordEncoder
+ * @brief Streams one record per file in the `jsonl`, `nul` or `raw` format.
+ *
+ * A record is written by `begin`, any number of `write` calls, and `end`. The encoder keeps the
+ * bytes that cannot be encoded yet between two calls to `write` (the end of a base64 group, or
+ * the start of a UTF-8 sequence split across chunks), so the output does not depend on how the
+ * content is split.
+ *
+ * - `jsonl`: `{"path":...,"size":...,"type":"text"|"binary","encoding":...,"content":...}` and a
+ *   newline. Text content is escaped as UTF-8; a byte that is not part of a valid UTF-8 sequence
+ *   is written as the lone surrogate `\udcXX`, so the bytes can be recovered exactly. Binary
+ *   content is encoded in base64 or hexadecimal. The records of truncated previews also hold
+ *   `"offset"` and `"truncated"`, and the records of `--dedupe` the other paths of the content
+ *   in `"duplicates"`.
+ * - `nul`: the path, a NUL byte, the content (binary content encoded as for `jsonl`), a NUL byte.
+ * - `raw`: a line `<type> <content size> <path size>`, the path, a newline, the content as is,
+ *   and a newline. Exactly the announced number of content bytes is written.
+ */
+class RecordEncoder {
+public:
+    /**
+     * @struct Record
+     * @brief The description of a file, written before its content.
+     */
+    struct Record {
+        std::string_view path;     ///< The path of the file, relative to the explored directory.
+        std::uint64_t size;        ///< The size of the file in bytes.
+        bool isBinary;             ///< Whether the file is classified as binary.
+        bool encoded;              ///< Whether the content is binary data, encoded in `jsonl` and `nul`.
+        std::uint64_t contentSize; ///< The number of content bytes that will be written.
+        std::uint64_t offset;      ///< The position of the content in the file, when previewing its end.
+        std::uint64_t truncated;   ///< The bytes of the file left out of a preview.
+        const std::vector<std::string>* duplicates = nullptr; ///< The other files with the same content, or `nullptr`.
+    };
+
+    /**
+     * @brief Constructs an encoder writing the format of `Configuration::outputFormat`.
+     *
+     * @param writer The writer receiving the records.
+     */
+    explicit RecordEncoder(OutputWriter& writer);
+
+    /**
+     * @brief Starts a record.
+     *
+     * @param record The description of the file.
+     */
+    void begin(const Record& record);
+
+    /**
+     * @brief Writes a piece of the content of the current record.
+     *
+     * @param content The next bytes of the content.
+     */
+    void write(std::string_view content);
+
+    /**
+     * @brief Ends the current record, marking a file boundary for the writer.
+     */
+    void end();
+
+    /**
+     * @brief Returns the size of the base64 encoding of `inputSize` bytes, with padding.
+     */
+    static constexpr std::size_t base64Size(std::size_t inputSize) { return (inputSize + 2) / 3 * 4; }
+
+    static constexpr std::size_t blockSize = 16 * 1024; ///< Content bytes encoded per reservation in the writer.
+
+private:
+    /**
+     * @brief Escapes text content as the body of a JSON string.
+     *
+     * @param content The content; an incomplete UTF-8 sequence at its end is kept for the next call.
+     * @param final Whether no content follows, so incomplete sequences are escaped byte by byte.
+     */
+    void escapeJson(std::string_view content, bool final);
+
+    /**
+     * @brief Encodes binary content in the selected binary encoding.
+     *
+     * @param content The content; the bytes left over from a base64 group are kept for the next call.
+     * @param final Whether no content follows, so the last group is padded.
+     */
+    void encodeBinary(std::string_view content, bool final);
+
+    /**
+     * @brief Writes the content of a raw record, up to the announced size.
+     */
+    void writeRaw(std::string_view content);
+
+    OutputWriter& writer;        ///< The writer receiving the records.
+    bool encoded = false;        ///< Whether the content of the current record is encoded binary data.
+    std::uint64_t remaining = 0; ///< The content bytes still expected by a raw record.
+    char pending[4];             ///< Bytes kept between two calls: a partial UTF-8 sequence or base64 group.
+    std::size_t pendingSize = 0; ///< The number of bytes in `pending`.
+};
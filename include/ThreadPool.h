@@ -0,0 +1,108 @@
+/**
+ * @file ThreadPool.h
+ * @brief This file contains the declaration of the ThreadPool class.
+ *
+ * The ThreadPool class runs tasks on a fixed set of worker threads. Each worker owns a task
+ * queue; a worker pushes and pops tasks at the back of its own queue and, when it runs out of
+ * work, steals from the front of the queues of the other workers.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief A work-stealing pool of worker threads.
+ *
+ * Tasks submitted from a worker thread of the pool go to that worker's own queue, which keeps
+ * related work (e.g. the subdirectories of a directory) on the same thread. Tasks submitted
+ * from any other thread are distributed over the queues in round-robin order. Idle workers
+ * steal the oldest tasks of busy workers.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Constructs a ThreadPool and starts its worker threads.
+     *
+     * @param threadCount The number of worker threads. `0` uses the number of hardware threads.
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    /**
+     * @brief Waits for all pending tasks to complete and joins the worker threads.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Schedules a task for execution on one of the worker threads.
+     *
+     * @param task The task to run. Exceptions escaping the task are reported and discarded.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Blocks until every submitted task, including tasks submitted by tasks, has completed.
+     */
+    void wait();
+
+    /**
+     * @brief Returns the number of worker threads of the pool.
+     */
+    unsigned size() const { return static_cast<unsigned>(threads.size()); }
+
+    /**
+     * @brief Resolves a requested thread count, mapping `0` to the number of hardware threads.
+     *
+     * @param threadCount The requested thread count.
+     * @return The effective thread count, at least 1.
+     */
+    static unsigned resolveThreadCount(unsigned threadCount);
+
+private:
+    /**
+     * @struct Worker
+     * @brief The task queue owned by one worker thread.
+     */
+    struct Worker {
+        std::deque<std::function<void()>> tasks; ///< Pending tasks, newest at the back.
+        std::mutex mutex;                        ///< Guards `tasks`.
+    };
+
+    /**
+     * @brief Main loop of a worker thread.
+     *
+     * @param index The index of the worker in `workers`.
+     */
+    void run(unsigned index);
+
+    /**
+     * @brief Takes a task from the worker's own queue, or steals one from another worker.
+     *
+     * @param index The index of the worker looking for a task.
+     * @param task Receives the task.
+     * @return `true` if a task was found, otherwise `false`.
+     */
+    bool takeTask(unsigned index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers; ///< One task queue per worker thread.
+    std::vector<std::thread> threads;             ///< The worker threads.
+
+    std::mutex stateMutex;                ///< Guards the sleeping and completion conditions.
+    std::condition_variable workAvailable; ///< Signalled when a task is queued or the pool stops.
+    std::condition_variable allDone;       ///< Signalled when the last pending task completes.
+    std::atomic<std::size_t> queued{0};    ///< Number of tasks sitting in the queues.
+    std::atomic<std::size_t> pending{0};   ///< Number of submitted tasks not yet completed.
+    std::atomic<unsigned> nextWorker{0};   ///< Round-robin cursor for external submissions.
+    bool stopping = false;                 ///< Set when the pool is being destroyed.
+};
@@ -0,0 +1,115 @@
+/**
+ * @file UringReader.h
+ * @brief This file contains the declaration of the UringReader class.
+ *
+ * The UringReader class implements the `--io=uring` backend: it reads batches of small files
+ * through an io_uring instance driven with raw system calls. The status of every file of a batch
+ * is read with one submission, then the files small enough to be held are opened, read whole and
+ * closed with a second one, so a batch costs a few system calls instead of several per file.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+/**
+ * @class UringReader
+ * @brief Reads the status and the content of batches of files through io_uring.
+ *
+ * Files are opened into the ring's own table of registered descriptors, with the read and the
+ * close linked to the open, so no descriptor is ever handed back to the process. The reader is
+ * meant to be used by a single thread; it is not thread-safe.
+ */
+class UringReader {
+public:
+    /**
+     * @struct Request
+     * @brief A file of a batch, with the results read for it.
+     */
+    struct Request {
+        const std::string* path = nullptr; ///< The path of the file.
+        bool wanted = true;                ///< Whether the content must be read, once the status is known.
+        bool statted = false;              ///< Whether `info` was read.
+        struct stat info;                  ///< The status of the file, following symbolic links.
+        bool loaded = false;               ///< Whether `content` holds the whole file.
+        std::string content;               ///< The content of the file, when it is loaded.
+    };
+
+    /**
+     * @brief Creates the io_uring instance and its table of registered descriptors.
+     *
+     * @param batchSize The largest number of requests in a batch.
+     * @throw std::system_error If io_uring is not available.
+     */
+    explicit UringReader(std::size_t batchSize);
+
+    /**
+     * @brief Releases the io_uring instance.
+     */
+    ~UringReader();
+
+    UringReader(const UringReader&) = delete;
+    UringReader& operator=(const UringReader&) = delete;
+
+    /**
+     * @brief Reads the status of every file of a batch.
+     *
+     * @param requests The requests of the batch, at most `batchSize`.
+     * @throw std::system_error If the ring cannot be used anymore.
+     */
+    void stat(std::vector<Request>& requests);
+
+    /**
+     * @brief Reads the content of the wanted regular files of a batch up to `maxFileSize` bytes.
+     *
+     * A file is loaded only if it still has the size read by `stat`; the others are left to the
+     * caller, which reads them with the usual path and reports its errors.
+     *
+     * @param requests The requests of the batch, with their status read.
+     * @throw std::system_error If the ring cannot be used anymore.
+     */
+    void load(std::vector<Request>& requests);
+
+    static constexpr std::size_t maxBatchSize = 64;        ///< Largest useful batch.
+    static constexpr std::uint64_t maxFileSize = 64 * 1024; ///< Largest file read whole through the ring.
+
+private:
+    /**
+     * @brief Returns a cleared submission queue entry at the tail of the queue.
+     */
+    io_uring_sqe* nextEntry();
+
+    /**
+     * @brief Submits the queued entries and waits for all their completions.
+     *
+     * @param count The number of queued entries.
+     * @throw std::system_error If the submission fails.
+     */
+    void submit(unsigned count);
+
+    int ringFd = -1;                  ///< The io_uring instance.
+    std::size_t batchSize;            ///< The largest number of requests in a batch.
+    void* submissionRing = nullptr;   ///< The mapping of the submission ring.
+    std::size_t submissionRingSize = 0; ///< The length of `submissionRing`.
+    void* completionRing = nullptr;   ///< The mapping of the completion ring, which may be the submission one.
+    std::size_t completionRingSize = 0; ///< The length of `completionRing`, or 0 if it is the submission one.
+    io_uring_sqe* entries = nullptr;  ///< The mapping of the submission queue entries.
+    std::size_t entriesSize = 0;      ///< The length of `entries`.
+    unsigned* submissionTail = nullptr;  ///< The tail of the submission ring, shared with the kernel.
+    unsigned* submissionArray = nullptr; ///< The indices of the queued entries.
+    unsigned submissionMask = 0;         ///< The mask of the submission ring indices.
+    unsigned queuedTail = 0;             ///< The tail including the entries not yet published.
+    unsigned* completionHead = nullptr;  ///< The head of the completion ring, shared with the kernel.
+    unsigned* completionTail = nullptr;  ///< The tail of the completion ring, shared with the kernel.
+    unsigned completionMask = 0;         ///< The mask of the completion ring indices.
+    io_uring_cqe* completionEntries = nullptr; ///< The completion queue entries.
+    std::vector<struct statx> statusBuffers;  ///< The status buffers of the requests of a batch.
+    std::vector<std::pair<std::uint64_t, std::int32_t>> completions; ///< The user data and results of the last submission.
+};
@@ -0,0 +1,137 @@
+/**
+ * @file Watcher.h
+ * @brief This file contains the declaration of the Watcher class.
+ *
+ * The Watcher class implements the `--watch` mode: it displays the explored directories once,
+ * then waits for inotify events and displays again only the files that were created or modified,
+ * until `SIGINT` or `SIGTERM` ends the run.
+ * Events are coalesced over a short debounce window, so a burst of writes to the same files
+ * displays them once. While nothing changes, the watcher sleeps in `poll` and does no work.
+ */
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DirectoryWalker.h"
+#include "FileExplorer.h"
+#include "IgnoreRules.h"
+#include "ThreadPool.h"
+
+class Matcher;
+struct inotify_event;
+
+/**
+ * @class Watcher
+ * @brief Displays the files of directory trees again as they change.
+ *
+ * Every directory found by the initial walk gets an inotify watch, together with the ignore rules
+ * in force in it, so the files reported by events are filtered exactly as the walk filters them.
+ * Directories created later are walked and watched when they appear. If the kernel event queue
+ * overflows, the trees are walked again and displayed in full.
+ */
+class Watcher {
+public:
+    /**
+     * @brief Creates the inotify instance and catches `SIGINT` and `SIGTERM`.
+     *
+     * @param roots The directories to watch. Repeated directories are watched once, and a directory
+     *              nested in another one is left out of the tree of the other one.
+     * @param matcher The pattern searched in the files, or `nullptr`. It must outlive the watcher.
+     * @throw std::system_error If inotify or the pipe cannot be initialized.
+     */
+    Watcher(const std::vector<std::string>& roots, const Matcher* matcher);
+
+    /**
+     * @brief Restores the signal actions and closes the inotify instance, which drops all the watches.
+     */
+    ~Watcher();
+
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+    /**
+     * @brief Displays the trees, then displays the changed files as they change, until interrupted.
+     *
+     * @param clearTerminal Whether the terminal is cleared before the changed files are displayed.
+     * @throw std::system_error If reading the events fails.
+     */
+    void run(bool clearTerminal);
+
+    static constexpr std::chrono::milliseconds debounceWindow{100}; ///< Quiet time that ends a burst of events.
+    static constexpr std::chrono::milliseconds maxDelay{1000};      ///< Longest time a change waits to be displayed.
+
+private:
+    /**
+     * @struct Directory
+     * @brief A watched directory.
+     */
+    struct Directory {
+        std::size_t root;                         ///< The index of the tree it belongs to.
+        std::string path;                         ///< The path of the directory.
+        std::string relativePath;                 ///< The path relative to the root of its tree.
+        std::shared_ptr<const IgnoreRules> rules; ///< The ignore rules in force for its entries.
+    };
+
+    /**
+     * @brief The changed files of every tree, sorted and without duplicates.
+     */
+    using Changes = std::vector<std::set<std::string>>;
+
+    /**
+     * @brief Adds a watch on a directory. It is called by the walker, possibly concurrently.
+     */
+    void addWatch(std::size_t root, const std::string& path, const std::string& relativePath,
+                  const std::shared_ptr<const IgnoreRules>& rules);
+
+    /**
+     * @brief Walks and watches every tree from scratch.
+     *
+     * @param changes Receives every file of the trees, or `nullptr`.
+     */
+    void rescan(Changes* changes);
+
+    /**
+     * @brief Walks and watches a directory that appeared in a watched directory.
+     *
+     * @param parent The watched directory holding it.
+     * @param name The name of the new directory.
+     * @param changes Receives the files of the new directory.
+     */
+    void watchNewDirectory(const Directory& parent, const std::string& name, Changes& changes);
+
+    /**
+     * @brief Blocks until a burst of events is over, and records the changes it brought.
+     *
+     * @param changes Receives the changed files.
+     * @return `true` if the trees must be walked again.
+     */
+    bool waitForChanges(Changes& changes);
+
+    /**
+     * @brief Records the change described by one event.
+     *
+     * @return `true` if the trees must be walked again.
+     */
+    bool handleEvent(const inotify_event& event, Changes& changes);
+
+    /**
+     * @brief Builds the filter of the walks of a tree, which leaves out the trees nested in it.
+     */
+    DirectoryWalker::Filter walkFilter(std::size_t root) const;
+
+    std::vector<FileExplorer::RootDirectory> roots; ///< The watched trees, without duplicates.
+    DirectoryWalker::Filter filter;          ///< The filter of the walks, applied to events too.
+    FileExplorer explorer;                   ///< Displays the changed files of every tree.
+    ThreadPool pool;                         ///< The pool running the walks and the display pipeline. It is destroyed first, so its tasks never outlive the explorer.
+    int inotifyFd;                           ///< The inotify instance.
+    int interruptFd = -1;                    ///< The end of the pipe written when `SIGINT` or `SIGTERM` is received.
+    bool interrupted = false;                ///< Whether the run was asked to stop.
+    std::mutex directoriesMutex;             ///< Guards `directories` while walkers add watches.
+    std::unordered_map<int, Directory> directories; ///< The watched directories, by watch descriptor.
+};
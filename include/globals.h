@@ -10,6 +10,9 @@
  */
 
 #pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
 
 #define SOFTWARE_NAME "mavu"
 #define SOFTWARE_COMMAND "mavu"
@@ -19,6 +22,63 @@
 #define SOFTWARE_LICENSE_HEADER "The MIT License (MIT)"
 #define SOFTWARE_COPYRIGHT_DATE "2025"
 
+/**
+ * @enum ClassifierMode
+ * @brief Selects how file contents are classified as text or binary.
+ */
+enum class ClassifierMode {
+    Fast,   ///< In-process sniffing only; libmagic is never used.
+    Magic,  ///< libmagic only, as in earlier versions.
+    Hybrid, ///< In-process sniffing, with libmagic for the content it cannot decide.
+};
+
+/**
+ * @enum StatsFormat
+ * @brief Selects how the statistics report is written.
+ */
+enum class StatsFormat {
+    Text, ///< One line per topic, for humans.
+    Json, ///< A single JSON object, for tools.
+};
+
+/**
+ * @enum OutputFormat
+ * @brief Selects how the files are written on the standard output.
+ */
+enum class OutputFormat {
+    Text,  ///< Colored headers followed by the content, for humans.
+    Jsonl, ///< One JSON object per file and per line.
+    Nul,   ///< The path and the content of every file, each followed by a NUL byte.
+    Raw,   ///< A length-prefixed header per file, followed by the unmodified content.
+};
+
+/**
+ * @enum BinaryEncoding
+ * @brief Selects how binary content is encoded in the `jsonl` and `nul` output formats.
+ */
+enum class BinaryEncoding {
+    Base64, ///< Standard base64, with padding.
+    Hex,    ///< The hexadecimal dump of the text format.
+};
+
+/**
+ * @enum HexStyle
+ * @brief Selects how binary content is displayed in the text output format.
+ */
+enum class HexStyle {
+    Plain,     ///< The bytes as a single line of `"xx "` tokens.
+    Canonical, ///< Rows of 16 bytes with their offset and characters, as `hexdump -C` does.
+};
+
+/**
+ * @enum IoBackend
+ * @brief Selects how the files of the exploration are opened and read.
+ */
+enum class IoBackend {
+    Threads, ///< Every worker thread opens and maps its own files.
+    Uring,   ///< Small files are opened, read and closed in batches through io_uring.
+};
+
 /**
  * @struct Configuration
  * @brief Stores configuration settings for the software.
@@ -43,4 +103,156 @@ struct Configuration {
      * during exploration; otherwise, they will be hidden. By default, this is set to false.
      */
     static bool showHiddenFiles;
+
+    /**
+     * @brief Static member variable that controls the number of worker threads.
+     * 
+     * This is the number of threads used to walk directories concurrently. It can be set with the
+     * `-j` option. By default, this is set to 0, meaning one thread per hardware thread.
+     */
+    static unsigned threadCount;
+
+    /**
+     * @brief Static member variable that controls the statistics report.
+     * 
+     * If set to true, statistics about the run are printed on the standard error stream at exit.
+     * It can be set with the `--stats` option. By default, this is set to false.
+     */
+    static bool showStats;
+
+    /**
+     * @brief Static member variable that selects the format of the statistics report.
+     * 
+     * It can be set with `--stats=text` or `--stats=json`. By default, this is set to
+     * `StatsFormat::Text`.
+     */
+    static StatsFormat statsFormat;
+
+    /**
+     * @brief Static member variable that selects how file contents are classified.
+     * 
+     * It can be set with the `--classifier` option. By default, this is set to
+     * `ClassifierMode::Hybrid`, meaning libmagic is only used when in-process sniffing cannot decide.
+     */
+    static ClassifierMode classifierMode;
+
+    /**
+     * @brief Static member variable that controls the persistent classification cache.
+     * 
+     * If set to true, classification results are read from and written to the cache file, so
+     * unchanged files are not classified again. It can be disabled with the `--no-cache` option.
+     * By default, this is set to true.
+     */
+    static bool useCache;
+
+    /**
+     * @brief Static member variable that controls the ignore files.
+     * 
+     * If set to true, the patterns of the `.gitignore` and `.ignore` files found while walking are
+     * applied to the directory holding them and its subdirectories, and ignored directories are not
+     * walked at all. It can be disabled with the `--no-ignore` option. By default, this is set to true.
+     */
+    static bool useIgnoreFiles;
+
+    /**
+     * @brief Static member variable that lists the globs of the files and directories to exclude.
+     * 
+     * The globs follow the syntax of `.gitignore` patterns, relative to the explored directory.
+     * They are added with the `--exclude` option. By default, the list is empty.
+     */
+    static std::vector<std::string> excludeGlobs;
+
+    /**
+     * @brief Static member variable that lists the globs of the files to display.
+     * 
+     * If the list is not empty, only the files matching one of the globs are displayed. The globs
+     * follow the syntax of `.gitignore` patterns. They are added with the `--include` option.
+     * By default, the list is empty.
+     */
+    static std::vector<std::string> includeGlobs;
+
+    /**
+     * @brief Static member variable that selects the format of the output.
+     * 
+     * It can be set with the `--format` option. By default, this is set to `OutputFormat::Text`.
+     */
+    static OutputFormat outputFormat;
+
+    /**
+     * @brief Static member variable that selects the encoding of binary content in structured formats.
+     * 
+     * It can be set with the `--binary-encoding` option. By default, this is set to
+     * `BinaryEncoding::Base64`.
+     */
+    static BinaryEncoding binaryEncoding;
+
+    /**
+     * @brief Static member variable that selects how binary content is displayed as text.
+     * 
+     * It can be set with the `--hex-style` option. By default, this is set to `HexStyle::Plain`.
+     */
+    static HexStyle hexStyle;
+
+    /**
+     * @brief Static member variable that limits the number of bytes displayed per file.
+     * 
+     * If not zero, at most this many bytes of each file are displayed: the first ones, or the
+     * last ones with `--tail`. It can be set with the `--max-bytes` option. By default, this is
+     * set to 0, meaning no limit.
+     */
+    static std::uint64_t maxBytes;
+
+    /**
+     * @brief Static member variable that limits the display to the first lines of each file.
+     * 
+     * If not zero, only this many lines are displayed from the start of each file; binary files
+     * count rows of 16 bytes. It can be set with the `--head` option. By default, this is set to
+     * 0, meaning no limit.
+     */
+    static std::uint64_t headLines;
+
+    /**
+     * @brief Static member variable that limits the display to the last lines of each file.
+     * 
+     * If not zero, only this many lines are displayed from the end of each file; binary files
+     * count rows of 16 bytes. It can be set with the `--tail` option. By default, this is set to
+     * 0, meaning no limit.
+     */
+    static std::uint64_t tailLines;
+
+    /**
+     * @brief Static member variable that selects how the files are opened and read.
+     * 
+     * It can be set with the `--io` option. By default, this is set to `IoBackend::Threads`.
+     * When io_uring is not available, `IoBackend::Uring` falls back to the worker threads.
+     */
+    static IoBackend ioBackend;
+
+    /**
+     * @brief Static member variable that controls the deduplication of contents.
+     * 
+     * If set to true, files with the same content are displayed once, under the path of the first
+     * of them, with the list of the others. It can be enabled with the `--dedupe` option. By
+     * default, this is set to false.
+     */
+    static bool dedupe;
+
+    /**
+     * @brief Static member variable that controls the decompression of compressed files.
+     * 
+     * If set to true, gzip, xz and bzip2 files, recognized by their magic number, are displayed
+     * decompressed, and their extensions no longer hide them as binary. It can be enabled with
+     * the `-z` option. By default, this is set to false.
+     */
+    static bool decompress;
+
+    /**
+     * @brief Static member variable that controls the exploration of archives.
+     * 
+     * If set to true, tar archives, plain or compressed, and zip archives are explored like
+     * directories: their regular files are displayed under the path of the archive followed by
+     * `!/` and their name. It can be enabled with the `--archives` option. By default, this is
+     * set to false.
+     */
+    static bool exploreArchives;
 };
@@ -0,0 +1,719 @@
+/**
+ * @file Archive.cpp
+ * @headerfile Archive.h
+ * @brief This file contains the implementation of the Archive class.
+ *
+ * The Archive class implements the `--archives` option: it lists the members of tar and zip
+ * archives and reads their content on demand. A tar archive is a sequence of 512-byte headers,
+ * each followed by the content of its member padded to a whole block; plain archives are read
+ * header by header with `pread`, skipping the contents, while compressed ones are decompressed
+ * as a stream. A zip archive ends with a central directory listing every member with the offset
+ * of its local header, so the listing only reads the end of the file. Member contents are read
+ * in chunks, and deflated zip members are inflated chunk by chunk with zlib.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <zlib.h>
+#include "globals.h"
+#include "Archive.h"
+#include "Profiler.h"
+
+namespace {
+
+/**
+ * @brief The extensions of the archives explored by `--archives`, lowercase.
+ */
+constexpr std::string_view archiveExtensions[] = {".tar", ".tar.bz2", ".tar.gz", ".tar.xz", ".tbz2", ".tgz", ".txz", ".zip"};
+
+constexpr std::size_t zipEndSize = 22;            ///< The size of the end of central directory record, without its comment.
+constexpr std::size_t zipMaxCommentSize = 65535;  ///< The largest comment of a zip archive.
+constexpr std::size_t zip64LocatorSize = 20;      ///< The size of the zip64 end of central directory locator.
+constexpr std::size_t zip64EndSize = 56;          ///< The size of the zip64 end of central directory record.
+constexpr std::size_t zipEntrySize = 46;          ///< The size of a central directory entry, without its variable fields.
+constexpr std::size_t zipLocalHeaderSize = 30;    ///< The size of a local header, without its variable fields.
+constexpr std::uint64_t maxMetadataSize = 1 << 20; ///< The largest GNU long name or pax header read.
+
+/**
+ * @brief Reads a little-endian 16-bit integer.
+ */
+std::uint16_t read16(const char* data) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<std::uint16_t>(bytes[0] | bytes[1] << 8);
+}
+
+/**
+ * @brief Reads a little-endian 32-bit integer.
+ */
+std::uint32_t read32(const char* data) {
+    return read16(data) | static_cast<std::uint32_t>(read16(data + 2)) << 16;
+}
+
+/**
+ * @brief Reads a little-endian 64-bit integer.
+ */
+std::uint64_t read64(const char* data) {
+    return read32(data) | static_cast<std::uint64_t>(read32(data + 4)) << 32;
+}
+
+/**
+ * @brief Returns a NUL-terminated field of a tar header.
+ */
+std::string_view tarField(const char* header, std::size_t offset, std::size_t length) {
+    const char* field = header + offset;
+    return std::string_view(field, static_cast<std::size_t>(std::find(field, field + length, '\0') - field));
+}
+
+/**
+ * @brief Parses a numeric field of a tar header: octal, or base-256 for large values (GNU).
+ *
+ * @throw std::runtime_error If the field is not a number.
+ */
+std::uint64_t tarNumber(const char* header, std::size_t offset, std::size_t length) {
+    const auto* field = reinterpret_cast<const unsigned char*>(header + offset);
+    std::uint64_t value = 0;
+    if (field[0] & 0x80) {
+        value = field[0] & 0x7f;
+        for (std::size_t i = 1; i < length; ++i) {
+            value = value << 8 | field[i];
+        }
+        return value;
+    }
+    std::size_t i = 0;
+    for (; i < length && field[i] == ' '; ++i) {
+    }
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = value << 3 | static_cast<std::uint64_t>(field[i] - '0');
+    }
+    if (i < length && field[i] != ' ' && field[i] != '\0') {
+        throw std::runtime_error("Corrupt tar header");
+    }
+    return value;
+}
+
+/**
+ * @brief Checks the checksum of a tar header, computed with unsigned or, like old archivers, signed bytes.
+ */
+bool hasValidChecksum(const char* header) {
+    std::uint64_t expected = tarNumber(header, 148, 8);
+    std::uint64_t sum = 0;
+    std::int64_t signedSum = 0;
+    for (std::size_t i = 0; i < Archive::blockSize; ++i) {
+        char byte = i >= 148 && i < 156 ? ' ' : header[i];
+        sum += static_cast<unsigned char>(byte);
+        signedSum += static_cast<signed char>(byte);
+    }
+    return sum == expected || static_cast<std::uint64_t>(signedSum) == expected;
+}
+
+/**
+ * @brief Reads the path and the size of the records of a pax extended header.
+ *
+ * Records are written `<length> <key>=<value>\n`, the length counting the whole record.
+ *
+ * @param data The content of the header.
+ * @param path Receives the path, if the header holds one.
+ * @param hasPath Set if the header holds a path.
+ * @param size Receives the size, if the header holds one.
+ * @param hasSize Set if the header holds a size.
+ */
+void readPaxRecords(std::string_view data, std::string& path, bool& hasPath, std::uint64_t& size, bool& hasSize) {
+    while (!data.empty()) {
+        std::size_t space = data.find(' ');
+        std::uint64_t length = 0;
+        for (std::size_t i = 0; i < space && i < data.size(); ++i) {
+            if (data[i] < '0' || data[i] > '9') {
+                throw std::runtime_error("Corrupt pax header");
+            }
+            length = length * 10 + static_cast<std::uint64_t>(data[i] - '0');
+        }
+        if (space == std::string_view::npos || length <= space + 1 || length > data.size()) {
+            throw std::runtime_error("Corrupt pax header");
+        }
+        std::string_view record = data.substr(space + 1, static_cast<std::size_t>(length) - space - 1);
+        data.remove_prefix(static_cast<std::size_t>(length));
+        if (!record.empty() && record.back() == '\n') {
+            record.remove_suffix(1);
+        }
+        std::size_t equal = record.find('=');
+        std::string_view key = record.substr(0, equal);
+        std::string_view value = equal == std::string_view::npos ? std::string_view() : record.substr(equal + 1);
+        if (key == "path") {
+            path = std::string(value);
+            hasPath = true;
+        } else if (key == "size") {
+            size = 0;
+            for (char digit : value) {
+                size = size * 10 + static_cast<std::uint64_t>(digit - '0');
+            }
+            hasSize = true;
+        }
+    }
+}
+
+/**
+ * @brief Removes the leading `./` and `/` of a member name, so that it reads as a relative path.
+ */
+std::string relativeName(std::string name) {
+    std::size_t start = 0;
+    while (start < name.size()) {
+        if (name[start] == '/') {
+            ++start;
+        } else if (name.compare(start, 2, "./") == 0) {
+            start += 2;
+        } else {
+            break;
+        }
+    }
+    return name.substr(start);
+}
+
+/**
+ * @class MemberReader
+ * @brief Reads the content of a member of an archive in chunks.
+ *
+ * Members of plain tar archives and stored zip members are read with `pread` at their offset.
+ * Members of compressed tar archives are reached by decompressing the archive up to them, and
+ * deflated zip members are inflated as they are read.
+ */
+class MemberReader : public ChunkSource {
+public:
+    /**
+     * @brief Opens the content of a member.
+     *
+     * @param archivePath The path of the archive.
+     * @param member The member.
+     * @throw std::filesystem::filesystem_error If the archive cannot be opened.
+     * @throw std::runtime_error If the member cannot be read.
+     */
+    MemberReader(const std::string& archivePath, const Archive::Member& member) : left(member.size) {
+        if (member.format == Archive::Format::Tar && member.compression != Compression::None) {
+            decompressor = std::make_unique<Decompressor>(archivePath, member.compression);
+            for (std::uint64_t skipped = 0; skipped < member.offset;) {
+                if (!decompressor->next(pending)) {
+                    throw std::runtime_error("Truncated tar archive");
+                }
+                std::size_t used = static_cast<std::size_t>(std::min<std::uint64_t>(pending.size(), member.offset - skipped));
+                pending.remove_prefix(used);
+                skipped += used;
+            }
+            return;
+        }
+
+        fd = open(archivePath.c_str(), O_RDONLY | O_CLOEXEC);
+        Profiler::count(Profiler::Counter::ReadCalls);
+        if (fd < 0) {
+            throw std::filesystem::filesystem_error("Cannot open file", std::filesystem::path(archivePath),
+                                                    std::error_code(errno, std::system_category()));
+        }
+        try {
+            buffer = std::make_unique<char[]>(FileReader::chunkSize);
+            offset = member.offset;
+            if (member.format == Archive::Format::Zip) {
+                openZipMember(member);
+            }
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+    }
+
+    ~MemberReader() override {
+        if (inflating) {
+            inflateEnd(&inflater);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    MemberReader(const MemberReader&) = delete;
+    MemberReader& operator=(const MemberReader&) = delete;
+
+    /**
+     * @brief Reads the next chunk of the content.
+     *
+     * @param chunk Receives a view of the chunk, valid until the next call; empty at the end.
+     * @return `true` if a chunk was read, `false` at the end of the content.
+     * @throw std::runtime_error If the archive ends before the member.
+     */
+    bool next(std::string_view& chunk) override {
+        if (left == 0) {
+            chunk = {};
+            return false;
+        }
+        std::size_t size = 0;
+        if (decompressor != nullptr) {
+            if (pending.empty() && !decompressor->next(pending)) {
+                throw std::runtime_error("Truncated tar archive");
+            }
+            size = static_cast<std::size_t>(std::min<std::uint64_t>(pending.size(), left));
+            chunk = pending.substr(0, size);
+            pending.remove_prefix(size);
+        } else if (inflating) {
+            size = inflateChunk();
+            chunk = std::string_view(buffer.get(), size);
+        } else {
+            std::size_t wanted = static_cast<std::size_t>(std::min<std::uint64_t>(FileReader::chunkSize, left));
+            size = FileReader::readAt(fd, offset, buffer.get(), wanted);
+            if (size < wanted) {
+                throw std::runtime_error("Truncated archive");
+            }
+            offset += size;
+            chunk = std::string_view(buffer.get(), size);
+        }
+        left -= size;
+        return true;
+    }
+
+private:
+    /**
+     * @brief Finds the content of a zip member after its local header, and prepares its inflation.
+     */
+    void openZipMember(const Archive::Member& member) {
+        if (member.encrypted) {
+            throw std::runtime_error("Encrypted zip member");
+        }
+        if (member.method != 0 && member.method != 8) {
+            throw std::runtime_error("Unsupported zip compression method " + std::to_string(member.method));
+        }
+        char header[zipLocalHeaderSize];
+        if (FileReader::readAt(fd, offset, header, sizeof(header)) < sizeof(header) || std::memcmp(header, "PK\3\4", 4) != 0) {
+            throw std::runtime_error("Corrupt zip local header");
+        }
+        offset += zipLocalHeaderSize + read16(header + 26) + read16(header + 28);
+        if (member.deflated) {
+            // Negative window bits select raw deflate data, without a zlib wrapper
+            if (inflateInit2(&inflater, -15) != Z_OK) {
+                throw std::runtime_error("Cannot initialize the decompressor");
+            }
+            inflating = true;
+            packedLeft = member.packedSize;
+            input = std::make_unique<char[]>(FileReader::chunkSize);
+        }
+    }
+
+    /**
+     * @brief Inflates the next chunk of a deflated zip member into the buffer.
+     *
+     * @return The number of bytes produced.
+     */
+    std::size_t inflateChunk() {
+        std::size_t room = static_cast<std::size_t>(std::min<std::uint64_t>(FileReader::chunkSize, left));
+        inflater.next_out = reinterpret_cast<Bytef*>(buffer.get());
+        inflater.avail_out = static_cast<uInt>(room);
+        while (inflater.avail_out > 0) {
+            if (inflater.avail_in == 0 && packedLeft > 0) {
+                std::size_t wanted = static_cast<std::size_t>(std::min<std::uint64_t>(FileReader::chunkSize, packedLeft));
+                std::size_t read = FileReader::readAt(fd, offset, input.get(), wanted);
+                offset += read;
+                packedLeft = read < wanted ? 0 : packedLeft - read;
+                inflater.next_in = reinterpret_cast<Bytef*>(input.get());
+                inflater.avail_in = static_cast<uInt>(read);
+            }
+            Profiler::ScopedTimer timer(Profiler::Stage::Decompress);
+            uInt before = inflater.avail_out;
+            int result = ::inflate(&inflater, Z_NO_FLUSH);
+            if (result == Z_STREAM_END || (result == Z_BUF_ERROR && inflater.avail_out == before && packedLeft == 0)) {
+                break;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("Corrupt deflate data: ") + (inflater.msg != nullptr ? inflater.msg : "invalid data"));
+            }
+        }
+        std::size_t produced = room - inflater.avail_out;
+        if (produced == 0) {
+            throw std::runtime_error("Truncated zip member");
+        }
+        return produced;
+    }
+
+    int fd = -1;                                ///< The archive, unless it is a compressed tar archive.
+    std::uint64_t offset = 0;                   ///< The offset of the next bytes to read in the archive.
+    std::uint64_t left;                         ///< The bytes of the content not yet returned.
+    std::unique_ptr<char[]> buffer;             ///< The chunk buffer, reused for every chunk.
+    std::unique_ptr<Decompressor> decompressor; ///< The decompressed content of a compressed tar archive.
+    std::string_view pending;                   ///< Decompressed bytes not yet returned.
+    bool inflating = false;                     ///< Whether the member is deflated.
+    z_stream inflater = {};                     ///< The state of zlib for deflated members.
+    std::uint64_t packedLeft = 0;               ///< The compressed bytes not yet read.
+    std::unique_ptr<char[]> input;              ///< The compressed bytes being inflated.
+};
+
+} // namespace
+
+/**
+ * @brief Checks whether a file name ends with the extension of an archive, whatever its case.
+ *
+ * @param fileName The name of the file, without directories.
+ */
+bool Archive::hasArchiveExtension(std::string_view fileName) {
+    for (std::string_view extension : archiveExtensions) {
+        // A leading dot does not start an extension
+        if (fileName.size() > extension.size()
+            && std::equal(extension.begin(), extension.end(), fileName.end() - extension.size(), [](char left, char right) {
+                   return left == std::tolower(static_cast<unsigned char>(right));
+               })) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the path under which a member of an archive is displayed.
+ *
+ * @param archivePath The path of the archive.
+ * @param name The name of the member in the archive.
+ * @return `archivePath!/name`.
+ */
+std::string Archive::memberPath(std::string_view archivePath, std::string_view name) {
+    std::string path;
+    path.reserve(archivePath.size() + 2 + name.size());
+    path.append(archivePath).append("!/").append(name);
+    return path;
+}
+
+/**
+ * @brief Opens an archive and recognizes its format from its first bytes.
+ *
+ * Compressed files are taken for compressed tar archives, files starting with a zip local
+ * header (or the end record of an empty zip archive) for zip archives, and files starting with
+ * a valid tar header for plain tar archives.
+ *
+ * @param filePath The path of the archive.
+ */
+Archive::Archive(const std::string& filePath) {
+    fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    Profiler::count(Profiler::Counter::ReadCalls);
+    if (fd < 0) {
+        throw std::filesystem::filesystem_error("Cannot open file", std::filesystem::path(filePath),
+                                                std::error_code(errno, std::system_category()));
+    }
+    try {
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            throw std::system_error(errno, std::system_category(), "stat failed");
+        }
+        fileSize = static_cast<std::uint64_t>(info.st_size);
+        char head[blockSize];
+        std::size_t size = FileReader::readAt(fd, 0, head, sizeof(head));
+        compression = Decompressor::detect(std::string_view(head, size));
+        if (compression != Compression::None) {
+            decompressor = std::make_unique<Decompressor>(filePath, compression);
+        } else if (size >= 4 && (std::memcmp(head, "PK\3\4", 4) == 0 || std::memcmp(head, "PK\5\6", 4) == 0)) {
+            format = Format::Zip;
+            readCentralDirectory();
+        } else if (size < blockSize || !hasValidChecksum(head)) {
+            throw std::runtime_error("Not a tar or zip archive");
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+}
+
+/**
+ * @brief Closes the archive.
+ */
+Archive::~Archive() {
+    close(fd);
+}
+
+/**
+ * @brief Finds the next regular file of the archive.
+ *
+ * @param member Receives the member.
+ * @return `true` if a member was found, `false` at the end of the archive.
+ */
+bool Archive::next(Member& member) {
+    return format == Format::Zip ? nextZip(member) : nextTar(member);
+}
+
+/**
+ * @brief Reads the content of the member found last, if it comes from a compressed tar archive.
+ *
+ * @param content Receives the content.
+ * @return `true` if the content was read.
+ */
+bool Archive::hold(std::string& content) {
+    if (!holdable || decompressor == nullptr || memberSize > maxHeldSize) {
+        return false;
+    }
+    holdable = false;
+    content.resize(static_cast<std::size_t>(memberSize));
+    if (read(content.data(), content.size()) < content.size()) {
+        throw std::runtime_error("Truncated tar archive");
+    }
+    unread -= memberSize;
+    return true;
+}
+
+/**
+ * @brief Opens the content of a member for reading.
+ *
+ * @param archivePath The path of the archive.
+ * @param member The member.
+ * @return The content of the member.
+ */
+std::unique_ptr<ChunkSource> Archive::openMember(const std::string& archivePath, const Member& member) {
+    return std::make_unique<MemberReader>(archivePath, member);
+}
+
+/**
+ * @brief Reads bytes of a tar archive at the current position.
+ *
+ * @param buffer Receives the bytes.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read.
+ */
+std::size_t Archive::read(char* buffer, std::size_t size) {
+    std::size_t done = 0;
+    if (decompressor == nullptr) {
+        done = FileReader::readAt(fd, position, buffer, size);
+    } else {
+        while (done < size && (!pending.empty() || decompressor->next(pending))) {
+            std::size_t used = std::min(pending.size(), size - done);
+            std::memcpy(buffer + done, pending.data(), used);
+            pending.remove_prefix(used);
+            done += used;
+        }
+    }
+    position += done;
+    return done;
+}
+
+/**
+ * @brief Skips bytes of a tar archive.
+ *
+ * Plain archives are not read at all: the position moves past the bytes.
+ *
+ * @param size The number of bytes to skip.
+ */
+void Archive::skip(std::uint64_t size) {
+    if (decompressor == nullptr) {
+        if (size > fileSize - std::min(position, fileSize)) {
+            throw std::runtime_error("Truncated tar archive");
+        }
+        position += size;
+        return;
+    }
+    while (size > 0) {
+        if (pending.empty() && !decompressor->next(pending)) {
+            throw std::runtime_error("Truncated tar archive");
+        }
+        std::size_t used = static_cast<std::size_t>(std::min<std::uint64_t>(pending.size(), size));
+        pending.remove_prefix(used);
+        size -= used;
+        position += used;
+    }
+}
+
+/**
+ * @brief Finds the next regular file of a tar archive.
+ *
+ * The content of the previous member is skipped first. GNU long names (`L`) and pax extended
+ * headers (`x`) apply to the next member; global pax headers and GNU long link names are
+ * ignored. An empty block ends the archive.
+ *
+ * @param member Receives the member.
+ * @return `true` if a member was found.
+ */
+bool Archive::nextTar(Member& member) {
+    skip(unread);
+    unread = 0;
+    holdable = false;
+    std::string name;
+    bool hasName = false;
+    std::uint64_t paxSize = 0;
+    bool hasPaxSize = false;
+    char header[blockSize];
+    for (;;) {
+        std::size_t size = read(header, blockSize);
+        if (size == 0 || std::all_of(header, header + size, [](char byte) { return byte == '\0'; })) {
+            return false;
+        }
+        if (size < blockSize) {
+            throw std::runtime_error("Truncated tar archive");
+        }
+        if (!hasValidChecksum(header)) {
+            throw std::runtime_error("Corrupt tar header");
+        }
+        std::uint64_t contentSize = tarNumber(header, 124, 12);
+        char type = header[156];
+        if (type == 'L' || type == 'K' || type == 'x' || type == 'g') {
+            // Metadata about the next member
+            if (contentSize > maxMetadataSize) {
+                throw std::runtime_error("Corrupt tar header");
+            }
+            std::string data(static_cast<std::size_t>(contentSize), '\0');
+            if (read(data.data(), data.size()) < data.size()) {
+                throw std::runtime_error("Truncated tar archive");
+            }
+            skip((blockSize - contentSize % blockSize) % blockSize);
+            if (type == 'L') {
+                name = std::string(data.c_str());
+                hasName = true;
+            } else if (type == 'x') {
+                readPaxRecords(data, name, hasName, paxSize, hasPaxSize);
+            }
+            continue;
+        }
+        if (hasPaxSize) {
+            contentSize = paxSize;
+        }
+        std::uint64_t padded = (contentSize + blockSize - 1) / blockSize * blockSize;
+        if (type != '0' && type != '\0' && type != '7') {
+            // Directories, links and special files have no content to display
+            skip(padded);
+            name.clear();
+            hasName = false;
+            hasPaxSize = false;
+            continue;
+        }
+        if (!hasName) {
+            name = std::string(tarField(header, 0, 100));
+            // POSIX ustar headers split long names into a prefix and a name
+            std::string_view prefix = tarField(header, 345, 155);
+            if (std::memcmp(header + 257, "ustar\0", 6) == 0 && !prefix.empty()) {
+                name = std::string(prefix) + "/" + name;
+            }
+        }
+        member = Member();
+        member.name = relativeName(std::move(name));
+        member.size = contentSize;
+        member.offset = position;
+        member.format = Format::Tar;
+        member.compression = compression;
+        unread = padded;
+        memberSize = contentSize;
+        holdable = true;
+        if (member.name.empty()) {
+            return nextTar(member);
+        }
+        return true;
+    }
+}
+
+/**
+ * @brief Reads the central directory of a zip archive.
+ *
+ * The end of central directory record is searched backwards from the end of the file, past
+ * the comment of the archive; when one of its fields is saturated, the zip64 record it points
+ * to holds the real values.
+ */
+void Archive::readCentralDirectory() {
+    std::size_t tailSize = static_cast<std::size_t>(std::min<std::uint64_t>(fileSize, zipEndSize + zipMaxCommentSize));
+    std::string tail(tailSize, '\0');
+    tail.resize(FileReader::readAt(fd, fileSize - tailSize, tail.data(), tailSize));
+    std::size_t end = std::string::npos;
+    for (std::size_t i = tail.size() >= zipEndSize ? tail.size() - zipEndSize + 1 : 0; i-- > 0;) {
+        if (tail.compare(i, 4, "PK\5\6") == 0) {
+            end = i;
+            break;
+        }
+    }
+    if (end == std::string::npos) {
+        throw std::runtime_error("Corrupt zip archive: no central directory");
+    }
+    const char* record = tail.data() + end;
+    std::uint64_t entries = read16(record + 10);
+    std::uint64_t size = read32(record + 12);
+    std::uint64_t offset = read32(record + 16);
+    if ((entries == 0xffff || size == 0xffffffff || offset == 0xffffffff) && end >= zip64LocatorSize
+        && tail.compare(end - zip64LocatorSize, 4, "PK\6\7") == 0) {
+        char zip64End[zip64EndSize];
+        std::uint64_t zip64Offset = read64(tail.data() + end - zip64LocatorSize + 8);
+        if (FileReader::readAt(fd, zip64Offset, zip64End, sizeof(zip64End)) < sizeof(zip64End)
+            || std::memcmp(zip64End, "PK\6\6", 4) != 0) {
+            throw std::runtime_error("Corrupt zip64 archive");
+        }
+        entries = read64(zip64End + 32);
+        size = read64(zip64End + 40);
+        offset = read64(zip64End + 48);
+    }
+    if (offset > fileSize || size > fileSize - offset) {
+        throw std::runtime_error("Corrupt zip archive: central directory out of the file");
+    }
+    directory.resize(static_cast<std::size_t>(size));
+    if (FileReader::readAt(fd, offset, directory.data(), directory.size()) < directory.size()) {
+        throw std::runtime_error("Truncated zip archive");
+    }
+    entriesLeft = entries;
+    entry = 0;
+}
+
+/**
+ * @brief Finds the next regular file in the central directory of a zip archive.
+ *
+ * Directories (names ending with a slash) and Unix symbolic links are skipped. Sizes and
+ * offsets saturated in the entry are read from its zip64 extra field.
+ *
+ * @param member Receives the member.
+ * @return `true` if a member was found.
+ */
+bool Archive::nextZip(Member& member) {
+    while (entriesLeft > 0) {
+        --entriesLeft;
+        if (directory.size() - entry < zipEntrySize || directory.compare(entry, 4, "PK\1\2") != 0) {
+            throw std::runtime_error("Corrupt zip central directory");
+        }
+        const char* fields = directory.data() + entry;
+        std::size_t nameSize = read16(fields + 28);
+        std::size_t extraSize = read16(fields + 30);
+        std::size_t commentSize = read16(fields + 32);
+        if (directory.size() - entry - zipEntrySize < nameSize + extraSize + commentSize) {
+            throw std::runtime_error("Corrupt zip central directory");
+        }
+        entry += zipEntrySize + nameSize + extraSize + commentSize;
+
+        std::string name(fields + zipEntrySize, nameSize);
+        bool isUnix = static_cast<unsigned char>(fields[5]) == 3;
+        std::uint32_t mode = read32(fields + 38) >> 16;
+        if (name.empty() || name.back() == '/' || (isUnix && (mode & S_IFMT) == S_IFLNK)) {
+            continue;
+        }
+        member = Member();
+        member.name = relativeName(std::move(name));
+        member.method = read16(fields + 10);
+        member.deflated = member.method == 8;
+        member.encrypted = (read16(fields + 8) & 1) != 0;
+        member.packedSize = read32(fields + 20);
+        member.size = read32(fields + 24);
+        member.offset = read32(fields + 42);
+        member.format = Format::Zip;
+
+        // The zip64 extra field holds the saturated values, in this order
+        std::string_view extra(fields + zipEntrySize + nameSize, extraSize);
+        while (extra.size() >= 4) {
+            std::size_t id = read16(extra.data());
+            std::size_t length = std::min<std::size_t>(read16(extra.data() + 2), extra.size() - 4);
+            if (id == 1) {
+                std::string_view values = extra.substr(4, length);
+                for (std::uint64_t* value : {&member.size, &member.packedSize, &member.offset}) {
+                    if (*value == 0xffffffff && values.size() >= 8) {
+                        *value = read64(values.data());
+                        values.remove_prefix(8);
+                    }
+                }
+            }
+            extra.remove_prefix(4 + length);
+        }
+        if (member.name.empty()) {
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
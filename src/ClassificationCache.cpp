@@ -0,0 +1,431 @@
+/**
+ * @file ClassificationCache.cpp
+ * @headerfile ClassificationCache.h
+ * @brief This file contains the implementation of the ClassificationCache class.
+ *
+ * The ClassificationCache class remembers, from one run to the next, whether files hold text or
+ * binary content. Files are identified by their device, inode, size and modification time, so a
+ * file that has not changed since the previous run is not read nor handed to libmagic again.
+ *
+ * The cache file is a fixed-size header followed by fixed-size records: first a table sorted by
+ * key, then a journal of records appended by later runs in no particular order. The table is
+ * used in place from a read-only mapping of the file; only the journal is copied and sorted when
+ * the cache is loaded, and it is kept small by compacting the file when it grows. Every record
+ * found by a lookup is flagged, so a compaction of an oversized cache can keep only the records
+ * of the files still in use.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <magic.h>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+#include "globals.h"
+#include "ClassificationCache.h"
+
+namespace {
+
+/**
+ * @struct Header
+ * @brief The header of the cache file.
+ */
+struct Header {
+    char signature[8];          ///< Always `fileSignature`.
+    std::uint32_t version;      ///< The version of the format, `formatVersion`.
+    std::uint32_t recordSize;   ///< The size of a record, checked against `sizeof(Record)`.
+    std::uint64_t tableCount;   ///< The number of records in the sorted table.
+    std::uint64_t magicVersion; ///< The version of libmagic the results were computed with.
+    std::uint8_t reserved[32];  ///< Zero.
+};
+
+/**
+ * @struct Record
+ * @brief The classification result of a file in a given state.
+ */
+struct Record {
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t size;
+    std::int64_t mtimeNs;
+    std::uint8_t mode;         ///< The `ClassifierMode` the result was computed with.
+    std::uint8_t isText;       ///< 1 for text, 0 for binary.
+    std::uint8_t reserved[6];  ///< Zero.
+};
+
+static_assert(sizeof(Header) == 64, "the cache header must keep its on-disk size");
+static_assert(sizeof(Record) == 40, "cache records must keep their on-disk size");
+
+constexpr char fileSignature[8] = {'m', 'a', 'v', 'u', 'c', 'c', 'h', '\0'};
+constexpr std::uint32_t formatVersion = 1;
+
+/**
+ * @brief Orders records by file, then by state. Records of the same file end up next to each other.
+ */
+bool operator<(const Record& lhs, const Record& rhs) {
+    return std::tie(lhs.device, lhs.inode, lhs.mode, lhs.size, lhs.mtimeNs)
+         < std::tie(rhs.device, rhs.inode, rhs.mode, rhs.size, rhs.mtimeNs);
+}
+
+/**
+ * @brief Checks whether two records describe the same file, whatever its state.
+ */
+bool sameFile(const Record& lhs, const Record& rhs) {
+    return lhs.device == rhs.device && lhs.inode == rhs.inode && lhs.mode == rhs.mode;
+}
+
+/**
+ * @brief Builds the record of a key in the current classifier mode.
+ */
+Record makeRecord(const ClassificationCache::Key& key, bool isText) {
+    Record record{};
+    record.device = key.device;
+    record.inode = key.inode;
+    record.size = key.size;
+    record.mtimeNs = key.mtimeNs;
+    record.mode = static_cast<std::uint8_t>(Configuration::classifierMode);
+    record.isText = isText ? 1 : 0;
+    return record;
+}
+
+/**
+ * @brief Binary-searches a sorted range of records.
+ */
+const Record* find(const Record* begin, const Record* end, const Record& wanted) {
+    const Record* found = std::lower_bound(begin, end, wanted);
+    return found != end && !(wanted < *found) ? found : nullptr;
+}
+
+/**
+ * @brief Writes a whole buffer, retrying after partial writes.
+ */
+bool writeAll(int fd, const void* data, std::size_t length) {
+    const char* current = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t written = write(fd, current, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        current += written;
+        length -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool enabled = false;                 ///< Whether the cache has been loaded.
+std::string cacheFile;                ///< The path of the cache file.
+bool rewriteNeeded = false;           ///< Whether the file is invalid and must be rewritten, not appended to.
+std::int64_t racyLimitNs = 0;         ///< Files modified after this time are not cached.
+const Record* table = nullptr;        ///< The sorted table, inside the mapping.
+std::size_t tableCount = 0;           ///< The number of records in the table.
+std::vector<Record> journal;          ///< The journal of the file, sorted.
+std::vector<std::atomic<bool>> tableUsed;   ///< Whether each record of the table was found during the run.
+std::vector<std::atomic<bool>> journalUsed; ///< Whether each record of `journal` was found during the run.
+std::size_t journalCount = 0;         ///< The number of records in the journal of the file.
+std::mutex pendingMutex;              ///< Protects `pending`.
+std::vector<Record> pending;          ///< Records stored during the run, not saved yet.
+std::atomic<std::uint64_t> hitCount{0};    ///< Lookups answered by the cache.
+std::atomic<std::uint64_t> missCount{0};   ///< Lookups of unknown files.
+std::atomic<std::uint64_t> storedCount{0}; ///< Records stored during the run.
+bool compacted = false;               ///< Whether `save` rewrote the file.
+
+/**
+ * @brief Checks whether a record was looked up or stored during the run.
+ *
+ * Records that are neither in the table nor in the journal were stored during the run.
+ */
+bool usedDuringRun(const Record& record) {
+    const Record* inJournal = find(journal.data(), journal.data() + journal.size(), record);
+    const Record* inTable = table != nullptr ? find(table, table + tableCount, record) : nullptr;
+    if (inJournal == nullptr && inTable == nullptr) {
+        return true;
+    }
+    return (inJournal != nullptr && journalUsed[static_cast<std::size_t>(inJournal - journal.data())].load(std::memory_order_relaxed))
+        || (inTable != nullptr && tableUsed[static_cast<std::size_t>(inTable - table)].load(std::memory_order_relaxed));
+}
+
+} // namespace
+
+/**
+ * @brief Returns the path of the default cache file, or an empty string if unknown.
+ */
+std::string ClassificationCache::defaultPath() {
+    if (const char* cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome != nullptr && *cacheHome != '\0') {
+        return std::string(cacheHome) + "/mavu/classification.cache";
+    }
+    if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+        return std::string(home) + "/.cache/mavu/classification.cache";
+    }
+    return std::string();
+}
+
+/**
+ * @brief Loads the cache from the default cache file, creating its directory if needed.
+ *
+ * @return `true` if the cache is enabled.
+ */
+bool ClassificationCache::load() {
+    std::string cachePath = defaultPath();
+    if (cachePath.empty()) {
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+    return load(cachePath);
+}
+
+/**
+ * @brief Loads the cache from a file.
+ *
+ * The file is mapped read-only and its sorted table is used in place. The journal that follows
+ * the table is copied and sorted, so lookups are binary searches in both cases and never need a
+ * lock. A trailing partial record, left by an interrupted append, is ignored.
+ *
+ * @param cachePath The path of the cache file.
+ * @return `true` if the cache is enabled.
+ */
+bool ClassificationCache::load(const std::string& cachePath) {
+    cacheFile = cachePath;
+    enabled = true;
+    std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    racyLimitNs = now - racyWindowNs;
+
+    int fd = open(cachePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        // No cache yet: it is created when saved
+        rewriteNeeded = true;
+        return true;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(Header)) {
+        close(fd);
+        rewriteNeeded = true;
+        return true;
+    }
+
+    std::size_t length = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        rewriteNeeded = true;
+        return true;
+    }
+
+    // Results computed by another version of the format or of libmagic are not trusted
+    const Header* header = static_cast<const Header*>(mapping);
+    std::size_t recordCount = (length - sizeof(Header)) / sizeof(Record);
+    if (std::memcmp(header->signature, fileSignature, sizeof(fileSignature)) != 0
+        || header->version != formatVersion || header->recordSize != sizeof(Record)
+        || header->magicVersion != static_cast<std::uint64_t>(magic_version())
+        || header->tableCount > recordCount) {
+        munmap(mapping, length);
+        rewriteNeeded = true;
+        return true;
+    }
+
+    // The mapping is kept until the end of the run
+    table = reinterpret_cast<const Record*>(static_cast<const char*>(mapping) + sizeof(Header));
+    tableCount = header->tableCount;
+    journalCount = recordCount - tableCount;
+    journal.assign(table + tableCount, table + recordCount);
+    std::stable_sort(journal.begin(), journal.end());
+    tableUsed = std::vector<std::atomic<bool>>(tableCount);
+    journalUsed = std::vector<std::atomic<bool>>(journal.size());
+    rewriteNeeded = (length - sizeof(Header)) % sizeof(Record) != 0;
+    return true;
+}
+
+/**
+ * @brief Computes the key of a file.
+ *
+ * @param filePath The path of the file.
+ * @param key Receives the key of the file.
+ * @return `true` if the cache is enabled and the file can be cached.
+ */
+bool ClassificationCache::keyOf(const std::string& filePath, Key& key) {
+    if (!enabled) {
+        return false;
+    }
+    struct stat info;
+    return stat(filePath.c_str(), &info) == 0 && keyOf(info, key);
+}
+
+/**
+ * @brief Computes the key of a file from its status.
+ *
+ * @param info The status of the file.
+ * @param key Receives the key of the file.
+ * @return `true` if the cache is enabled and the file can be cached.
+ */
+bool ClassificationCache::keyOf(const struct stat& info, Key& key) {
+    if (!enabled || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    key.device = static_cast<std::uint64_t>(info.st_dev);
+    key.inode = static_cast<std::uint64_t>(info.st_ino);
+    key.size = static_cast<std::uint64_t>(info.st_size);
+    key.mtimeNs = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1'000'000'000 + info.st_mtim.tv_nsec;
+    return key.mtimeNs < racyLimitNs;
+}
+
+/**
+ * @brief Looks the result of a file up, in the journal first since it holds the newest records.
+ *
+ * The record found is flagged as used, for the compaction.
+ *
+ * @param key The key of the file.
+ * @param isText Receives whether the file is text, if the cache knows the file.
+ * @return `true` if the cache knows the file.
+ */
+bool ClassificationCache::lookup(const Key& key, bool& isText) {
+    if (!enabled) {
+        return false;
+    }
+    Record wanted = makeRecord(key, false);
+    const Record* found = find(journal.data(), journal.data() + journal.size(), wanted);
+    if (found != nullptr) {
+        journalUsed[static_cast<std::size_t>(found - journal.data())].store(true, std::memory_order_relaxed);
+    } else if (table != nullptr && (found = find(table, table + tableCount, wanted)) != nullptr) {
+        tableUsed[static_cast<std::size_t>(found - table)].store(true, std::memory_order_relaxed);
+    }
+    if (found == nullptr) {
+        missCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    hitCount.fetch_add(1, std::memory_order_relaxed);
+    isText = found->isText != 0;
+    return true;
+}
+
+/**
+ * @brief Records the result of a file, to be written by `save`.
+ *
+ * @param key The key of the file.
+ * @param isText Whether the file is text.
+ */
+void ClassificationCache::store(const Key& key, bool isText) {
+    if (!enabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pending.push_back(makeRecord(key, isText));
+    storedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Writes the results recorded during the run to the cache file.
+ *
+ * Appending is the common case: a run over an unchanged tree stores nothing, and a run over a
+ * slightly changed tree only appends the records of the changed files. Compaction merges the
+ * table, the journal and the new records, keeps only the newest record of each file, and writes
+ * the result to a temporary file renamed over the cache, so readers never see a partial table.
+ * Records of deleted files are never looked up again; once the result exceeds `maxRecords`,
+ * only the records looked up or stored during the run are kept, which drops them.
+ */
+void ClassificationCache::save() {
+    if (!enabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (pending.empty() && !rewriteNeeded) {
+        return;
+    }
+
+    if (!rewriteNeeded && journalCount + pending.size() <= tableCount / 2) {
+        int fd = open(cacheFile.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (fd >= 0) {
+            // Only append whole records, after checking that no other run left a partial one
+            struct stat info;
+            bool aligned = fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= sizeof(Header)
+                        && (static_cast<std::size_t>(info.st_size) - sizeof(Header)) % sizeof(Record) == 0;
+            if (aligned) {
+                writeAll(fd, pending.data(), pending.size() * sizeof(Record));
+                close(fd);
+                pending.clear();
+                return;
+            }
+            close(fd);
+        }
+    }
+
+    // Merge in age order, so the last record of each file is the newest one
+    std::vector<Record> records;
+    records.reserve(tableCount + journalCount + pending.size());
+    if (table != nullptr) {
+        records.insert(records.end(), table, table + tableCount + journalCount);
+    }
+    records.insert(records.end(), pending.begin(), pending.end());
+    std::stable_sort(records.begin(), records.end(), [](const Record& lhs, const Record& rhs) {
+        return std::tie(lhs.device, lhs.inode, lhs.mode) < std::tie(rhs.device, rhs.inode, rhs.mode);
+    });
+    std::vector<Record> compactedRecords;
+    compactedRecords.reserve(records.size());
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        if (i + 1 == records.size() || !sameFile(records[i], records[i + 1])) {
+            compactedRecords.push_back(records[i]);
+        }
+    }
+    if (compactedRecords.size() > maxRecords) {
+        compactedRecords.erase(std::remove_if(compactedRecords.begin(), compactedRecords.end(),
+                                              [](const Record& record) { return !usedDuringRun(record); }),
+                               compactedRecords.end());
+    }
+
+    Header header{};
+    std::memcpy(header.signature, fileSignature, sizeof(fileSignature));
+    header.version = formatVersion;
+    header.recordSize = sizeof(Record);
+    header.tableCount = compactedRecords.size();
+    header.magicVersion = static_cast<std::uint64_t>(magic_version());
+
+    std::string temporaryFile = cacheFile + ".tmp." + std::to_string(getpid());
+    int fd = open(temporaryFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    bool written = writeAll(fd, &header, sizeof(header))
+                && writeAll(fd, compactedRecords.data(), compactedRecords.size() * sizeof(Record));
+    close(fd);
+    if (!written || rename(temporaryFile.c_str(), cacheFile.c_str()) != 0) {
+        unlink(temporaryFile.c_str());
+        return;
+    }
+    pending.clear();
+    compacted = true;
+}
+
+/**
+ * @brief Deletes the default cache file.
+ *
+ * @return `true` if there was no cache file or it was deleted.
+ */
+bool ClassificationCache::clear() {
+    std::string cachePath = defaultPath();
+    return cachePath.empty() || unlink(cachePath.c_str()) == 0 || errno == ENOENT;
+}
+
+/**
+ * @brief Returns the counters of the cache.
+ */
+ClassificationCache::Statistics ClassificationCache::statistics() {
+    Statistics stats;
+    stats.hits = hitCount.load();
+    stats.misses = missCount.load();
+    stats.stored = storedCount.load();
+    stats.compacted = compacted;
+    return stats;
+}
@@ -0,0 +1,451 @@
+/**
+ * @file Classifier.cpp
+ * @headerfile Classifier.h
+ * @brief This file contains the implementation of the Classifier class.
+ *
+ * The Classifier class decides whether a file holds text or binary content. It wraps libmagic
+ * and keeps one loaded magic database per thread for the whole run, so the (expensive) database
+ * load happens once per worker instead of once per file.
+ *
+ * Before asking libmagic, the content can be sniffed in-process: a vectorized scan for NUL bytes,
+ * control characters and invalid UTF-8, plus magic-number checks for common binary formats,
+ * settles most files without libmagic. Only ambiguous content is handed over to libmagic.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <magic.h>
+#include <string_view>
+#include "globals.h"
+#include "Classifier.h"
+#include "Profiler.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+using namespace std::string_view_literals;
+
+std::atomic<std::uint64_t> sniffedTextCount{0};   ///< Classifications decided as text by the sniffer.
+std::atomic<std::uint64_t> sniffedBinaryCount{0}; ///< Classifications decided as binary by the sniffer.
+std::atomic<std::uint64_t> magicCount{0};         ///< Classifications decided by libmagic.
+std::atomic<std::uint64_t> guessedCount{0};       ///< Classifications guessed in `fast` mode.
+
+/**
+ * @brief Signatures of common binary formats, matched at the start of the content.
+ */
+constexpr std::string_view binarySignatures[] = {
+    "\x89PNG\r\n\x1a\n"sv,          // PNG
+    "\xff\xd8\xff"sv,                 // JPEG
+    "GIF87a"sv, "GIF89a"sv,           // GIF
+    "II*\0"sv, "MM\0*"sv,             // TIFF
+    "%PDF-"sv,                        // PDF
+    "PK\x03\x04"sv, "PK\x05\x06"sv,   // ZIP and derived formats (JAR, APK, OpenDocument, ...)
+    "\x1f\x8b"sv,                     // gzip
+    "BZh"sv,                          // bzip2
+    "\xfd" "7zXZ\0"sv,                // xz
+    "7z\xbc\xaf\x27\x1c"sv,           // 7-Zip
+    "Rar!\x1a\x07"sv,                 // RAR
+    "\x28\xb5\x2f\xfd"sv,             // Zstandard
+    "\x04\x22\x4d\x18"sv,             // LZ4
+    "\x7f" "ELF"sv,                   // ELF executables and libraries
+    "\xcf\xfa\xed\xfe"sv, "\xce\xfa\xed\xfe"sv, "\xca\xfe\xba\xbe"sv, // Mach-O, Java classes
+    "\0asm"sv,                        // WebAssembly
+    "\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1"sv, // OLE compound documents
+    "SQLite format 3\0"sv,            // SQLite
+    "RIFF"sv, "OggS"sv, "fLaC"sv, "ID3"sv, "\x1a\x45\xdf\xa3"sv, // Audio and video containers
+    "wOFF"sv, "wOF2"sv,               // Web fonts
+};
+
+/**
+ * @brief Starts of textual formats that libmagic does not report as `text/`.
+ */
+constexpr std::string_view ambiguousPrefixes[] = {
+    "#!"sv,                                        // Scripts, some reported as application/
+    "From "sv, "From:"sv, "Return-Path:"sv, "Received:"sv, "Message-ID:"sv, "Subject:"sv,
+    "Date:"sv, "Path:"sv, "Xref:"sv, "Article "sv, "Relay-Version:"sv, "Newsgroups:"sv, // Mail and news
+    "/* XPM */"sv,                                 // X pixmaps
+    "#define"sv,                                   // X bitmaps
+    "P1"sv, "P2"sv, "P3"sv,                        // Netpbm images
+    "d8:announce"sv,                               // BitTorrent files
+    "IN;"sv, "PA"sv,                               // HP-GL plots
+};
+
+/**
+ * @brief First characters of textual formats that libmagic does not report as `text/`.
+ *
+ * JSON (`{`, `[`), XML and SVG (`<`), PostScript (`%!`), PGP and PEM blocks (`-`), archives
+ * (`!<arch>`), INI-like files (`[`) and a few others are handed to libmagic.
+ */
+constexpr std::string_view ambiguousFirstCharacters = "{[<%!-@\\"sv;
+
+/**
+ * @brief Words that libmagic's JavaScript rules look for anywhere in the content.
+ *
+ * These rules also match a lot of C++, Python or Perl sources (for instance `(function(` in a
+ * comment), which libmagic then reports as application/javascript. Text containing any of these
+ * words is handed to libmagic so that both classifiers agree.
+ */
+constexpr std::string_view scriptMarkers[] = {
+    "function"sv, "exports"sv, "require("sv, "import "sv, "export "sv,
+};
+
+bool startsWith(std::string_view content, std::string_view prefix) {
+    return content.size() >= prefix.size() && content.compare(0, prefix.size(), prefix) == 0;
+}
+
+/**
+ * @brief Checks whether the content starts like a format whose MIME type libmagic has to decide.
+ */
+bool hasAmbiguousStart(std::string_view content) {
+    // Skip a UTF-8 byte order mark and leading whitespace
+    if (startsWith(content, "\xef\xbb\xbf"sv)) {
+        content.remove_prefix(3);
+    }
+    for (std::string_view prefix : ambiguousPrefixes) {
+        if (startsWith(content, prefix)) {
+            return true;
+        }
+    }
+    std::size_t first = content.find_first_not_of(" \t\r\n\f\v"sv);
+    return first != std::string_view::npos && ambiguousFirstCharacters.find(content[first]) != std::string_view::npos;
+}
+
+/**
+ * @struct ScanResult
+ * @brief What the byte scan found in the content.
+ */
+struct ScanResult {
+    bool hasNul = false;     ///< A NUL byte was found.
+    bool hasControl = false; ///< A control character that text does not normally hold was found.
+    bool hasHighBit = false; ///< A byte above 0x7f was found (UTF-8 or another encoding).
+};
+
+/**
+ * @brief Checks whether a byte is a control character not found in text.
+ *
+ * Like libmagic, text may hold BEL, BS, TAB, LF, VT, FF, CR and ESC; NUL, the other C0 controls
+ * and DEL are not text.
+ */
+constexpr bool isBadControl(unsigned char byte) {
+    return (byte < 0x07) || (byte >= 0x0e && byte < 0x1b) || (byte >= 0x1c && byte < 0x20) || byte == 0x7f;
+}
+
+/**
+ * @brief Scans bytes one at a time.
+ */
+void scanScalar(const unsigned char* data, std::size_t size, ScanResult& result) {
+    for (std::size_t i = 0; i < size; ++i) {
+        result.hasNul |= data[i] == 0;
+        result.hasControl |= isBadControl(data[i]);
+        result.hasHighBit |= data[i] >= 0x80;
+    }
+}
+
+/**
+ * @brief Scans the content for NUL bytes, bad control characters and high-bit bytes.
+ *
+ * With SSE2, 16 bytes are checked at a time: unsigned range tests are built from `pmaxub`
+ * (`x >= n` exactly when `max(x, n) == x`), and the flags are accumulated with OR so the loop
+ * has no data-dependent branches.
+ */
+ScanResult scan(std::string_view content) {
+    ScanResult result;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(content.data());
+    std::size_t size = content.size();
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    auto atLeast = [](__m128i bytes, char bound) {
+        return _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(bound)), bytes);
+    };
+
+    __m128i nul = zero;
+    __m128i control = zero;
+    __m128i highBit = zero;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        nul = _mm_or_si128(nul, _mm_cmpeq_epi8(bytes, zero));
+        // Bad controls: [0x00, 0x07), [0x0e, 0x1b), [0x1c, 0x20) and 0x7f
+        const __m128i below07 = _mm_andnot_si128(atLeast(bytes, 0x07), _mm_set1_epi8(-1));
+        const __m128i from0e = _mm_andnot_si128(atLeast(bytes, 0x1b), atLeast(bytes, 0x0e));
+        const __m128i from1c = _mm_andnot_si128(atLeast(bytes, 0x20), atLeast(bytes, 0x1c));
+        const __m128i del = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7f));
+        control = _mm_or_si128(control, _mm_or_si128(_mm_or_si128(below07, from0e), _mm_or_si128(from1c, del)));
+        highBit = _mm_or_si128(highBit, bytes);
+    }
+    result.hasNul = _mm_movemask_epi8(nul) != 0;
+    result.hasControl = _mm_movemask_epi8(control) != 0;
+    result.hasHighBit = _mm_movemask_epi8(highBit) != 0;
+#endif
+
+    scanScalar(data + i, size - i, result);
+    return result;
+}
+
+/**
+ * @brief Checks whether the content is valid UTF-8.
+ *
+ * A multi-byte sequence cut by the end of the content is accepted, since the content may only be
+ * the beginning of the file.
+ */
+bool isValidUtf8(std::string_view content) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(content.data());
+    std::size_t size = content.size();
+    std::size_t i = 0;
+    while (i < size) {
+        unsigned char lead = data[i];
+        if (lead < 0x80) {
+            ++i;
+            continue;
+        }
+
+        std::size_t length;
+        unsigned char low = 0x80;
+        unsigned char high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf) {
+            length = 2;
+        } else if (lead >= 0xe0 && lead <= 0xef) {
+            length = 3;
+            // Reject overlong forms and UTF-16 surrogates
+            if (lead == 0xe0) low = 0xa0;
+            if (lead == 0xed) high = 0x9f;
+        } else if (lead >= 0xf0 && lead <= 0xf4) {
+            length = 4;
+            // Reject overlong forms and code points above U+10FFFF
+            if (lead == 0xf0) low = 0x90;
+            if (lead == 0xf4) high = 0x8f;
+        } else {
+            return false;
+        }
+
+        for (std::size_t k = 1; k < length; ++k) {
+            if (i + k >= size) {
+                return true;
+            }
+            unsigned char next = data[i + k];
+            if (next < (k == 1 ? low : 0x80) || next > (k == 1 ? high : 0xbf)) {
+                return false;
+            }
+        }
+        i += length;
+    }
+    return true;
+}
+
+/**
+ * @class MagicCookie
+ * @brief Owns a libmagic cookie with its database loaded.
+ *
+ * One instance lives in each thread that classifies files. The database is loaded on
+ * construction and the cookie is closed on destruction, when the thread exits.
+ */
+class MagicCookie {
+public:
+    MagicCookie() : cookie(magic_open(MAGIC_MIME_TYPE)) {
+        if (cookie == nullptr) {
+            std::cerr << SOFTWARE_NAME << ": error: unable to initialize magic library" << std::endl;
+            return;
+        }
+
+        if (magic_load(cookie, nullptr) != 0) {
+            std::cerr << SOFTWARE_NAME << ": error: unable to load magic database" << std::endl;
+            magic_close(cookie);
+            cookie = nullptr;
+            return;
+        }
+
+        magic_getparam(cookie, MAGIC_PARAM_BYTES_MAX, &maxBytes);
+    }
+
+    ~MagicCookie() {
+        if (cookie != nullptr) {
+            magic_close(cookie);
+        }
+    }
+
+    MagicCookie(const MagicCookie&) = delete;
+    MagicCookie& operator=(const MagicCookie&) = delete;
+
+    magic_t get() const { return cookie; }
+
+    /**
+     * @brief Returns the number of bytes libmagic examines at most.
+     */
+    std::size_t bytesMax() const { return maxBytes; }
+
+private:
+    magic_t cookie; ///< The loaded cookie, or `nullptr` if libmagic could not be initialized.
+    std::size_t maxBytes = defaultBytesMax; ///< The libmagic `bytes_max` parameter.
+
+    static constexpr std::size_t defaultBytesMax = 1024 * 1024; ///< libmagic's documented default.
+};
+
+/**
+ * @brief Returns the libmagic cookie of the calling thread, loading it on first use.
+ */
+const MagicCookie& threadCookie() {
+    thread_local MagicCookie cookie;
+    return cookie;
+}
+
+} // namespace
+
+/**
+ * @brief Checks if a file has a text MIME type.
+ *
+ * This function uses the thread-local libmagic cookie to determine the MIME type of the file
+ * by reading its content.
+ *
+ * @param filePath The path of the file to check.
+ * @return True if the file has a text MIME type, otherwise false.
+ */
+bool Classifier::isText(const std::filesystem::path& filePath) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Libmagic);
+    magic_t magicCookie = threadCookie().get();
+    if (magicCookie == nullptr) {
+        return false;
+    }
+
+    // Get the MIME type of the file
+    const char* mimeType = magic_file(magicCookie, filePath.c_str());
+    if (mimeType == nullptr) {
+        std::cerr << SOFTWARE_NAME << ": error: unable to determine MIME type of file `" << filePath.string() << "`" << std::endl;
+        return false;
+    }
+
+    // Check if the MIME type starts with "text/"
+    return strncmp(mimeType, "text/", 5) == 0;
+}
+
+/**
+ * @brief Checks if a buffer has a text MIME type according to libmagic.
+ *
+ * This function uses the thread-local libmagic cookie to determine the MIME type of the content.
+ * The buffer is truncated to the number of bytes libmagic would read from a file, which keeps the
+ * result in line with `isText(const std::filesystem::path&)` and the cost independent of the size
+ * of the file.
+ *
+ * @param content The content to check.
+ * @return True if the content has a text MIME type, otherwise false.
+ */
+bool Classifier::isTextMagic(std::string_view content) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Libmagic);
+    const MagicCookie& cookie = threadCookie();
+    if (cookie.get() == nullptr) {
+        return false;
+    }
+
+    // Get the MIME type of the content
+    const char* mimeType = magic_buffer(cookie.get(), content.data(), std::min(content.size(), cookie.bytesMax()));
+    if (mimeType == nullptr) {
+        std::cerr << SOFTWARE_NAME << ": error: unable to determine MIME type of buffer" << std::endl;
+        return false;
+    }
+
+    // Check if the MIME type starts with "text/"
+    return strncmp(mimeType, "text/", 5) == 0;
+}
+
+/**
+ * @brief Sniffs the beginning of a buffer without libmagic.
+ *
+ * @param content The content to sniff.
+ * @return The verdict: text, binary, or unknown when libmagic has to decide.
+ */
+Classifier::Verdict Classifier::sniff(std::string_view content) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Sniff);
+    content = content.substr(0, sniffLength);
+
+    // libmagic reports empty content as application/x-empty
+    if (content.empty()) {
+        return Verdict::Binary;
+    }
+
+    for (std::string_view signature : binarySignatures) {
+        if (startsWith(content, signature)) {
+            return Verdict::Binary;
+        }
+    }
+
+    // Text formats that libmagic reports under another MIME type, and UTF-16/32 text (full of
+    // NUL bytes but reported as text), are left to libmagic
+    if (hasAmbiguousStart(content) || startsWith(content, "\xff\xfe"sv) || startsWith(content, "\xfe\xff"sv)) {
+        return Verdict::Unknown;
+    }
+
+    ScanResult result = scan(content);
+    if (result.hasNul) {
+        return Verdict::Binary;
+    }
+    if (result.hasControl) {
+        return Verdict::Unknown;
+    }
+    if (result.hasHighBit && !isValidUtf8(content)) {
+        // Probably text in a legacy 8-bit encoding, which libmagic knows how to recognize
+        return Verdict::Unknown;
+    }
+    for (std::string_view marker : scriptMarkers) {
+        if (content.find(marker) != std::string_view::npos) {
+            return Verdict::Unknown;
+        }
+    }
+    return Verdict::Text;
+}
+
+/**
+ * @brief Checks if a buffer holding the content of a file is text.
+ *
+ * In `magic` mode the content goes straight to libmagic. In `hybrid` mode (the default) it is
+ * sniffed first and libmagic only decides the unknown cases. In `fast` mode libmagic is never
+ * used: unknown content is considered text unless it holds NUL bytes or control characters.
+ *
+ * @param content The content to check.
+ * @return True if the content is text, otherwise false.
+ */
+bool Classifier::isTextContent(std::string_view content) {
+    if (Configuration::classifierMode == ClassifierMode::Magic) {
+        magicCount.fetch_add(1, std::memory_order_relaxed);
+        return isTextMagic(content);
+    }
+
+    switch (sniff(content)) {
+        case Verdict::Text:
+            sniffedTextCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        case Verdict::Binary:
+            sniffedBinaryCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        case Verdict::Unknown:
+            break;
+    }
+
+    if (Configuration::classifierMode == ClassifierMode::Fast) {
+        guessedCount.fetch_add(1, std::memory_order_relaxed);
+        Profiler::ScopedTimer timer(Profiler::Stage::Sniff);
+        ScanResult result = scan(content.substr(0, sniffLength));
+        return !result.hasNul && !result.hasControl;
+    }
+
+    magicCount.fetch_add(1, std::memory_order_relaxed);
+    return isTextMagic(content);
+}
+
+/**
+ * @brief Returns the classification counters, summed over all threads.
+ */
+Classifier::Statistics Classifier::statistics() {
+    Statistics stats;
+    stats.sniffedText = sniffedTextCount.load();
+    stats.sniffedBinary = sniffedBinaryCount.load();
+    stats.magic = magicCount.load();
+    stats.guessed = guessedCount.load();
+    return stats;
+}
@@ -0,0 +1,303 @@
+/**
+ * @file ContentHash.cpp
+ * @headerfile ContentHash.h
+ * @brief This file contains the implementation of the ContentHash class.
+ *
+ * The input is cut into 64-byte stripes. For each stripe, every 64-bit lane is combined with the
+ * matching lane of a secret, the two 32-bit halves of the result are multiplied together and
+ * added to the lane's accumulator, and the input lane is added to the neighbouring accumulator.
+ * Every 16 stripes the accumulators are scrambled with a shift, the end of the secret and a
+ * multiply. The last 64 bytes of the input are always absorbed as a final stripe, and the
+ * accumulators are folded into one value with 128-bit multiplies and a final avalanche.
+ *
+ * The AVX2 kernel handles four lanes per instruction with `vpmuludq`; the portable kernel does
+ * the same arithmetic one lane at a time, so both produce the same hash.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include "ContentHash.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr std::size_t stripeLength = 64;                                        ///< Bytes absorbed per stripe.
+constexpr std::size_t secretLength = 192;                                       ///< Bytes of the secret.
+constexpr std::size_t stripesPerBlock = (secretLength - stripeLength) / 8;      ///< Stripes between two scrambles.
+constexpr std::size_t blockLength = stripesPerBlock * stripeLength;             ///< Bytes between two scrambles.
+constexpr std::size_t lastStripeOffset = secretLength - stripeLength - 7;       ///< Secret offset of the last stripe.
+constexpr std::size_t scrambleOffset = secretLength - stripeLength;             ///< Secret offset of the scramble.
+
+constexpr std::uint64_t prime32a = 0x9E3779B1U;
+constexpr std::uint64_t prime32b = 0x85EBCA77U;
+constexpr std::uint64_t prime32c = 0xC2B2AE3DU;
+constexpr std::uint64_t prime64a = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t prime64b = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t prime64c = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t prime64d = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t prime64e = 0x27D4EB2F165667C5ULL;
+
+/**
+ * @brief Generates the secret with splitmix64, so it needs no table of magic bytes.
+ */
+constexpr std::array<unsigned char, secretLength> makeSecret() {
+    std::array<unsigned char, secretLength> secret{};
+    std::uint64_t state = prime64a;
+    for (std::size_t i = 0; i < secretLength; i += 8) {
+        state += 0x9E3779B97F4A7C15ULL;
+        std::uint64_t value = state;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        value ^= value >> 31;
+        for (std::size_t byte = 0; byte < 8; ++byte) {
+            secret[i + byte] = static_cast<unsigned char>(value >> (8 * byte));
+        }
+    }
+    return secret;
+}
+
+alignas(64) constexpr std::array<unsigned char, secretLength> secret = makeSecret();
+
+/**
+ * @brief Reads a little-endian 64-bit value.
+ */
+inline std::uint64_t read64(const unsigned char* bytes) {
+    std::uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Absorbs one stripe into the accumulators, one lane at a time.
+ */
+inline void accumulateStripe(std::uint64_t* accumulators, const unsigned char* input, const unsigned char* key) {
+    for (std::size_t lane = 0; lane < 8; ++lane) {
+        std::uint64_t data = read64(input + 8 * lane);
+        std::uint64_t keyed = data ^ read64(key + 8 * lane);
+        accumulators[lane ^ 1] += data;
+        accumulators[lane] += (keyed & 0xFFFFFFFFULL) * (keyed >> 32);
+    }
+}
+
+/**
+ * @brief Scrambles the accumulators at the end of a block, one lane at a time.
+ */
+inline void scramble(std::uint64_t* accumulators) {
+    for (std::size_t lane = 0; lane < 8; ++lane) {
+        std::uint64_t value = accumulators[lane];
+        value ^= value >> 47;
+        value ^= read64(secret.data() + scrambleOffset + 8 * lane);
+        accumulators[lane] = value * prime32a;
+    }
+}
+
+/**
+ * @brief Multiplies two values into 128 bits and folds the halves together.
+ */
+inline std::uint64_t multiplyFold(std::uint64_t left, std::uint64_t right) {
+    __extension__ using Product = unsigned __int128;
+    Product product = static_cast<Product>(left) * right;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+}
+
+/**
+ * @brief Sets the accumulators to their initial values.
+ */
+inline void initialize(std::uint64_t* accumulators) {
+    const std::uint64_t initial[8] = {prime32c, prime64a, prime64b, prime64c, prime64d, prime32b, prime64e, prime32a};
+    std::memcpy(accumulators, initial, sizeof(initial));
+}
+
+/**
+ * @brief Folds the accumulators into the hash of an input of `length` bytes.
+ */
+std::uint64_t finish(const std::uint64_t* accumulators, std::size_t length) {
+    std::uint64_t result = static_cast<std::uint64_t>(length) * prime64a;
+    for (std::size_t pair = 0; pair < 4; ++pair) {
+        const unsigned char* key = secret.data() + 11 + 16 * pair;
+        result += multiplyFold(accumulators[2 * pair] ^ read64(key), accumulators[2 * pair + 1] ^ read64(key + 8));
+    }
+    result ^= result >> 37;
+    result *= 0x165667919E3779F9ULL;
+    return result ^ (result >> 32);
+}
+
+/**
+ * @brief Hashes an input shorter than a stripe, padded with zeros to a whole stripe.
+ */
+std::uint64_t hashShort(std::string_view input) {
+    unsigned char stripe[stripeLength] = {};
+    std::memcpy(stripe, input.data(), input.size());
+    std::uint64_t accumulators[8];
+    initialize(accumulators);
+    accumulateStripe(accumulators, stripe, secret.data());
+    return finish(accumulators, input.size());
+}
+
+} // namespace
+
+/**
+ * @brief Hashes the input with the portable kernel.
+ *
+ * @param input The bytes to hash.
+ * @return The hash of the input.
+ */
+std::uint64_t ContentHash::hashScalar(std::string_view input) {
+    if (input.size() < stripeLength) {
+        return hashShort(input);
+    }
+    const auto* bytes = reinterpret_cast<const unsigned char*>(input.data());
+    std::size_t length = input.size();
+    std::uint64_t accumulators[8];
+    initialize(accumulators);
+
+    // Whole blocks, then the stripes of the last block, leaving at least one byte for the last stripe
+    std::size_t blocks = (length - 1) / blockLength;
+    for (std::size_t block = 0; block < blocks; ++block) {
+        for (std::size_t stripe = 0; stripe < stripesPerBlock; ++stripe) {
+            accumulateStripe(accumulators, bytes + block * blockLength + stripe * stripeLength, secret.data() + 8 * stripe);
+        }
+        scramble(accumulators);
+    }
+    std::size_t stripes = ((length - 1) - blocks * blockLength) / stripeLength;
+    for (std::size_t stripe = 0; stripe < stripes; ++stripe) {
+        accumulateStripe(accumulators, bytes + blocks * blockLength + stripe * stripeLength, secret.data() + 8 * stripe);
+    }
+    accumulateStripe(accumulators, bytes + length - stripeLength, secret.data() + lastStripeOffset);
+    return finish(accumulators, length);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+namespace {
+
+/**
+ * @brief Absorbs one stripe into the accumulators, four lanes per register.
+ *
+ * The input lanes are swapped within each 128-bit half to be added to the neighbouring
+ * accumulators, and `vpmuludq` multiplies the low halves of the keyed lanes by their high halves.
+ */
+__attribute__((target("avx2")))
+inline void accumulateStripeAvx2(__m256i* accumulators, const unsigned char* input, const unsigned char* key) {
+    for (std::size_t half = 0; half < 2; ++half) {
+        __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + 32 * half));
+        __m256i keyed = _mm256_xor_si256(data, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 32 * half)));
+        __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+        __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        accumulators[half] = _mm256_add_epi64(accumulators[half], _mm256_add_epi64(product, swapped));
+    }
+}
+
+/**
+ * @brief Scrambles the accumulators at the end of a block, four lanes per register.
+ *
+ * The 64-bit multiply by a 32-bit constant is split into two `vpmuludq`, on the low and the
+ * high halves of the lanes.
+ */
+__attribute__((target("avx2")))
+inline void scrambleAvx2(__m256i* accumulators) {
+    const __m256i prime = _mm256_set1_epi32(static_cast<int>(prime32a));
+    for (std::size_t half = 0; half < 2; ++half) {
+        __m256i value = accumulators[half];
+        value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 47));
+        value = _mm256_xor_si256(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret.data() + scrambleOffset + 32 * half)));
+        __m256i low = _mm256_mul_epu32(value, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(value, 32), prime);
+        accumulators[half] = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Hashes the input with the AVX2 kernel.
+ *
+ * @param input The bytes to hash.
+ * @return The hash of the input, equal to the one of `hashScalar`.
+ */
+__attribute__((target("avx2")))
+std::uint64_t ContentHash::hashAvx2(std::string_view input) {
+    if (input.size() < stripeLength) {
+        return hashShort(input);
+    }
+    const auto* bytes = reinterpret_cast<const unsigned char*>(input.data());
+    std::size_t length = input.size();
+    alignas(32) std::uint64_t initial[8];
+    initialize(initial);
+    __m256i accumulators[2] = {_mm256_load_si256(reinterpret_cast<const __m256i*>(initial)),
+                               _mm256_load_si256(reinterpret_cast<const __m256i*>(initial + 4))};
+
+    std::size_t blocks = (length - 1) / blockLength;
+    for (std::size_t block = 0; block < blocks; ++block) {
+        for (std::size_t stripe = 0; stripe < stripesPerBlock; ++stripe) {
+            accumulateStripeAvx2(accumulators, bytes + block * blockLength + stripe * stripeLength, secret.data() + 8 * stripe);
+        }
+        scrambleAvx2(accumulators);
+    }
+    std::size_t stripes = ((length - 1) - blocks * blockLength) / stripeLength;
+    for (std::size_t stripe = 0; stripe < stripes; ++stripe) {
+        accumulateStripeAvx2(accumulators, bytes + blocks * blockLength + stripe * stripeLength, secret.data() + 8 * stripe);
+    }
+    accumulateStripeAvx2(accumulators, bytes + length - stripeLength, secret.data() + lastStripeOffset);
+
+    alignas(32) std::uint64_t result[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(result), accumulators[0]);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(result + 4), accumulators[1]);
+    return finish(result, length);
+}
+
+#endif
+
+namespace {
+
+/**
+ * @brief Picks the fastest kernel supported by the CPU.
+ */
+ContentHash::Kernel selectKernel(const char** name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return &ContentHash::hashAvx2;
+    }
+#endif
+    *name = "scalar";
+    return &ContentHash::hashScalar;
+}
+
+/**
+ * @struct Dispatch
+ * @brief The kernel selected for this CPU, resolved once on first use.
+ */
+struct Dispatch {
+    const char* name = nullptr;
+    ContentHash::Kernel kernel = selectKernel(&name);
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch selected;
+    return selected;
+}
+
+} // namespace
+
+/**
+ * @brief Hashes the input with the fastest kernel supported by the CPU.
+ *
+ * @param input The bytes to hash.
+ * @return The hash of the input.
+ */
+std::uint64_t ContentHash::hash(std::string_view input) {
+    return dispatch().kernel(input);
+}
+
+/**
+ * @brief Returns the name of the kernel used by `hash`.
+ */
+const char* ContentHash::kernelName() {
+    return dispatch().name;
+}
@@ -0,0 +1,292 @@
+/**
+ * @file Decompressor.cpp
+ * @headerfile Decompressor.h
+ * @brief This file contains the implementation of the Decompressor class.
+ *
+ * The Decompressor class implements the `-z` option: it recognizes gzip, xz and bzip2 files by
+ * their magic number and decompresses them as a stream, chunk by chunk, with the zlib, liblzma
+ * and libbz2 libraries linked into the binary. Every call decompresses the compressed bytes
+ * already read into the output buffer, and reads the next chunk of the file only once they are
+ * used up, so at most one compressed and one decompressed chunk are held at a time.
+ */
+
+#include <algorithm>
+#include <bzlib.h>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <lzma.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <zlib.h>
+#include "globals.h"
+#include "Decompressor.h"
+#include "Profiler.h"
+
+/**
+ * @struct Decompressor::Stream
+ * @brief The state of the library decompressing the file; only the member of its format is used.
+ */
+struct Decompressor::Stream {
+    z_stream gzip = {};                ///< The zlib state, for gzip.
+    lzma_stream xz = LZMA_STREAM_INIT; ///< The liblzma state, for xz.
+    bz_stream bzip2 = {};              ///< The libbz2 state, for bzip2.
+};
+
+namespace {
+
+/**
+ * @brief The extensions of the formats decompressed by `-z`, lowercase.
+ */
+constexpr std::string_view compressedExtensions[] = {".bz2", ".gz", ".xz"};
+
+/**
+ * @brief Checks whether the input starts like a new gzip member or bzip2 stream.
+ *
+ * Only the first byte is required: a member whose magic number is cut by the end of a chunk is
+ * recognized by its first byte, and a false start is reported as corrupt data.
+ */
+bool startsMember(std::string_view input, Compression compression) {
+    return !input.empty() && input[0] == (compression == Compression::Gzip ? '\x1f' : 'B');
+}
+
+} // namespace
+
+/**
+ * @brief Recognizes a compression format from the first bytes of a file.
+ *
+ * gzip files start with `1f 8b`, xz files with `fd 37 7a 58 5a 00`, and bzip2 files with `BZh`
+ * followed by the block size digit.
+ *
+ * @param head The first bytes of the file.
+ * @return The format of the file, or `Compression::None`.
+ */
+Compression Decompressor::detect(std::string_view head) {
+    if (head.size() >= 2 && head[0] == '\x1f' && head[1] == '\x8b') {
+        return Compression::Gzip;
+    }
+    if (head.size() >= 6 && head.compare(0, 6, std::string_view("\xfd" "7zXZ\0", 6)) == 0) {
+        return Compression::Xz;
+    }
+    if (head.size() >= 4 && head.compare(0, 3, "BZh") == 0 && head[3] >= '1' && head[3] <= '9') {
+        return Compression::Bzip2;
+    }
+    return Compression::None;
+}
+
+/**
+ * @brief Recognizes the compression format of a file by reading its first bytes.
+ *
+ * Only `magicLength` bytes are read, so checking a large file costs a single small read.
+ *
+ * @param filePath The path of the file.
+ * @return The format of the file, or `Compression::None`.
+ */
+Compression Decompressor::detectFile(const std::string& filePath) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Read);
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    Profiler::count(Profiler::Counter::ReadCalls);
+    if (fd < 0) {
+        return Compression::None;
+    }
+    char head[magicLength];
+    ssize_t count = pread(fd, head, sizeof(head), 0);
+    Profiler::count(Profiler::Counter::ReadCalls);
+    close(fd);
+    if (count <= 0) {
+        return Compression::None;
+    }
+    Profiler::count(Profiler::Counter::BytesRead, static_cast<std::uint64_t>(count));
+    return detect(std::string_view(head, static_cast<std::size_t>(count)));
+}
+
+/**
+ * @brief Checks whether a file name ends with `.gz`, `.xz` or `.bz2`, whatever the case.
+ *
+ * @param fileName The name of the file, without directories.
+ */
+bool Decompressor::hasCompressedExtension(std::string_view fileName) {
+    for (std::string_view extension : compressedExtensions) {
+        // A leading dot does not start an extension
+        if (fileName.size() > extension.size()
+            && std::equal(extension.begin(), extension.end(), fileName.end() - extension.size(), [](char left, char right) {
+                   return left == std::tolower(static_cast<unsigned char>(right));
+               })) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Opens a compressed file for decompression.
+ *
+ * The xz decoder is created with `LZMA_CONCATENATED`, so it decompresses concatenated streams
+ * and skips their padding by itself; gzip members and bzip2 streams are chained by `restart`.
+ *
+ * @param filePath The path of the file.
+ * @param compression The format of the file.
+ */
+Decompressor::Decompressor(const std::string& filePath, Compression compression)
+    : compression(compression), reader(filePath, FileReader::chunkSize), stream(std::make_unique<Stream>()),
+      output(std::make_unique<char[]>(chunkSize)) {
+    bool initialized = false;
+    switch (compression) {
+        case Compression::Gzip:
+            // 16 selects the gzip wrapper, with the largest window
+            initialized = inflateInit2(&stream->gzip, 15 + 16) == Z_OK;
+            break;
+        case Compression::Xz:
+            initialized = lzma_stream_decoder(&stream->xz, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+            break;
+        case Compression::Bzip2:
+            initialized = BZ2_bzDecompressInit(&stream->bzip2, 0, 0) == BZ_OK;
+            break;
+        case Compression::None:
+            break;
+    }
+    if (!initialized) {
+        throw std::runtime_error("Cannot initialize the decompressor");
+    }
+}
+
+/**
+ * @brief Releases the decompressor and closes the file.
+ */
+Decompressor::~Decompressor() {
+    switch (compression) {
+        case Compression::Gzip:
+            inflateEnd(&stream->gzip);
+            break;
+        case Compression::Xz:
+            lzma_end(&stream->xz);
+            break;
+        case Compression::Bzip2:
+            BZ2_bzDecompressEnd(&stream->bzip2);
+            break;
+        case Compression::None:
+            break;
+    }
+}
+
+/**
+ * @brief Decompresses the next chunk of the content.
+ *
+ * The output buffer is filled as far as possible, reading the compressed file as needed, so
+ * every chunk but the last one has exactly `chunkSize` bytes.
+ *
+ * @param chunk Receives a view of the decompressed bytes, valid until the next call.
+ * @return `true` if a chunk was decompressed, `false` at the end of the content.
+ */
+bool Decompressor::next(std::string_view& chunk) {
+    std::size_t produced = 0;
+    while (produced < chunkSize) {
+        if (input.empty() && !inputEnded) {
+            inputEnded = !reader.next(input);
+        }
+        if (streamEnded && !restart()) {
+            break;
+        }
+        std::size_t before = produced;
+        std::size_t available = input.size();
+        produced = inflate(produced);
+        if (!streamEnded && produced == before && input.size() == available && inputEnded) {
+            throw std::runtime_error("Unexpected end of compressed data");
+        }
+    }
+    chunk = std::string_view(output.get(), produced);
+    return produced > 0;
+}
+
+/**
+ * @brief Decompresses the available input into the output buffer.
+ *
+ * @param produced The bytes already in the output buffer.
+ * @return The bytes in the output buffer afterwards.
+ */
+std::size_t Decompressor::inflate(std::size_t produced) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Decompress);
+    char* out = output.get() + produced;
+    std::size_t room = chunkSize - produced;
+    switch (compression) {
+        case Compression::Gzip: {
+            z_stream& gzip = stream->gzip;
+            gzip.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+            gzip.avail_in = static_cast<uInt>(input.size());
+            gzip.next_out = reinterpret_cast<Bytef*>(out);
+            gzip.avail_out = static_cast<uInt>(room);
+            int result = ::inflate(&gzip, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                streamEnded = true;
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("Corrupt gzip data: ") + (gzip.msg != nullptr ? gzip.msg : "invalid data"));
+            }
+            input.remove_prefix(input.size() - gzip.avail_in);
+            return chunkSize - gzip.avail_out;
+        }
+        case Compression::Xz: {
+            lzma_stream& xz = stream->xz;
+            xz.next_in = reinterpret_cast<const std::uint8_t*>(input.data());
+            xz.avail_in = input.size();
+            xz.next_out = reinterpret_cast<std::uint8_t*>(out);
+            xz.avail_out = room;
+            // The concatenated decoder checks the end of the last stream once told that no input follows
+            lzma_ret result = lzma_code(&xz, inputEnded ? LZMA_FINISH : LZMA_RUN);
+            if (result == LZMA_STREAM_END) {
+                streamEnded = true;
+            } else if (result != LZMA_OK && result != LZMA_BUF_ERROR) {
+                throw std::runtime_error(result == LZMA_MEM_ERROR ? "Cannot allocate the xz decoder" : "Corrupt xz data");
+            }
+            input.remove_prefix(input.size() - xz.avail_in);
+            return chunkSize - xz.avail_out;
+        }
+        case Compression::Bzip2: {
+            bz_stream& bzip2 = stream->bzip2;
+            bzip2.next_in = const_cast<char*>(input.data());
+            bzip2.avail_in = static_cast<unsigned>(input.size());
+            bzip2.next_out = out;
+            bzip2.avail_out = static_cast<unsigned>(room);
+            int result = BZ2_bzDecompress(&bzip2);
+            if (result == BZ_STREAM_END) {
+                streamEnded = true;
+            } else if (result != BZ_OK) {
+                throw std::runtime_error("Corrupt bzip2 data");
+            }
+            input.remove_prefix(input.size() - bzip2.avail_in);
+            return chunkSize - bzip2.avail_out;
+        }
+        case Compression::None:
+            break;
+    }
+    return produced;
+}
+
+/**
+ * @brief Starts the next gzip member or bzip2 stream, if one follows the current one.
+ *
+ * Anything else after the end of a member, such as the zero padding of tape archives, ends the
+ * content, as `gzip -d` does.
+ *
+ * @return `true` if a new member was started.
+ */
+bool Decompressor::restart() {
+    if (compression == Compression::Xz || !startsMember(input, compression)) {
+        return false;
+    }
+    bool restarted = false;
+    if (compression == Compression::Gzip) {
+        restarted = inflateReset(&stream->gzip) == Z_OK;
+    } else {
+        BZ2_bzDecompressEnd(&stream->bzip2);
+        stream->bzip2 = {};
+        restarted = BZ2_bzDecompressInit(&stream->bzip2, 0, 0) == BZ_OK;
+    }
+    if (!restarted) {
+        throw std::runtime_error("Cannot initialize the decompressor");
+    }
+    streamEnded = false;
+    return true;
+}
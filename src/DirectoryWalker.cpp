@@ -0,0 +1,382 @@
+/**
+ * @file DirectoryWalker.cpp
+ * @headerfile DirectoryWalker.h
+ * @brief This file contains the implementation of the DirectoryWalker class.
+ *
+ * The DirectoryWalker class enumerates a directory tree concurrently on a `ThreadPool`. Every
+ * directory is read by one task with `readdir`, using the entry type it reports (`d_type`) to
+ * avoid a `stat` call per entry whenever possible. The entries of each directory are sorted by
+ * name, and the walker hands files back in depth-first order, so the result does not depend on
+ * the number of threads or on the order in which directories finish. Entries excluded by ignore
+ * files or by the `--exclude` globs are dropped while their directory is read, so ignored
+ * directories are never opened.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <sys/stat.h>
+#include <system_error>
+#include "globals.h"
+#include "Archive.h"
+#include "DirectoryWalker.h"
+#include "Profiler.h"
+
+namespace {
+
+/**
+ * @brief Joins a directory path and an entry name the way `std::filesystem::path::operator/` does.
+ */
+std::string joinPath(const std::string& directory, const std::string& name) {
+    if (!directory.empty() && directory.back() == '/') {
+        return directory + name;
+    }
+    return directory + '/' + name;
+}
+
+/**
+ * @brief Joins the relative path of a directory and an entry name; the root has an empty relative path.
+ */
+std::string joinRelativePath(const std::string& directory, const std::string& name) {
+    return directory.empty() ? name : directory + '/' + name;
+}
+
+/**
+ * @brief Checks whether an entry name is one of the ignore files.
+ */
+bool isIgnoreFile(const char* name) {
+    return std::any_of(std::begin(IgnoreRules::fileNames), std::end(IgnoreRules::fileNames),
+                       [name](const char* fileName) { return std::strcmp(name, fileName) == 0; });
+}
+
+/**
+ * @brief The kind of a directory entry, as far as the walk is concerned.
+ */
+enum class EntryKind { Skip, File, Directory };
+
+/**
+ * @brief Determines the kind of a directory entry, calling `stat` only when `d_type` is not enough.
+ *
+ * Regular files and symbolic links to regular files are listed. Directories are descended into,
+ * while symbolic links to directories are not followed.
+ *
+ * @param type The `d_type` reported by `readdir`.
+ * @param fullPath The path of the entry, used when a `stat` call is needed.
+ * @return The kind of the entry.
+ */
+EntryKind entryKind(unsigned char type, const std::string& fullPath) {
+    struct stat info;
+    switch (type) {
+        case DT_REG:
+            return EntryKind::File;
+        case DT_DIR:
+            return EntryKind::Directory;
+        case DT_LNK:
+            // Symbolic links are listed when they point to a regular file
+            return (stat(fullPath.c_str(), &info) == 0 && S_ISREG(info.st_mode)) ? EntryKind::File : EntryKind::Skip;
+        case DT_UNKNOWN:
+            // Some filesystems do not report the entry type
+            if (lstat(fullPath.c_str(), &info) != 0) {
+                return EntryKind::Skip;
+            }
+            if (S_ISDIR(info.st_mode)) {
+                return EntryKind::Directory;
+            }
+            if (S_ISLNK(info.st_mode)) {
+                return entryKind(DT_LNK, fullPath);
+            }
+            return S_ISREG(info.st_mode) ? EntryKind::File : EntryKind::Skip;
+        default:
+            return EntryKind::Skip;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Builds a filter.
+ *
+ * The `--exclude` and `--include` globs are compiled once here, relative to the root of the walk.
+ *
+ * @param skipHidden Whether hidden entries are skipped.
+ * @param applyFilters Whether the ignore files and the globs of the configuration filter the entries.
+ */
+DirectoryWalker::Filter::Filter(bool skipHidden, bool applyFilters)
+    : skipHidden(skipHidden), useIgnoreFiles(applyFilters && Configuration::useIgnoreFiles) {
+    if (applyFilters && !Configuration::excludeGlobs.empty()) {
+        excludes = std::make_shared<const IgnoreRules>(Configuration::excludeGlobs, "");
+    }
+    if (applyFilters && !Configuration::includeGlobs.empty()) {
+        includes = std::make_shared<const IgnoreRules>(Configuration::includeGlobs, "");
+    }
+}
+
+/**
+ * @brief Checks whether an entry is filtered out by the ignore rules or the globs.
+ *
+ * An entry is dropped if an `--exclude` glob matches it or if the ignore files ignore it. When
+ * `--include` globs are given, files that match none of them are dropped too; directories are
+ * kept, as they may hold matching files, and so are archives with `--archives`.
+ *
+ * @param rules The ignore rules in force in the directory of the entry, or `nullptr`.
+ * @param relativePath The path of the entry relative to the root.
+ * @param isDirectory Whether the entry is a directory.
+ * @return `true` if the entry must be dropped.
+ */
+bool DirectoryWalker::Filter::isFiltered(const IgnoreRules* rules, const std::string& relativePath, bool isDirectory) const {
+    if (excludes && excludes->isIgnored(relativePath, isDirectory)) {
+        return true;
+    }
+    if (rules != nullptr && rules->isIgnored(relativePath, isDirectory)) {
+        return true;
+    }
+    if (isDirectory || !includes) {
+        return false;
+    }
+    std::size_t slash = relativePath.find_last_of('/');
+    if (Configuration::exploreArchives && Archive::hasArchiveExtension(std::string_view(relativePath).substr(slash + 1))) {
+        return false;
+    }
+    return includes->match(relativePath, false) != IgnoreRules::Verdict::Matched;
+}
+
+/**
+ * @brief Constructs a DirectoryWalker that walks part of a larger tree and starts enumerating.
+ *
+ * @param pool The pool on which directories are enumerated.
+ * @param rootPath The directory to walk.
+ * @param filter The filter applied to the entries.
+ * @param onDirectory Called for every directory read, or `nullptr`.
+ * @param rootRelativePath The path of `rootPath` relative to the root of the larger tree.
+ * @param rootRules The ignore rules in force in the parent of `rootPath`, or `nullptr`.
+ */
+DirectoryWalker::DirectoryWalker(ThreadPool& pool, const std::string& rootPath, Filter filter,
+                                 DirectoryCallback onDirectory, std::string rootRelativePath,
+                                 std::shared_ptr<const IgnoreRules> rootRules, bool measureFiles)
+    : pool(pool), filter(std::move(filter)), onDirectory(std::move(onDirectory)), measureFiles(measureFiles),
+      root(std::make_unique<Node>()) {
+    root->path = rootPath;
+    root->relativePath = std::move(rootRelativePath);
+    root->ignoreRules = std::move(rootRules);
+    stack.push_back({root.get(), 0, FileTable::rootDirectory});
+    schedule(root.get());
+}
+
+/**
+ * @brief Waits for the enumeration tasks that are still running.
+ *
+ * The tasks write into the tree owned by the walker, so it cannot be released before they finish.
+ */
+DirectoryWalker::~DirectoryWalker() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    nodeReady.wait(lock, [this] { return outstanding == 0; });
+}
+
+/**
+ * @brief Schedules the enumeration of a directory on the pool.
+ *
+ * @param node The node of the directory to read.
+ */
+void DirectoryWalker::schedule(Node* node) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++outstanding;
+    }
+    pool.submit([this, node] { enumerate(node); });
+}
+
+/**
+ * @brief Reads one directory, sorts its entries and schedules its subdirectories.
+ *
+ * The ignore files of the directory, if any, are compiled on top of the rules inherited from its
+ * parent and apply to its entries and to its whole subtree. Filtered entries are dropped before
+ * their subdirectories are scheduled, so ignored subtrees are never read.
+ *
+ * If the directory cannot be opened, an error message is printed and the directory is treated
+ * as empty, so the rest of the walk carries on.
+ *
+ * @param node The node of the directory to read.
+ */
+void DirectoryWalker::enumerate(Node* node) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Traversal);
+    DIR* directory = opendir(node->path.c_str());
+    if (directory == nullptr) {
+        std::filesystem::filesystem_error error("cannot open directory", std::filesystem::path(node->path),
+                                                std::error_code(errno, std::system_category()));
+        // Print the message in one piece, as several workers may report errors at once
+        std::cerr << std::string(SOFTWARE_NAME) + ": error: " + error.what()
+                   + " while accessing directory `" + node->path + "`\n" << std::flush;
+    } else {
+        bool hasIgnoreFile = false;
+        while (const dirent* entry = readdir(directory)) {
+            const char* name = entry->d_name;
+            // Skip the current and parent directory entries
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (filter.useIgnoreFiles && isIgnoreFile(name)) {
+                hasIgnoreFile = true;
+            }
+            // Skip hidden files and directories if configured to do so
+            if (filter.skipHidden && name[0] == '.') {
+                continue;
+            }
+
+            EntryKind kind = entryKind(entry->d_type, (entry->d_type == DT_REG || entry->d_type == DT_DIR)
+                                                          ? std::string() : joinPath(node->path, name));
+            if (kind == EntryKind::Skip) {
+                continue;
+            }
+
+            // Skip the directories walked on their own
+            if (kind == EntryKind::Directory && !filter.skippedDirectories.empty()
+                && std::find(filter.skippedDirectories.begin(), filter.skippedDirectories.end(),
+                             joinRelativePath(node->relativePath, name)) != filter.skippedDirectories.end()) {
+                continue;
+            }
+
+            Node::Entry item;
+            item.name = name;
+            if (kind == EntryKind::Directory) {
+                item.child = std::make_unique<Node>();
+            } else {
+                item.isLink = entry->d_type == DT_LNK;
+                struct stat info;
+                if (measureFiles && fstatat(dirfd(directory), name, &info, 0) == 0) {
+                    item.size = static_cast<std::uint64_t>(info.st_size);
+                }
+            }
+            node->entries.push_back(std::move(item));
+        }
+        closedir(directory);
+
+        // Compile the ignore files of the directory on top of the inherited rules
+        std::shared_ptr<const IgnoreRules> rules = node->ignoreRules;
+        if (hasIgnoreFile) {
+            std::vector<std::string> patterns;
+            for (const char* fileName : IgnoreRules::fileNames) {
+                IgnoreRules::readPatterns(joinPath(node->path, fileName), patterns);
+            }
+            auto localRules = std::make_shared<const IgnoreRules>(patterns, node->relativePath, rules);
+            if (!localRules->empty()) {
+                rules = std::move(localRules);
+            }
+        }
+
+        // Report the directory with the rules that apply to its entries
+        if (onDirectory) {
+            onDirectory(node->path, node->relativePath, rules);
+        }
+
+        // Drop the ignored entries before any subdirectory is scheduled
+        if (rules || filter.hasGlobs()) {
+            auto isFiltered = [this, node, &rules](const Node::Entry& item) {
+                return filter.isFiltered(rules.get(), joinRelativePath(node->relativePath, item.name), item.child != nullptr);
+            };
+            node->entries.erase(std::remove_if(node->entries.begin(), node->entries.end(), isFiltered),
+                                node->entries.end());
+        }
+
+        // Sort the entries so the order does not depend on the filesystem
+        std::sort(node->entries.begin(), node->entries.end(),
+                  [](const Node::Entry& a, const Node::Entry& b) { return a.name < b.name; });
+
+        for (auto& item : node->entries) {
+            if (item.child) {
+                item.child->path = joinPath(node->path, item.name);
+                item.child->relativePath = joinRelativePath(node->relativePath, item.name);
+                item.child->ignoreRules = rules;
+                schedule(item.child.get());
+            }
+        }
+    }
+
+    // Notify while holding the lock: once `outstanding` drops to zero, the destructor may return
+    // and release `nodeReady` as soon as it can take the lock
+    std::lock_guard<std::mutex> lock(stateMutex);
+    node->ready = true;
+    --outstanding;
+    nodeReady.notify_all();
+}
+
+/**
+ * @brief Returns the next regular file of the walk.
+ *
+ * @param filePath Receives the path of the file.
+ * @return `true` if a file was returned, `false` once the walk is complete.
+ */
+bool DirectoryWalker::next(std::string& filePath) {
+    const Node::Entry* item = advance();
+    if (item == nullptr) {
+        return false;
+    }
+    filePath = joinPath(stack.back().node->path, item->name);
+    return true;
+}
+
+/**
+ * @brief Adds the next regular file of the walk to a table.
+ *
+ * @param table The table receiving the file.
+ * @return `true` if a file was added, `false` once the walk is complete.
+ */
+bool DirectoryWalker::next(FileTable& table) {
+    const Node::Entry* item = advance();
+    if (item == nullptr) {
+        return false;
+    }
+    // Add the directories leading to the file that hold no file of the table yet
+    for (std::size_t depth = 1; depth < stack.size(); ++depth) {
+        if (stack[depth].tableDirectory == FileTable::noDirectory) {
+            const Frame& parent = stack[depth - 1];
+            stack[depth].tableDirectory = table.addDirectory(parent.tableDirectory, parent.node->entries[parent.index - 1].name);
+        }
+    }
+    table.addFile(stack.back().tableDirectory, item->name, item->isLink ? FileTable::Type::Link : FileTable::Type::Regular,
+                  item->size);
+    return true;
+}
+
+/**
+ * @brief Moves to the next regular file of the walk.
+ *
+ * Directories are consumed depth-first; once a directory has been fully consumed its node is
+ * released, so the memory held by the walker follows the part of the tree not yet consumed.
+ *
+ * @return The entry of the file, whose directory is the top of `stack`, or `nullptr` once the
+ *         walk is complete.
+ */
+const DirectoryWalker::Node::Entry* DirectoryWalker::advance() {
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+
+        if (frame.index == 0) {
+            // Wait for the directory to be read before looking at its entries
+            std::unique_lock<std::mutex> lock(stateMutex);
+            nodeReady.wait(lock, [&frame] { return frame.node->ready; });
+        }
+
+        if (frame.index == frame.node->entries.size()) {
+            // The directory is exhausted: release it and resume its parent
+            stack.pop_back();
+            if (!stack.empty()) {
+                Frame& parent = stack.back();
+                parent.node->entries[parent.index - 1].child.reset();
+            }
+            continue;
+        }
+
+        Node::Entry& item = frame.node->entries[frame.index++];
+        if (item.child) {
+            stack.push_back({item.child.get(), 0, FileTable::noDirectory});
+            continue;
+        }
+        return &item;
+    }
+    return nullptr;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file ExtensionTable.cpp
+ * @headerfile ExtensionTable.h
+ * @brief This file contains the implementation of the ExtensionTable class.
+ *
+ * The ExtensionTable class recognizes the file extensions of binary formats. The built-in
+ * extensions form a sorted array checked at compile time, so the table costs nothing at startup;
+ * users can add their own extensions in a configuration file read once when the program starts.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ExtensionTable.h"
+
+namespace {
+
+/**
+ * @brief Known binary file extensions, lowercase and sorted for binary search.
+ */
+constexpr std::array<std::string_view, 139> builtInExtensions = {
+    ".3ds", ".3gp", ".7z", ".aac", ".accdb", ".ahx", ".ai", ".aiff", ".ape", ".apk", ".arj", ".ass",
+    ".au", ".avi", ".bak", ".bin", ".bmp", ".bup", ".bz2", ".cab", ".chm", ".crx", ".csv", ".cue",
+    ".dae", ".dat", ".db", ".deb", ".dmg", ".dng", ".dts", ".ear", ".emf", ".eps", ".epub", ".exr",
+    ".fbx", ".flac", ".flv", ".fpk", ".gif", ".glb", ".gltf", ".gz", ".hdr", ".heic", ".heif",
+    ".ico", ".idx", ".ifo", ".img", ".iso", ".it", ".jar", ".jpeg", ".jpg", ".json", ".jxr", ".kdm",
+    ".lha", ".lz", ".lzma", ".m3u", ".m3u8", ".m4a", ".mdb", ".mdf", ".mkv", ".mobi", ".mod",
+    ".mov", ".mp3", ".mp4", ".mpc", ".mpeg", ".mpg", ".msi", ".mtm", ".nrg", ".nsf", ".nzb", ".obj",
+    ".odg", ".odm", ".odp", ".ods", ".odt", ".ogg", ".pcx", ".pdf", ".pls", ".ply", ".png", ".psd",
+    ".rar", ".raw", ".rpm", ".s3m", ".sfs", ".spx", ".sqlite", ".srt", ".stl", ".sub", ".svg",
+    ".tak", ".tar", ".tar.bz2", ".tar.gz", ".tar.xz", ".tiff", ".torrent", ".vbox", ".vdi", ".vdmk",
+    ".vhd", ".vhdx", ".vmdk", ".vob", ".voc", ".vtt", ".war", ".wav", ".webm", ".webp", ".wma",
+    ".wmf", ".wmv", ".wsf", ".wv", ".x3d", ".xap", ".xm", ".xml", ".xpi", ".xz", ".yml", ".z",
+    ".zip",
+};
+
+/**
+ * @brief Checks at compile time that the built-in table is sorted, unique and lowercase.
+ */
+constexpr bool isValidTable() {
+    for (std::size_t i = 0; i < builtInExtensions.size(); ++i) {
+        if (i > 0 && !(builtInExtensions[i - 1] < builtInExtensions[i])) {
+            return false;
+        }
+        if (builtInExtensions[i].size() > ExtensionTable::maxExtensionLength) {
+            return false;
+        }
+        for (char c : builtInExtensions[i]) {
+            if (c >= 'A' && c <= 'Z') {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(isValidTable(), "builtInExtensions must be sorted, unique, lowercase and short");
+
+std::vector<std::string> userExtensions; ///< User-defined extensions, lowercase and sorted.
+
+/**
+ * @brief Lowercases an ASCII string into a buffer.
+ */
+std::string_view toLower(std::string_view text, char* buffer) {
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        buffer[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    return std::string_view(buffer, text.size());
+}
+
+/**
+ * @brief Checks whether a lowercase extension is known.
+ */
+bool isKnown(std::string_view extension) {
+    if (std::binary_search(builtInExtensions.begin(), builtInExtensions.end(), extension)) {
+        return true;
+    }
+    return !userExtensions.empty() &&
+           std::binary_search(userExtensions.begin(), userExtensions.end(), extension,
+                              [](std::string_view a, std::string_view b) { return a < b; });
+}
+
+} // namespace
+
+/**
+ * @brief Checks whether a file name ends with a binary extension.
+ *
+ * Every suffix starting at a dot (other than a leading dot) is lowercased in a stack buffer and
+ * looked up, from the shortest to the longest.
+ *
+ * @param fileName The name of the file, without directories.
+ * @return True if the name ends with a known binary extension, otherwise false.
+ */
+bool ExtensionTable::isBinary(std::string_view fileName) {
+    char buffer[maxExtensionLength];
+    for (std::size_t dot = fileName.rfind('.'); dot != std::string_view::npos && dot > 0;
+         dot = fileName.rfind('.', dot - 1)) {
+        std::string_view suffix = fileName.substr(dot);
+        if (suffix.size() > maxExtensionLength) {
+            break;
+        }
+        if (isKnown(toLower(suffix, buffer))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the path of the default configuration file, or an empty string if unknown.
+ */
+std::string ExtensionTable::userConfigPath() {
+    if (const char* configHome = std::getenv("XDG_CONFIG_HOME"); configHome != nullptr && *configHome != '\0') {
+        return std::string(configHome) + "/mavu/binary-extensions";
+    }
+    if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+        return std::string(home) + "/.config/mavu/binary-extensions";
+    }
+    return std::string();
+}
+
+/**
+ * @brief Loads user-defined extensions from the default configuration file, if it exists.
+ */
+void ExtensionTable::loadUserExtensions() {
+    std::string configPath = userConfigPath();
+    if (!configPath.empty()) {
+        loadUserExtensions(configPath);
+    }
+}
+
+/**
+ * @brief Loads user-defined extensions from a file.
+ *
+ * @param configPath The path of the file.
+ * @return The number of extensions loaded, or 0 if the file cannot be read.
+ */
+std::size_t ExtensionTable::loadUserExtensions(const std::string& configPath) {
+    std::ifstream config(configPath);
+    if (!config.is_open()) {
+        return 0;
+    }
+
+    std::size_t loaded = 0;
+    std::string line;
+    char buffer[maxExtensionLength];
+    while (std::getline(config, line)) {
+        // Trim surrounding whitespace and skip comments
+        std::size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') {
+            continue;
+        }
+        std::size_t end = line.find_last_not_of(" \t\r");
+        std::string extension = line.substr(begin, end - begin + 1);
+        if (extension.front() != '.') {
+            extension.insert(extension.begin(), '.');
+        }
+        if (extension.size() < 2 || extension.size() > maxExtensionLength) {
+            continue;
+        }
+        userExtensions.emplace_back(toLower(extension, buffer));
+        ++loaded;
+    }
+
+    std::sort(userExtensions.begin(), userExtensions.end());
+    userExtensions.erase(std::unique(userExtensions.begin(), userExtensions.end()), userExtensions.end());
+    return loaded;
+}
@@ -3,58 +3,1336 @@
  * @headerfile FileExplorer.h
  * @brief This file contains the implementation of the FileExplorer class.
  * 
- * The FileExplorer class is responsible for exploring files in a directory. It interacts with 
- * FileManager to retrieve the list of files, uses FileReader to read the contents of the files, 
- * and displays the file contents using the Outputs class. Binary files are displayed in hexadecimal 
+ * The FileExplorer class is responsible for exploring files in a directory. It walks the directory,
+ * uses FileReader to read the contents of the files, and displays the file contents using the
+ * Outputs class. Reading and classification overlap with output through a bounded pipeline. Binary files are displayed in hexadecimal 
  * format, while text files are displayed as they are.
  * 
  * The implementation relies on C++ Standard Library's filesystem and string classes for file 
  * handling and reading.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fcntl.h>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 #include "globals.h"
+#include "Archive.h"
+#include "BoundedQueue.h"
+#include "ClassificationCache.h"
+#include "Classifier.h"
+#include "ContentHash.h"
+#include "Decompressor.h"
+#include "DirectoryWalker.h"
+#include "ExtensionTable.h"
 #include "FileExplorer.h"
 #include "FileReader.h"
+#include "FileTable.h"
+#include "HexDumper.h"
+#include "Matcher.h"
+#include "OutputWriter.h"
 #include "Outputs.h"
+#include "Profiler.h"
+#include "RecordEncoder.h"
+#include "ThreadPool.h"
+#include "UringReader.h"
+
+namespace {
 
 /**
- * @brief Explores all files in the specified directory and displays their content.
- * 
- * This function retrieves all files from the directory using the FileManager class. For each 
- * file, it reads the content using the FileReader class and displays it using the Outputs class. 
- * If the file is a binary file, it will be converted to a hexadecimal format before being displayed. 
- * Otherwise, the content is displayed as text.
- * 
- * @throws std::exception If an error occurs during file processing, an exception will be caught
- * and an error message will be displayed.
+ * @struct FileJob
+ * @brief One file travelling through the exploration pipeline.
+ *
+ * A job is created by the traversal stage, filled in by a worker thread (classification,
+ * reading and formatting), and consumed by the writer once `done` is ready.
+ */
+struct FileJob {
+    explicit FileJob(std::string path) : path(std::move(path)), done(finished.get_future()) {}
+
+    std::string path;             ///< The path of the file.
+    std::size_t root = 0;         ///< The index of the explored directory holding the file.
+    FileBuffer buffer;            ///< The content of the file, usually memory-mapped.
+    std::string_view content;     ///< The displayed part of `buffer`: all of it, or the previewed part.
+    std::uint64_t skippedBefore = 0; ///< The bytes of the file before `content`, when previewing.
+    std::uint64_t skippedAfter = 0;  ///< The bytes of the file after `content`, when previewing.
+    std::string hexContent;       ///< The hexadecimal conversion of the content, for binary files.
+    std::string matchOutput;      ///< The formatted matching lines, when searching a pattern.
+    std::uint64_t size = 0;       ///< The size of the file in bytes.
+    bool isBinary = false;        ///< Whether the file is displayed in hexadecimal.
+    bool streamed = false;        ///< Whether the file is too large to be held and is streamed by the writer.
+    std::string error;            ///< The error message if processing failed, otherwise empty.
+    bool skipped = false;         ///< Whether the file is filtered out and must not be displayed.
+    bool keyed = false;           ///< Whether `cacheable` and `key` were computed from a status read in a batch.
+    bool cacheable = false;       ///< Whether the file can be looked up in the classification cache.
+    ClassificationCache::Key key; ///< The key of the file in the classification cache, if `cacheable`.
+    bool cached = false;          ///< Whether the classification was found in the cache by the batch, if `keyed`.
+    bool cachedIsText = false;    ///< The classification found in the cache, if `cached`.
+    bool preloaded = false;       ///< Whether `buffer` already holds the whole file, read in a batch.
+    Compression compression = Compression::None; ///< The format of the file, when it is displayed decompressed.
+    std::unique_ptr<ChunkSource> remainder;      ///< The rest of a decompressed content or archive member too large to be held, after `buffer`.
+    std::unique_ptr<Archive::Member> member;     ///< The member, when the file is a member of an archive.
+    std::promise<void> finished;  ///< Fulfilled by the worker once the job is processed.
+    std::future<void> done;       ///< Ready once the job is processed.
+};
+
+/**
+ * @brief Searches a pattern in whole lines of the content of a file and formats the matching lines.
+ *
+ * Line numbers are counted lazily, only over the bytes between two matches. A binary file is
+ * reported by a single line stating that it matches.
+ *
+ * @param matcher The compiled pattern.
+ * @param content Whole lines of the content.
+ * @param lineNumber The number of the first line of `content`; receives the number of the line
+ *                   following it, unless `last` is set.
+ * @param last Whether no content follows, so the lines after the last match are not counted.
+ * @param job The job whose content is searched.
+ * @return `false` once a binary file is known to match, so the search can stop.
+ */
+bool searchLines(const Matcher& matcher, std::string_view content, std::size_t& lineNumber, bool last, FileJob& job) {
+    std::size_t lineBegin = 0;
+    std::size_t lineEnd = 0;
+    std::size_t from = 0;
+    std::size_t counted = 0;
+    while (matcher.findLine(content, from, lineBegin, lineEnd)) {
+        if (job.isBinary) {
+            job.matchOutput = "binary file matches\n";
+            return false;
+        }
+        lineNumber += static_cast<std::size_t>(std::count(content.begin() + counted, content.begin() + lineBegin, '\n'));
+        counted = lineBegin;
+        Outputs::appendMatchingLine(job.matchOutput, lineNumber, content.substr(lineBegin, lineEnd - lineBegin));
+        from = lineEnd + 1;
+    }
+    if (!last) {
+        lineNumber += static_cast<std::size_t>(std::count(content.begin() + counted, content.end(), '\n'));
+    }
+    return true;
+}
+
+/**
+ * @brief Searches a pattern in the content of a file and formats the matching lines.
+ *
+ * A decompressed content or archive member too large to be held is searched chunk by chunk:
+ * the whole lines read so far are searched, and the incomplete last one is kept for the next chunk. A
+ * line longer than `FileReader::streamThreshold` is searched in pieces. Files without any match
+ * are skipped.
+ *
+ * @param matcher The compiled pattern.
+ * @param job The job whose content is searched.
+ */
+void searchFile(const Matcher& matcher, FileJob& job) {
+    std::size_t lineNumber = 1;
+    if (job.remainder == nullptr) {
+        searchLines(matcher, job.buffer.view(), lineNumber, true, job);
+    } else {
+        std::string window(job.buffer.view());
+        job.buffer = FileBuffer();
+        std::string_view chunk;
+        bool more = true;
+        while (more) {
+            more = job.remainder->next(chunk);
+            window.append(chunk);
+            std::size_t end = window.size();
+            if (more) {
+                std::size_t newline = window.rfind('\n');
+                end = newline != std::string::npos ? newline + 1 : (end > FileReader::streamThreshold ? end : 0);
+            }
+            if (!searchLines(matcher, std::string_view(window).substr(0, end), lineNumber, !more, job)) {
+                break;
+            }
+            window.erase(0, end);
+        }
+        job.remainder.reset();
+    }
+    job.skipped = job.matchOutput.empty();
+}
+
+/**
+ * @brief Replaces the content of a job with a content read in chunks, for `-z` and `--archives`.
+ *
+ * Up to `FileReader::streamThreshold` bytes are held in the buffer of the job, so small contents
+ * go through the usual path. When the content is longer, the source is kept in the job, to go
+ * on from there.
+ *
+ * @param source The decompressed content of the file, or the content of an archive member.
+ * @param job The job of the file.
+ */
+void loadContent(std::unique_ptr<ChunkSource> source, FileJob& job) {
+    std::string content;
+    std::string_view chunk;
+    bool more = true;
+    while (content.size() < FileReader::streamThreshold && (more = source->next(chunk))) {
+        content.append(chunk);
+    }
+    if (more) {
+        job.remainder = std::move(source);
+    }
+    job.buffer = FileBuffer(std::move(content));
+    job.size = job.buffer.size();
+}
+
+/**
+ * @brief Checks whether the start of a content holds everything displayed by `--head` or `--max-bytes`.
+ *
+ * @param content The start of the content.
+ * @param newlines The number of newlines in `content`.
+ * @param isBinary Whether the file is binary, so `--head` counts rows rather than lines.
+ */
+bool holdsHead(std::string_view content, std::size_t newlines, bool isBinary) {
+    if (Configuration::maxBytes > 0 && content.size() >= Configuration::maxBytes) {
+        return true;
+    }
+    if (Configuration::headLines == 0) {
+        return false;
+    }
+    return isBinary ? content.size() / FileReader::binaryRowLength >= Configuration::headLines
+                    : newlines >= Configuration::headLines;
+}
+
+/**
+ * @brief Returns where the part of a content that `--tail` and `--max-bytes` may display starts.
+ *
+ * One line more than displayed is kept, since the last newline of the content so far may end
+ * the content and then does not start a line. Content that follows can only move the start
+ * further, so the bytes before it are never needed again.
+ *
+ * @param content The end of the content decompressed so far.
+ * @param isBinary Whether the file is binary, so `--tail` counts rows rather than lines.
+ */
+std::size_t tailStart(std::string_view content, bool isBinary) {
+    std::size_t size = content.size();
+    std::uint64_t lines = Configuration::tailLines;
+    std::size_t start = 0;
+    if (isBinary) {
+        start = lines < size / FileReader::binaryRowLength ? size - static_cast<std::size_t>(lines) * FileReader::binaryRowLength : 0;
+    } else {
+        std::size_t end = size;
+        std::uint64_t found = 0;
+        const void* newline;
+        while (found <= lines && end > 0 && (newline = memrchr(content.data(), '\n', end)) != nullptr) {
+            end = static_cast<std::size_t>(static_cast<const char*>(newline) - content.data());
+            ++found;
+        }
+        start = found > lines ? end + 1 : 0;
+    }
+    if (Configuration::maxBytes > 0 && size > Configuration::maxBytes) {
+        start = std::max(start, size - static_cast<std::size_t>(Configuration::maxBytes));
+    }
+    return start;
+}
+
+/**
+ * @brief Selects the previewed part of a decompressed content or archive member too large to be held.
+ *
+ * The rest of the content is decompressed chunk by chunk. With `--tail`, only the end of the
+ * content that may be displayed is kept; otherwise the content is kept until it holds the
+ * displayed part, and is then only measured, so the bytes left out after the preview can be
+ * counted. The previewed part is selected in the kept content by `FileReader::previewWindow`,
+ * as for the other files.
+ *
+ * @param job The job of the file, with its first bytes in `buffer` and the rest in `remainder`.
+ */
+void previewDecompressed(FileJob& job) {
+    std::string window(job.buffer.view());
+    job.buffer = FileBuffer();
+    bool tail = Configuration::tailLines > 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t total = window.size();
+    std::size_t newlines = tail ? 0 : static_cast<std::size_t>(std::count(window.begin(), window.end(), '\n'));
+    bool full = !tail && holdsHead(window, newlines, job.isBinary);
+    std::string_view chunk;
+    while (job.remainder->next(chunk)) {
+        total += chunk.size();
+        if (tail) {
+            window.append(chunk);
+            // Drop the bytes that are not needed anymore, once they are worth moving the others
+            std::size_t start = tailStart(window, job.isBinary);
+            if (start >= window.size() / 2) {
+                window.erase(0, start);
+                dropped += start;
+            }
+        } else if (!full) {
+            window.append(chunk);
+            newlines += static_cast<std::size_t>(std::count(chunk.begin(), chunk.end(), '\n'));
+            full = holdsHead(window, newlines, job.isBinary);
+        }
+    }
+    job.remainder.reset();
+    job.size = total;
+    job.buffer = FileBuffer(std::move(window));
+    job.content = FileReader::previewWindow(job.buffer, job.isBinary);
+    job.skippedBefore = dropped + static_cast<std::uint64_t>(job.content.data() - job.buffer.view().data());
+    job.skippedAfter = total - job.skippedBefore - job.content.size();
+}
+
+/**
+ * @brief Reads, classifies and formats one file.
+ *
+ * Files with a known binary extension are skipped without being opened when binary files are
+ * hidden, and so are files that the classification cache knows to be binary. Other files are
+ * memory-mapped and classified from the mapped content, unless the cache already knows the
+ * result; new results are recorded in the cache. The result both
+ * filters out binary files (unless they are shown) and decides whether the content is converted
+ * to hexadecimal. Text content is never copied: the writer displays it straight from the mapping.
+ * Files larger than `FileReader::streamThreshold` are only classified here, from their first
+ * bytes, and are left for the writer to stream in chunks. The time spent on the file is recorded
+ * as its processing latency when profiling. When a pattern is searched, files are mapped whole
+ * whatever their size, and only their matching lines are kept. In the structured output formats,
+ * binary content is left as is for the record encoder, which encodes it while writing.
+ *
+ * With `--head`, `--tail` or `--max-bytes`, files are mapped whole but never streamed: they are
+ * classified from their first `FileReader::previewSniffLength` bytes only, and only the previewed
+ * part of their content is touched, converted and displayed. Results classified from a smaller
+ * sample than usual are not cached.
+ *
+ * With `--io=uring`, the status and the content of small files may already have been read in a
+ * batch by the traversal stage; the file is then neither stat'ed nor opened again here.
+ *
+ * With `-z`, gzip, xz and bzip2 files are recognized by their first bytes and their decompressed
+ * content takes the place of the file: it is classified, searched and previewed like any other
+ * content, and its classification is not cached, since the cache describes the file itself. A
+ * file that the cache knows to be binary is still checked for a compression magic number. When
+ * the decompressed content is too large to be held, it is searched or previewed chunk by chunk
+ * here, or left for the writer to stream, still decompressing.
+ *
+ * With `--archives`, the members of archives are processed the same way from their content,
+ * which the traversal stage may already have read while listing a compressed tar archive. Their
+ * classification is not cached, and they are not decompressed by `-z`.
+ *
+ * @param fileManager The file manager used to classify the file.
+ * @param matcher The pattern to search, or `nullptr` to display whole files.
+ * @param job The job to process.
+ */
+void processFile(const FileManager& fileManager, const Matcher* matcher, FileJob& job) {
+    auto start = Profiler::isEnabled() ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    std::uint64_t truncated = FileReader::truncatedReads();
+    try {
+        bool hasBinaryExtension = fileManager.hasBinaryExtension(job.path);
+        ClassificationCache::Key key = job.key;
+        bool cacheable = !hasBinaryExtension && job.member == nullptr
+                         && (job.keyed ? job.cacheable : ClassificationCache::keyOf(job.path, key));
+        // A file read in a batch was already looked up, which must not be counted twice
+        bool cachedIsText = job.cachedIsText;
+        bool cached = cacheable && (job.keyed ? job.cached : ClassificationCache::lookup(key, cachedIsText));
+        bool hidden = (hasBinaryExtension || (cached && !cachedIsText)) && !Configuration::showBinaryFiles;
+        if (hidden && !hasBinaryExtension && Configuration::decompress && Decompressor::detectFile(job.path) != Compression::None) {
+            // The compressed file is binary, but its content may not be
+            hidden = false;
+        }
+        if (hidden) {
+            job.skipped = true;
+        } else {
+            // Read the content of the current file and check if it is binary
+            bool preview = matcher == nullptr && FileReader::isPreviewing();
+            if (job.member != nullptr) {
+                if (!job.preloaded) {
+                    std::string archivePath = job.path.substr(0, job.path.size() - job.member->name.size() - 2);
+                    loadContent(Archive::openMember(archivePath, *job.member), job);
+                }
+            } else if (preview) {
+                job.buffer = FileReader::mapForPreview(job.path);
+            } else if (!job.preloaded) {
+                job.buffer = FileReader::mapFile(job.path, matcher != nullptr ? std::numeric_limits<std::size_t>::max()
+                                                                              : FileReader::streamThreshold);
+            }
+            job.size = job.member != nullptr ? job.member->size : job.buffer.size();
+            Compression compression = Configuration::decompress && job.member == nullptr ? Decompressor::detect(job.buffer.view())
+                                                                                         : Compression::None;
+            if (compression != Compression::None) {
+                job.compression = compression;
+                loadContent(std::make_unique<Decompressor>(job.path, compression), job);
+                cacheable = false;
+                cached = false;
+            }
+            std::size_t sampled = 0;
+            if (hasBinaryExtension) {
+                job.isBinary = true;
+            } else if (cached) {
+                job.isBinary = !cachedIsText;
+            } else {
+                std::string_view sample = job.buffer.view();
+                if (preview) {
+                    sample = sample.substr(0, FileReader::previewSniffLength);
+                }
+                sampled = sample.size();
+                job.isBinary = !Classifier::isTextContent(sample);
+                if (cacheable && sampled >= std::min(job.buffer.view().size(), Classifier::sniffLength)) {
+                    ClassificationCache::store(key, !job.isBinary);
+                }
+            }
+            if (job.isBinary && !Configuration::showBinaryFiles) {
+                job.skipped = true;
+                job.buffer = FileBuffer();
+                job.remainder.reset();
+            } else if (matcher != nullptr) {
+                // Keep only the matching lines
+                searchFile(*matcher, job);
+                job.buffer = FileBuffer();
+            } else if (!job.buffer.isComplete() || (job.remainder != nullptr && !preview)) {
+                // Leave large files to the writer, which streams them in chunks
+                job.streamed = true;
+                if (job.remainder == nullptr) {
+                    job.buffer = FileBuffer();
+                } else if (Configuration::outputFormat != OutputFormat::Text && compression != Compression::None) {
+                    // Records announce the size of their content: measure it, then start over
+                    std::string_view chunk;
+                    while (job.remainder->next(chunk)) {
+                        job.size += chunk.size();
+                    }
+                    job.remainder = std::make_unique<Decompressor>(job.path, job.compression);
+                    job.buffer = FileBuffer();
+                }
+            } else {
+                job.content = job.buffer.view();
+                if (preview && job.remainder != nullptr) {
+                    previewDecompressed(job);
+                } else if (preview) {
+                    // Keep only the previewed part, and count the bytes actually touched
+                    job.content = FileReader::previewWindow(job.buffer, job.isBinary);
+                    job.skippedBefore = static_cast<std::uint64_t>(job.content.data() - job.buffer.view().data());
+                    job.skippedAfter = job.size - job.skippedBefore - job.content.size();
+                    if (compression == Compression::None && job.member == nullptr) {
+                        std::uint64_t end = job.skippedBefore + job.content.size();
+                        std::uint64_t gap = job.skippedBefore > sampled ? job.skippedBefore - sampled : 0;
+                        Profiler::count(Profiler::Counter::BytesRead, std::max<std::uint64_t>(sampled, end) - gap);
+                    }
+                }
+                if (job.isBinary && Configuration::outputFormat == OutputFormat::Text) {
+                    // Convert the binary content to hexadecimal format
+                    job.hexContent = Configuration::hexStyle == HexStyle::Canonical
+                                     ? Outputs::convertToHexDump(job.content, job.skippedBefore)
+                                     : Outputs::convertToHex(job.content);
+                    job.content = {};
+                    job.buffer = FileBuffer();
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        job.error = e.what();
+    }
+    if (FileReader::truncatedReads() != truncated && job.error.empty()) {
+        // The file was truncated while mapped: what was read past its end is not its content
+        job.error = "File changed while being read";
+        job.content = {};
+        job.hexContent.clear();
+        job.matchOutput.clear();
+        job.buffer = FileBuffer();
+    }
+    if (Profiler::isEnabled()) {
+        Profiler::recordLatency(std::chrono::steady_clock::now() - start);
+    }
+    job.finished.set_value();
+}
+
+/**
+ * @brief Reads the status and the content of a batch of files through io_uring.
+ *
+ * The status of every file gives its classification cache key, which is looked up once here,
+ * so the workers neither stat the files nor look them up again. Files that the cache knows to
+ * be binary are not read when binary files are hidden, since the workers skip them; the other
+ * small files are read whole into their job.
+ *
+ * @param uring The reader.
+ * @param fileManager The file manager used to classify the files.
+ * @param batch The jobs of the files to read.
+ * @param requests Storage for the requests, reused between batches.
+ * @throw std::system_error If the ring cannot be used anymore; the jobs are then left as they were.
+ */
+void readBatch(UringReader& uring, const FileManager& fileManager, const std::vector<std::shared_ptr<FileJob>>& batch,
+               std::vector<UringReader::Request>& requests) {
+    requests.resize(batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        requests[i] = UringReader::Request();
+        requests[i].path = &batch[i]->path;
+    }
+    uring.stat(requests);
+
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        FileJob& job = *batch[i];
+        job.cacheable = requests[i].statted && !fileManager.hasBinaryExtension(job.path)
+                        && ClassificationCache::keyOf(requests[i].info, job.key);
+        job.cached = job.cacheable && ClassificationCache::lookup(job.key, job.cachedIsText);
+        requests[i].wanted = Configuration::showBinaryFiles || !job.cached || job.cachedIsText;
+    }
+    uring.load(requests);
+
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        FileJob& job = *batch[i];
+        job.keyed = requests[i].statted;
+        if (requests[i].loaded) {
+            job.buffer = FileBuffer(std::move(requests[i].content));
+            job.preloaded = true;
+        }
+    }
+}
+
+/**
+ * @brief Hashes the whole content of a file for `--dedupe`.
+ *
+ * The file is mapped rather than read, and only if it still has the size measured by the walk,
+ * so that the files of a group are known to have the same size. A file truncated while it is
+ * hashed is not hashed.
+ *
+ * @param path The path of the file.
+ * @param size The size of the file measured by the walk.
+ * @param hash Receives the hash of the content.
+ * @return `true` if the file was hashed. Files that cannot be hashed are never grouped; their
+ *         errors are reported when they are displayed.
+ */
+bool hashFile(const std::string& path, std::uint64_t size, std::uint64_t& hash) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Hash);
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    Profiler::count(Profiler::Counter::ReadCalls);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    bool unchanged = fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && static_cast<std::uint64_t>(info.st_size) == size;
+    void* mapping = unchanged ? mmap(nullptr, static_cast<std::size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    Profiler::count(Profiler::Counter::ReadCalls);
+    Profiler::count(Profiler::Counter::BytesRead, size);
+    madvise(mapping, static_cast<std::size_t>(size), MADV_SEQUENTIAL);
+    FileBuffer buffer(mapping, static_cast<std::size_t>(size), size);
+    std::uint64_t truncated = FileReader::truncatedReads();
+    hash = ContentHash::hash(buffer.view());
+    // A file truncated while being hashed is not grouped
+    return FileReader::truncatedReads() == truncated;
+}
+
+/**
+ * @class ContentReader
+ * @brief Reads the content of a streamed file in chunks: the file itself, or with `-z` its
+ *        decompressed content and with `--archives` the content of a member, starting with
+ *        the part held by the job.
+ */
+class ContentReader {
+public:
+    /**
+     * @brief Opens the content of a streamed file.
+     *
+     * @param job The job of the file.
+     * @throw std::filesystem::filesystem_error If the file cannot be opened.
+     */
+    explicit ContentReader(const FileJob& job) : job(job), held(job.buffer.view()) {
+        if (job.remainder == nullptr) {
+            reader = std::make_unique<FileChunkReader>(job.path, FileReader::chunkSize);
+        }
+    }
+
+    /**
+     * @brief Reads the next chunk of the content.
+     *
+     * @param chunk Receives a view of the chunk, valid until the next call.
+     * @return `true` if a chunk was read, `false` at the end of the content.
+     */
+    bool next(std::string_view& chunk) {
+        if (reader != nullptr) {
+            return reader->next(chunk);
+        }
+        if (!held.empty()) {
+            chunk = held;
+            held = {};
+            return true;
+        }
+        return job.remainder->next(chunk);
+    }
+
+private:
+    const FileJob& job;                      ///< The job of the file.
+    std::string_view held;                   ///< The content held by the job and not yet read.
+    std::unique_ptr<FileChunkReader> reader; ///< The reader of the file, when it is not decompressed.
+};
+
+/**
+ * @brief Displays a file by streaming it in fixed-size chunks.
+ *
+ * Each chunk is read into the same buffer, converted to hexadecimal for binary files, and written
+ * before the next one is read, so memory use is constant whatever the size of the file. The
+ * output is identical to displaying the whole content at once. With `-z`, the chunks are
+ * decompressed from the file instead.
+ *
+ * @param relativePath The path of the file relative to the explored directory.
+ * @param job The job of the file to display.
+ * @param copies The other files with the same content, with `--dedupe`.
+ * @throw std::exception If the file cannot be opened or read; the file output is closed first.
+ */
+void streamFile(std::string_view relativePath, const FileJob& job, const std::vector<std::string>& copies) {
+    ContentReader reader(job);
+    Outputs::displayFileHeader(relativePath, copies);
+    try {
+        std::string_view chunk;
+        std::string hexChunk;
+        bool canonical = job.isBinary && Configuration::hexStyle == HexStyle::Canonical;
+        HexDumper dumper;
+        while (reader.next(chunk)) {
+            if (canonical) {
+                Profiler::ScopedTimer timer(Profiler::Stage::Hex);
+                hexChunk.clear();
+                dumper.dump(chunk, hexChunk);
+                chunk = hexChunk;
+            } else if (job.isBinary) {
+                Outputs::convertToHex(chunk, hexChunk);
+                chunk = hexChunk;
+            }
+            Outputs::displayContentChunk(chunk);
+        }
+        if (canonical) {
+            hexChunk.clear();
+            dumper.finish(hexChunk);
+            Outputs::displayContentChunk(hexChunk);
+        }
+    } catch (...) {
+        Outputs::displayFileFooter();
+        throw;
+    }
+    Outputs::displayFileFooter();
+}
+
+/**
+ * @struct HexSegment
+ * @brief A segment of a large binary file, converted to hexadecimal on a worker thread.
+ */
+struct HexSegment {
+    HexSegment() : done(finished.get_future()) {}
+
+    std::string output;          ///< The hexadecimal form of the segment.
+    std::string error;           ///< The error message if reading failed, otherwise empty.
+    bool ended = false;          ///< Whether the file ends in this segment.
+    std::promise<void> finished; ///< Fulfilled by the worker once the segment is converted.
+    std::future<void> done;      ///< Ready once `output` or `error` is set.
+};
+
+/**
+ * @brief Reads and converts one segment of a binary file.
+ *
+ * With the canonical style, the two rows before the segment are read too, so the dumper starts
+ * in the state it would have reached by dumping the whole file up to the segment. The segment
+ * where the file ends closes the dump: the last one, or the first one cut short if the file
+ * shrank since it was classified.
+ *
+ * @param fd The open file.
+ * @param begin The offset of the segment, a multiple of `HexDumper::rowSize`.
+ * @param size The size of the segment.
+ * @param last Whether this is the last segment of the file.
+ * @param segment Receives the conversion.
+ */
+void convertSegment(int fd, std::uint64_t begin, std::size_t size, bool last, HexSegment& segment) {
+    try {
+        bool canonical = Configuration::hexStyle == HexStyle::Canonical;
+        std::size_t before = canonical ? static_cast<std::size_t>(std::min<std::uint64_t>(begin, 2 * HexDumper::rowSize)) : 0;
+        thread_local std::string input;
+        input.resize(before + size);
+        std::size_t read = FileReader::readAt(fd, begin - before, input.data(), before + size);
+        std::string_view rows(input.data(), std::min(read, before));
+        std::string_view content(input.data() + rows.size(), read - rows.size());
+
+        Profiler::ScopedTimer timer(Profiler::Stage::Hex);
+        segment.ended = last || content.size() < size;
+        if (canonical) {
+            segment.output.clear();
+            HexDumper dumper(begin, rows);
+            dumper.dump(content, segment.output);
+            if (segment.ended) {
+                dumper.finish(segment.output);
+            }
+        } else {
+            Outputs::convertToHex(content, segment.output);
+        }
+    } catch (const std::exception& e) {
+        segment.error = e.what();
+    }
+    segment.finished.set_value();
+}
+
+/**
+ * @brief Displays a large binary file by converting segments of it on the worker threads.
+ *
+ * The file is cut into segments of `FileReader::chunkSize` bytes at offsets computed from the
+ * size read when the file was classified, so every segment can be read and converted on its own.
+ * The segments are converted in parallel, at most `inFlight` at a time to bound memory use, and
+ * written in order. The output is identical to the one of `streamFile`, unless the file grows
+ * while it is displayed: the bytes past the classified size are left out.
+ *
+ * @param pool The pool converting the segments.
+ * @param inFlight The largest number of segments being converted or waiting to be written.
+ * @param spare The segments already written, reused so that their buffers are not allocated and
+ *              faulted in again for every segment and every file.
+ * @param relativePath The path of the file relative to the explored directory.
+ * @param job The job of the file to display.
+ * @param copies The other files with the same content, with `--dedupe`.
+ * @throw std::exception If the file cannot be opened or read; the file output is closed first.
+ */
+void streamSegments(ThreadPool& pool, std::size_t inFlight, std::vector<std::shared_ptr<HexSegment>>& spare,
+                    std::string_view relativePath, const FileJob& job, const std::vector<std::string>& copies) {
+    int fd = open(job.path.c_str(), O_RDONLY | O_CLOEXEC);
+    Profiler::count(Profiler::Counter::ReadCalls);
+    if (fd < 0) {
+        throw std::filesystem::filesystem_error("Cannot open file", std::filesystem::path(job.path),
+                                                std::error_code(errno, std::system_category()));
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    Outputs::displayFileHeader(relativePath, copies);
+    std::deque<std::shared_ptr<HexSegment>> segments;
+    std::uint64_t next = 0;
+    std::string error;
+    bool ended = false;
+    while (!ended && error.empty() && (next < job.size || !segments.empty())) {
+        // Keep the workers busy with the next segments
+        for (; next < job.size && segments.size() < inFlight; next += FileReader::chunkSize) {
+            std::shared_ptr<HexSegment> segment;
+            if (spare.empty()) {
+                segment = std::make_shared<HexSegment>();
+            } else {
+                segment = std::move(spare.back());
+                spare.pop_back();
+                segment->finished = std::promise<void>();
+                segment->done = segment->finished.get_future();
+            }
+            std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(FileReader::chunkSize, job.size - next));
+            bool last = next + size == job.size;
+            pool.submit([fd, next, size, last, segment] { convertSegment(fd, next, size, last, *segment); });
+            segments.push_back(std::move(segment));
+        }
+
+        std::shared_ptr<HexSegment> segment = std::move(segments.front());
+        segments.pop_front();
+        segment->done.wait();
+        error = segment->error;
+        ended = segment->ended;
+        Outputs::displayContentChunk(segment->output);
+        spare.push_back(std::move(segment));
+    }
+
+    // The workers may still be reading the file
+    for (auto& segment : segments) {
+        segment->done.wait();
+        spare.push_back(std::move(segment));
+    }
+    close(fd);
+    Outputs::displayFileFooter();
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+/**
+ * @brief Reports an error on a file, in place of the file.
+ *
+ * The output buffered so far is written first, so that the error appears after the files
+ * displayed before it when both streams go to the same place.
+ *
+ * @param message The error message.
+ * @param path The path of the file.
+ */
+void reportError(const std::string& message, const std::string& path) {
+    OutputWriter::standardOutput().flush();
+    std::cerr << SOFTWARE_NAME << ": error: " << message << " while processing file `" << std::filesystem::path(path) << "`" << std::endl;
+}
+
+/**
+ * @brief Writes a file held in memory as a record of the structured output format.
+ *
+ * The content is the whole file, or its matching lines when a pattern is searched. It is handed
+ * to the encoder as it is in the job: binary content is encoded while being written.
+ *
+ * @param encoder The encoder of the output.
+ * @param relativePath The path of the file relative to the explored directory.
+ * @param job The job of the file to write.
+ * @param searched Whether the content is the matching lines of the file.
+ * @param copies The other files with the same content, with `--dedupe`.
+ */
+void writeRecord(RecordEncoder& encoder, std::string_view relativePath, const FileJob& job, bool searched,
+                 const std::vector<std::string>& copies) {
+    std::string_view content = searched ? std::string_view(job.matchOutput) : job.content;
+    encoder.begin({relativePath, job.size, job.isBinary, job.isBinary && !searched, content.size(),
+                   job.skippedBefore, job.skippedBefore + job.skippedAfter, &copies});
+    encoder.write(content);
+    encoder.end();
+}
+
+/**
+ * @brief Writes a file as a record of the structured output format by streaming it in chunks.
+ *
+ * Each chunk is encoded into the output before the next one is read, as in `streamFile`.
+ *
+ * @param encoder The encoder of the output.
+ * @param relativePath The path of the file relative to the explored directory.
+ * @param job The job of the file to write.
+ * @param copies The other files with the same content, with `--dedupe`.
+ * @throw std::exception If the file cannot be opened or read; the record is closed first.
+ */
+void streamRecord(RecordEncoder& encoder, std::string_view relativePath, const FileJob& job,
+                  const std::vector<std::string>& copies) {
+    ContentReader reader(job);
+    encoder.begin({relativePath, job.size, job.isBinary, job.isBinary, job.size, 0, 0, &copies});
+    try {
+        std::string_view chunk;
+        while (reader.next(chunk)) {
+            encoder.write(chunk);
+        }
+    } catch (...) {
+        encoder.end();
+        throw;
+    }
+    encoder.end();
+}
+
+/**
+ * @brief Checks whether a member of an archive is hidden: whether any component of its name starts with a dot.
+ */
+bool isHiddenMember(std::string_view name) {
+    for (std::size_t start = 0; start < name.size();) {
+        if (name[start] == '.') {
+            return true;
+        }
+        std::size_t slash = name.find('/', start);
+        start = slash == std::string_view::npos ? name.size() : slash + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief Queues the regular files of an archive as files of their own, for `--archives`.
+ *
+ * The members are listed in archive order and filtered like the files of a directory, on their
+ * path relative to the root: `archive!/name`. While a compressed tar archive is decompressed to
+ * be listed, the content of its small members is kept in their job, so it is not decompressed
+ * again; the other members are only read by the workers. An archive that cannot be listed is
+ * reported in place of its remaining members.
+ *
+ * @param archivePath The path of the archive.
+ * @param root The index of the explored directory holding the archive.
+ * @param fileManager The file manager of that directory.
+ * @param filter The filter of the members.
+ * @param relativeStorage Storage for relative paths, reused between calls.
+ * @param queueJob Queues a job; returns `false` once the pipeline is closed.
+ * @return `false` if the pipeline was closed.
+ */
+bool queueMembers(const std::string& archivePath, std::size_t root, const FileManager& fileManager,
+                  const DirectoryWalker::Filter& filter, std::string& relativeStorage,
+                  const std::function<bool(const std::shared_ptr<FileJob>&)>& queueJob) {
+    std::string error;
+    try {
+        Archive archive(archivePath);
+        std::string relativeArchive(fileManager.relativePath(archivePath, relativeStorage));
+        Archive::Member member;
+        while (archive.next(member)) {
+            if ((filter.skipHidden && isHiddenMember(member.name))
+                || filter.isFiltered(nullptr, Archive::memberPath(relativeArchive, member.name), false)) {
+                continue;
+            }
+            Profiler::count(Profiler::Counter::FilesVisited);
+            auto job = std::make_shared<FileJob>(Archive::memberPath(archivePath, member.name));
+            job->root = root;
+            bool hidden = !Configuration::showBinaryFiles && fileManager.hasBinaryExtension(job->path);
+            std::string content;
+            if (!hidden && archive.hold(content)) {
+                job->buffer = FileBuffer(std::move(content));
+                job->preloaded = true;
+            }
+            job->member = std::make_unique<Archive::Member>(std::move(member));
+            if (!queueJob(job)) {
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    auto job = std::make_shared<FileJob>(archivePath);
+    job->root = root;
+    job->error = std::move(error);
+    job->finished.set_value();
+    return queueJob(job);
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a FileExplorer object over several directories.
+ *
+ * The directories are compared on their canonical paths, so that different spellings of the
+ * same directory, or symbolic links to it, are recognized. A directory that cannot be resolved
+ * is kept as it is, and its errors are reported when it is walked.
+ *
+ * @param paths The directory paths to explore, in display order.
+ * @param matcher The pattern to search in the files, or `nullptr`.
+ */
+FileExplorer::FileExplorer(const std::vector<std::string>& paths, const Matcher* matcher)
+    : FileExplorer(resolveRoots(paths), matcher) {}
+
+/**
+ * @brief Constructs a FileExplorer object over directories already resolved by `resolveRoots`.
+ *
+ * @param roots The directories to explore, in display order.
+ * @param matcher The pattern to search in the files, or `nullptr`.
+ */
+FileExplorer::FileExplorer(std::vector<RootDirectory> roots, const Matcher* matcher) : matcher(matcher) {
+    for (RootDirectory& root : roots) {
+        this->roots.push_back({FileManager(root.path), std::move(root.nestedDirectories)});
+    }
+}
+
+/**
+ * @brief Drops the directories that are the same as an earlier one and finds the nested ones.
+ *
+ * Directories are compared by canonical path, so a symbolic link to a directory and the
+ * directory itself are the same. A directory whose path cannot be resolved is kept as is, so
+ * that its error is reported when it is walked.
+ *
+ * @param paths The directory paths, in display order.
+ * @return The remaining directories, in display order, each with the relative paths of the
+ *         other remaining directories nested in it.
+ */
+std::vector<FileExplorer::RootDirectory> FileExplorer::resolveRoots(const std::vector<std::string>& paths) {
+    std::vector<RootDirectory> roots;
+    std::vector<std::string> resolved;
+    for (const std::string& path : paths) {
+        std::error_code error;
+        std::string canonical = std::filesystem::canonical(path, error).native();
+        if (error) {
+            canonical.clear();
+        } else if (std::find(resolved.begin(), resolved.end(), canonical) != resolved.end()) {
+            continue;
+        }
+        roots.push_back({path, {}});
+        resolved.push_back(std::move(canonical));
+    }
+
+    // Leave every root out of the walks of the roots it is nested in. Canonical paths have no
+    // trailing slash, except for the root directory itself.
+    for (std::size_t outer = 0; outer < roots.size(); ++outer) {
+        const std::string& prefix = resolved[outer];
+        std::size_t length = !prefix.empty() && prefix.back() == '/' ? prefix.size() : prefix.size() + 1;
+        for (std::size_t inner = 0; inner < roots.size(); ++inner) {
+            const std::string& path = resolved[inner];
+            if (inner != outer && !prefix.empty() && path.size() > length && path.compare(0, prefix.size(), prefix) == 0
+                && path[length - 1] == '/') {
+                roots[outer].nestedDirectories.push_back(path.substr(length));
+            }
+        }
+    }
+    return roots;
+}
+
+/**
+ * @brief Explores all files in the specified directories and displays their content.
+ *
+ * The exploration runs as a pipeline. A traversal thread walks the directory and queues the files
+ * in display order; each queued file is classified, read and (for binary files) converted to
+ * hexadecimal on a worker thread of the pool; the calling thread writes the results in queue
+ * order. The queue holds at most four files per worker (and at least `minQueueDepth`), so memory
+ * use is bounded by the queue depth rather than by the size of the tree, and output starts as
+ * soon as the first file has been processed. Files too large to be held are streamed by the
+ * writer in fixed-size chunks. When a pattern is searched, only the files that match are
+ * displayed, with their matching lines. The structured output formats write one record per file
+ * instead, through a `RecordEncoder`.
+ *
+ * All the directories share the pool and the pipeline: their files are queued one directory
+ * after the other, and the next directories are already enumerated while the files of the
+ * current one are displayed.
+ *
+ * @note Errors that occur while processing a file are reported in order, in place of the file.
  */
 void FileExplorer::explore() {
-    // Retrieve all files from the directory
-    std::vector<std::filesystem::path> files = fileManager.getAllFiles();
+    ThreadPool pool(Configuration::threadCount);
+    if (Configuration::dedupe) {
+        exploreDeduplicated(pool);
+        return;
+    }
 
-    // Iterate over all the files retrieved
-    for (const auto& file : files) {
-        try {
-            // Read the content of the current file
-            std::string content = FileReader::readFile(file.string());
-
-            // Check if the file is binary
-            if (fileManager.hasBinaryExtension(file) || !fileManager.isTextMimeType(file)) {
-                // Convert the binary content to hexadecimal format
-                std::string hexContent = Outputs::convertToHex(content);
-                // Display the content in hexadecimal format
-                Outputs::displayFileContent(fileManager.dirPath, file, hexContent);
+    // Enumerate the next roots while the files of the current one are displayed
+    std::size_t walkersAhead = std::max<std::size_t>(2, pool.size());
+    std::deque<std::unique_ptr<DirectoryWalker>> walkers;
+    std::size_t started = 0;
+    std::size_t current = 0;
+    auto startWalkers = [this, &pool, &walkers, &started, walkersAhead] {
+        for (; started < roots.size() && walkers.size() < walkersAhead; ++started) {
+            walkers.push_back(std::make_unique<DirectoryWalker>(pool, roots[started].fileManager.dirPath,
+                                                                walkFilter(roots[started])));
+        }
+    };
+    startWalkers();
+    display(pool, [&walkers, &current, &startWalkers](std::string& filePath, std::size_t& root) {
+        while (!walkers.empty()) {
+            if (walkers.front()->next(filePath)) {
+                root = current;
+                return true;
+            }
+            walkers.pop_front();
+            ++current;
+            startWalkers();
+        }
+        return false;
+    });
+}
+
+/**
+ * @brief Displays the given files, in the given order.
+ *
+ * The files go through the same pipeline as in `explore`, without walking the directories: they
+ * are classified, read and filtered the same way, and their paths are displayed relative to
+ * their explored directory. The pool is left running, so a caller displaying files again and
+ * again does not start threads every time.
+ *
+ * @param pool The pool running the workers.
+ * @param files The paths of the files to display, with the indexes of their directories.
+ */
+void FileExplorer::exploreFiles(ThreadPool& pool, const std::vector<std::pair<std::string, std::size_t>>& files) {
+    std::size_t index = 0;
+    display(pool, [&files, &index](std::string& filePath, std::size_t& root) {
+        if (index == files.size()) {
+            return false;
+        }
+        filePath = files[index].first;
+        root = files[index].second;
+        ++index;
+        return true;
+    });
+}
+
+/**
+ * @brief Builds the filter of the walk of a root.
+ *
+ * The roots nested in the root are walked on their own, so they are left out of its walk.
+ *
+ * @param root The root to walk.
+ * @return The filter of the configuration, skipping the nested roots.
+ */
+DirectoryWalker::Filter FileExplorer::walkFilter(const Root& root) const {
+    DirectoryWalker::Filter filter(!Configuration::showHiddenFiles, true);
+    filter.skippedDirectories = root.nestedDirectories;
+    return filter;
+}
+
+/**
+ * @brief Explores the directories, displaying the files with the same content once.
+ *
+ * A content may appear anywhere in the trees, so every tree is walked into a `FileTable` first,
+ * with the size of every file. Only the files whose size is shared by another file are hashed,
+ * on the pool; files with the same size and hash form a group. The files then go through the
+ * usual pipeline, except for the copies: the first file of a group in walk order is displayed
+ * with the paths of the others, and the others are neither read again nor formatted. Copies in
+ * the same tree are listed relative to it, the others with their whole path.
+ *
+ * Empty files are never grouped, since special files often report a size of zero, and neither
+ * are the files hidden by their binary extension, which are not read at all. With `--archives`,
+ * archives are not grouped either: their members are displayed instead.
+ *
+ * @param pool The pool running the walks, the hashing and the workers.
+ */
+void FileExplorer::exploreDeduplicated(ThreadPool& pool) {
+    // Walk all the trees at once; files are numbered across the tables, tree after tree
+    std::vector<FileTable> tables;
+    std::vector<std::size_t> offsets{0};
+    {
+        std::vector<std::unique_ptr<DirectoryWalker>> walkers;
+        for (const Root& root : roots) {
+            walkers.push_back(std::make_unique<DirectoryWalker>(pool, root.fileManager.dirPath, walkFilter(root), nullptr,
+                                                                std::string(), nullptr, true));
+        }
+        for (std::size_t root = 0; root < roots.size(); ++root) {
+            tables.emplace_back(roots[root].fileManager.dirPath);
+            while (walkers[root]->next(tables.back())) {
+            }
+            offsets.push_back(offsets.back() + tables.back().size());
+        }
+    }
+    auto tableOf = [&offsets](std::size_t file) {
+        return static_cast<std::size_t>(std::upper_bound(offsets.begin(), offsets.end(), file) - offsets.begin() - 1);
+    };
+    // The size of every file, or `unknownSize` for the files that are never grouped
+    std::vector<std::uint64_t> sizes(offsets.back());
+    for (std::size_t root = 0; root < tables.size(); ++root) {
+        for (std::size_t file = 0; file < tables[root].size(); ++file) {
+            std::string_view name = tables[root].name(file);
+            bool hidden = (!Configuration::showBinaryFiles && ExtensionTable::isBinary(name)
+                           && !(Configuration::decompress && Decompressor::hasCompressedExtension(name)))
+                          || (Configuration::exploreArchives && Archive::hasArchiveExtension(name));
+            sizes[offsets[root] + file] = hidden ? FileTable::unknownSize : tables[root].fileSize(file);
+        }
+    }
+
+    // Only the sizes shared by several files can hold copies
+    std::vector<std::uint32_t> bySize;
+    for (std::size_t file = 0; file < sizes.size(); ++file) {
+        if (sizes[file] != FileTable::unknownSize && sizes[file] > 0) {
+            bySize.push_back(static_cast<std::uint32_t>(file));
+        }
+    }
+    std::sort(bySize.begin(), bySize.end(), [&sizes](std::uint32_t left, std::uint32_t right) {
+        return sizes[left] != sizes[right] ? sizes[left] < sizes[right] : left < right;
+    });
+    std::vector<std::uint32_t> candidates;
+    for (std::size_t begin = 0, end = 0; begin < bySize.size(); begin = end) {
+        for (end = begin + 1; end < bySize.size() && sizes[bySize[end]] == sizes[bySize[begin]]; ++end) {
+        }
+        if (end - begin > 1) {
+            candidates.insert(candidates.end(), bySize.begin() + begin, bySize.begin() + end);
+        }
+    }
+
+    // Hash the candidates, a batch of files per task
+    std::vector<std::uint64_t> hashes(candidates.size());
+    std::vector<char> hashed(candidates.size(), 0);
+    for (std::size_t begin = 0; begin < candidates.size(); begin += hashBatchSize) {
+        pool.submit([&tables, &offsets, &tableOf, &sizes, &candidates, &hashes, &hashed, begin] {
+            std::string path;
+            std::size_t end = std::min(candidates.size(), begin + hashBatchSize);
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t table = tableOf(candidates[i]);
+                tables[table].path(candidates[i] - offsets[table], path);
+                hashed[i] = hashFile(path, sizes[candidates[i]], hashes[i]);
+            }
+        });
+    }
+    pool.wait();
+
+    // Group the files by size and hash, keeping the first one of each group in walk order
+    std::vector<std::size_t> byHash;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (hashed[i]) {
+            byHash.push_back(i);
+        }
+    }
+    std::sort(byHash.begin(), byHash.end(), [&sizes, &candidates, &hashes](std::size_t left, std::size_t right) {
+        std::uint64_t leftSize = sizes[candidates[left]];
+        std::uint64_t rightSize = sizes[candidates[right]];
+        if (leftSize != rightSize) {
+            return leftSize < rightSize;
+        }
+        return hashes[left] != hashes[right] ? hashes[left] < hashes[right] : candidates[left] < candidates[right];
+    });
+    std::vector<char> isCopy(sizes.size(), 0);
+    std::string path;
+    for (std::size_t begin = 0, end = 0; begin < byHash.size(); begin = end) {
+        std::size_t first = byHash[begin];
+        for (end = begin + 1; end < byHash.size() && hashes[byHash[end]] == hashes[first]
+                              && sizes[candidates[byHash[end]]] == sizes[candidates[first]]; ++end) {
+        }
+        if (end - begin > 1) {
+            std::size_t firstTable = tableOf(candidates[first]);
+            tables[firstTable].path(candidates[first] - offsets[firstTable], path);
+            std::vector<std::string>& copies = duplicates[path];
+            for (std::size_t i = begin + 1; i < end; ++i) {
+                std::size_t copy = candidates[byHash[i]];
+                std::size_t table = tableOf(copy);
+                isCopy[copy] = 1;
+                copies.emplace_back();
+                if (table == firstTable) {
+                    tables[table].relativePath(copy - offsets[table], copies.back());
+                } else {
+                    tables[table].path(copy - offsets[table], copies.back());
+                }
+            }
+        }
+    }
+
+    // Display the files, skipping the copies
+    std::size_t next = 0;
+    display(pool, [&tables, &offsets, &tableOf, &isCopy, &next](std::string& filePath, std::size_t& root) {
+        for (; next < isCopy.size() && isCopy[next]; ++next) {
+            Profiler::count(Profiler::Counter::FilesVisited);
+        }
+        if (next == isCopy.size()) {
+            return false;
+        }
+        root = tableOf(next);
+        tables[root].path(next++ - offsets[root], filePath);
+        return true;
+    });
+    duplicates.clear();
+}
+
+/**
+ * @brief Runs the pipeline over the files produced by a source.
+ *
+ * A feeding thread takes the files from the source and queues them in display order; each queued
+ * file is processed on a worker thread of the pool; the calling thread writes the results in
+ * queue order.
+ *
+ * @param pool The pool running the workers.
+ * @param nextFile The source of the files and of their roots, called on the feeding thread until it
+ *                 returns `false`.
+ * @throw std::exception If the source or the writer fails. The feeding thread is stopped first,
+ *                       and the files queued before a failure of the source are displayed.
+ */
+void FileExplorer::display(ThreadPool& pool, const FileSource& nextFile) {
+    std::size_t queueDepth = std::max<std::size_t>(minQueueDepth, 4 * pool.size());
+    BoundedQueue<std::shared_ptr<FileJob>> queue(queueDepth);
+    std::exception_ptr traversalError;
+
+    // Traversal stage: hand the files to the workers in display order
+    std::thread traversal([this, &pool, &queue, &nextFile, &traversalError, queueDepth] {
+        std::unique_ptr<UringReader> uring;
+        if (Configuration::ioBackend == IoBackend::Uring && !(matcher == nullptr && FileReader::isPreviewing())) {
+            try {
+                uring = std::make_unique<UringReader>(queueDepth);
+            } catch (const std::system_error&) {
+                // io_uring is not available: the workers read the files themselves
+            }
+        }
+
+        // With io_uring, files are read in batches before being handed to the workers. A batch is
+        // read once `batchSize` files were queued since its first one, whether they joined it or
+        // not, so the writer, which may be waiting for that file, never finds the queue full.
+        std::vector<std::shared_ptr<FileJob>> batch;
+        std::vector<UringReader::Request> requests;
+        std::size_t batchSize = std::min(queueDepth, UringReader::maxBatchSize);
+        std::size_t queuedSinceBatch = 0;
+        auto submitBatch = [this, &pool, &uring, &batch, &requests, &queuedSinceBatch] {
+            if (uring != nullptr && !batch.empty()) {
+                try {
+                    // Classification does not depend on the root, so any file manager does
+                    readBatch(*uring, roots.front().fileManager, batch, requests);
+                } catch (const std::system_error&) {
+                    uring.reset();
+                }
+            }
+            for (const auto& job : batch) {
+                pool.submit([this, job] { processFile(roots[job->root].fileManager, matcher, *job); });
+            }
+            batch.clear();
+            queuedSinceBatch = 0;
+        };
+
+        auto queueJob = [this, &pool, &queue, &uring, &batch, &queuedSinceBatch, batchSize, &submitBatch](
+                            const std::shared_ptr<FileJob>& job) {
+            if (!queue.push(job)) {
+                return false;
+            }
+            bool hidden = !Configuration::showBinaryFiles && roots[job->root].fileManager.hasBinaryExtension(job->path);
+            if (!job->error.empty()) {
+                // The job reports an archive that cannot be listed
+            } else if (uring != nullptr && !hidden && job->member == nullptr) {
+                batch.push_back(job);
             } else {
-                // Display the text content as is
-                Outputs::displayFileContent(fileManager.dirPath, file, content);
+                pool.submit([this, job] { processFile(roots[job->root].fileManager, matcher, *job); });
+            }
+            if (!batch.empty() && ++queuedSinceBatch == batchSize) {
+                submitBatch();
+            }
+            return true;
+        };
+
+        // With `--archives`, archives are explored like directories, filtered by the same globs
+        std::unique_ptr<DirectoryWalker::Filter> memberFilter;
+        if (Configuration::exploreArchives) {
+            memberFilter = std::make_unique<DirectoryWalker::Filter>(!Configuration::showHiddenFiles, true);
+        }
+        std::string filePath;
+        std::string relativeStorage;
+        std::size_t root = 0;
+        bool open = true;
+        try {
+            while (open && nextFile(filePath, root)) {
+                Profiler::count(Profiler::Counter::FilesVisited);
+                std::size_t slash = filePath.find_last_of('/');
+                if (memberFilter != nullptr && Archive::hasArchiveExtension(std::string_view(filePath).substr(slash + 1))) {
+                    open = queueMembers(filePath, root, roots[root].fileManager, *memberFilter, relativeStorage, queueJob);
+                    continue;
+                }
+                auto job = std::make_shared<FileJob>(filePath);
+                job->root = root;
+                open = queueJob(job);
             }
-        } catch (const std::exception& e) {
-            // Handle any errors that occur during file processing
-            std::cerr << SOFTWARE_NAME << ": error: " << e.what() << " while processing file `" << file << "`" << std::endl;
+        } catch (...) {
+            // The files already queued are still displayed; the writer throws the error afterwards
+            traversalError = std::current_exception();
         }
+        submitBatch();
+        queue.close();
+    });
+
+    // Writer stage: display the files in the order they were found
+    bool structured = Configuration::outputFormat != OutputFormat::Text;
+    RecordEncoder encoder(OutputWriter::standardOutput());
+    std::string relativeStorage;
+    const std::vector<std::string> noCopies;
+    std::vector<std::shared_ptr<HexSegment>> spareSegments;
+    std::shared_ptr<FileJob> job;
+    try {
+        while (queue.pop(job)) {
+            job->done.wait();
+            std::string_view relativePath = roots[job->root].fileManager.relativePath(job->path, relativeStorage);
+            auto found = duplicates.empty() ? duplicates.end() : duplicates.find(job->path);
+            const std::vector<std::string>& copies = found == duplicates.end() ? noCopies : found->second;
+            std::uint64_t truncated = FileReader::truncatedReads();
+            std::uint64_t faults = OutputWriter::standardOutput().faults();
+            if (job->error.empty() && job->streamed) {
+                try {
+                    if (structured) {
+                        streamRecord(encoder, relativePath, *job, copies);
+                    } else if (job->isBinary && pool.size() > 1 && job->remainder == nullptr) {
+                        // Convert large binary files on all the workers
+                        streamSegments(pool, segmentsInFlight * pool.size(), spareSegments, relativePath, *job, copies);
+                    } else {
+                        streamFile(relativePath, *job, copies);
+                    }
+                } catch (const std::exception& e) {
+                    job->error = e.what();
+                }
+            }
+
+            if (!job->error.empty()) {
+                // Handle any errors that occur during file processing
+                reportError(job->error, job->path);
+            } else if (!job->skipped) {
+                if (structured) {
+                    // Streamed files were written while being read
+                    if (!job->streamed) {
+                        writeRecord(encoder, relativePath, *job, matcher != nullptr, copies);
+                    }
+                } else if (matcher != nullptr) {
+                    Outputs::displayFileContent(relativePath, job->matchOutput, copies);
+                } else if (!job->streamed) {
+                    std::string_view content = job->isBinary ? std::string_view(job->hexContent) : job->content;
+                    if (job->skippedBefore > 0 || job->skippedAfter > 0) {
+                        Outputs::displayFilePreview(relativePath, content, job->skippedBefore, job->skippedAfter, copies);
+                    } else {
+                        Outputs::displayFileContent(relativePath, content, copies);
+                    }
+                }
+                Profiler::count(Profiler::Counter::FilesDisplayed);
+            }
+            if (FileReader::truncatedReads() != truncated || OutputWriter::standardOutput().faults() != faults) {
+                // The file was truncated while its mapped content was written
+                reportError("File changed while being read", job->path);
+            }
+        }
+    } catch (...) {
+        // Stop the traversal before leaving: a joinable thread would terminate the program
+        queue.close();
+        traversal.join();
+        throw;
+    }
+
+    traversal.join();
+    if (traversalError) {
+        std::rethrow_exception(traversalError);
     }
 }
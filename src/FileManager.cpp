@@ -1,136 +1,136 @@
-#include <cstring>
 #include <filesystem>
 #include <iostream>
-#include <magic.h>
-#include <set>
+#include <string>
+#include <string_view>
 #include <vector>
 #include "globals.h"
+#include "ClassificationCache.h"
+#include "Classifier.h"
+#include "Decompressor.h"
+#include "DirectoryWalker.h"
+#include "ExtensionTable.h"
 #include "FileManager.h"
+#include "FileReader.h"
+#include "FileTable.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
 
 /**
  * @brief Retrieves all regular files in the specified directory, recursively.
  *
- * This function iterates over the directory and all of its subdirectories to collect all regular
- * files. It filters files based on the configuration settings (whether hidden or binary files
- * should be shown).
+ * This function walks the directory and all of its subdirectories concurrently with a
+ * `DirectoryWalker`, using `Configuration::threadCount` threads. Hidden entries are skipped
+ * during the walk itself, so hidden directories are never read. The remaining files are then
+ * filtered based on the configuration settings (whether binary files should be shown).
  *
- * @return A vector of paths representing the files found in the directory.
+ * The files are stored in a `FileTable` with the size and type reported by the walk, and their
+ * paths are only built, in a single reused buffer, to classify them.
  *
- * @note If the directory cannot be accessed, an error message is printed, and an empty vector is returned.
+ * @param onDirectory Called for every directory read, with the ignore rules in force in it, or
+ *                    `nullptr`. It is called on the worker threads, possibly concurrently.
+ * @param skippedDirectories The relative paths of the directories not descended into.
+ * @return The table of the files found in the directory, in sorted depth-first order.
+ *
+ * @note If a directory cannot be accessed, an error message is printed and the walk continues
+ *       with the other directories.
  */
-std::vector<std::filesystem::path> FileManager::getAllFiles() {
-    std::vector<std::filesystem::path> files;
-    try {
-        // Iterate through the directory and its subdirectories
-        for (auto it = std::filesystem::recursive_directory_iterator(dirPath); it != std::filesystem::recursive_directory_iterator(); ++it) {
-            const auto& entry = *it;
-            // Check if the entry is a regular file
-            if (std::filesystem::is_regular_file(entry)) {
-                // Skip hidden files if configured to do so
-                if ((!Configuration::showHiddenFiles && isHiddenFile(entry.path())) ||
-                    (!Configuration::showBinaryFiles && (hasBinaryExtension(entry.path()) || !isTextMimeType(entry.path())))) {
-                    continue; // Skip this file
-                }
-                files.push_back(entry.path()); // Add the file path to the vector
-            } else if (std::filesystem::is_directory(entry)) {
-                // Skip hidden directories if configured to do so
-                if (!Configuration::showHiddenFiles && isHiddenFile(entry.path())) {
-                    // Skip the contents of this directory
-                    it.disable_recursion_pending();
-                }
-            }
+FileTable FileManager::getAllFiles(DirectoryWalker::DirectoryCallback onDirectory,
+                                   const std::vector<std::string>& skippedDirectories) {
+    FileTable files(dirPath);
+    ThreadPool pool(Configuration::threadCount);
+    DirectoryWalker::Filter filter(!Configuration::showHiddenFiles, true);
+    filter.skippedDirectories = skippedDirectories;
+    DirectoryWalker walker(pool, dirPath, filter, std::move(onDirectory), std::string(), nullptr, true);
+
+    std::string filePath;
+    while (walker.next(files)) {
+        Profiler::count(Profiler::Counter::FilesVisited);
+        if (Configuration::showBinaryFiles) {
+            continue;
+        }
+        // Skip binary files: the extension is checked on the name, the path is only built to classify the content
+        std::size_t last = files.size() - 1;
+        if (ExtensionTable::isBinary(files.name(last))) {
+            files.removeLastFile();
+            continue;
+        }
+        files.path(last, filePath);
+        if (!isTextMimeType(filePath)) {
+            files.removeLastFile();
         }
-    } catch (const std::filesystem::filesystem_error& e) {
-        // Handle filesystem errors (e.g., directory not found, access issues)
-        std::cerr << SOFTWARE_NAME << ": error: " << e.what() << " while accessing directory `" << dirPath << "`" << std::endl;
     }
     return files;
 }
 
 /**
- * @brief Checks if a file has a binary extension.
+ * @brief Returns the path of a file relative to the explored directory.
  *
- * This function checks the file extension against a predefined set of binary file extensions.
- * Common binary file extensions like images, videos, and audio files are included in this set.
+ * The walker joins `dirPath` and the entry names with a slash, so a path found by the walk is
+ * `dirPath`, an optional slash, and the relative path. That prefix is stripped in place;
+ * `std::filesystem::relative`, which resolves both paths through the filesystem, is only used
+ * for the paths that do not start with `dirPath`.
  *
- * @param filePath The path of the file to check.
- * @return True if the file has a binary extension, otherwise false.
+ * @param filePath The path of the file.
+ * @param storage Holds the relative path when it cannot be cut from `filePath`.
+ * @return The relative path, a view into `filePath` or `storage`.
  */
-bool FileManager::hasBinaryExtension(const std::filesystem::path& filePath) const {
-    // Set of known binary file extensions
-    const std::set<std::string> binaryExtensions = {
-        ".png", ".jpg", ".jpeg", ".gif", ".bmp", ".webp", ".ico", ".tiff", ".raw", ".svg", ".eps",
-        ".ai", ".psd", ".flac", ".aac", ".ogg", ".mp3", ".wav", ".mkv", ".mp4", ".avi", ".mov",
-        ".wmv", ".flv", ".webm", ".mpg", ".mpeg", ".3gp", ".dmg", ".iso", ".bin", ".deb", ".tar",
-        ".gz", ".zip", ".rar", ".7z", ".tar.gz", ".tar.bz2", ".tar.xz", ".apk", ".mobi", ".epub",
-        ".chm", ".odt", ".ods", ".odp", ".pdf", ".csv", ".yml", ".xml", ".json", ".sqlite", ".db",
-        ".mdb", ".accdb", ".bak", ".vhd", ".vmdk", ".vdi", ".xpi", ".crx", ".jar", ".war", ".ear",
-        ".rpm", ".arj", ".lha", ".cab", ".xz", ".bz2", ".lz", ".lzma", ".z", ".cue", ".vob", ".ifo",
-        ".bup", ".sub", ".idx", ".dat", ".m3u", ".nrg", ".srt", ".ass", ".vtt", ".wmf", ".emf",
-        ".pcx", ".exr", ".hdr", ".raw", ".dng", ".jxr", ".heif", ".heic", ".3ds", ".obj", ".fbx",
-        ".stl", ".ply", ".dae", ".gltf", ".glb", ".x3d", ".xap", ".mdf", ".img", ".bin", ".cue",
-        ".iso", ".dmg", ".flac", ".ape", ".wv", ".m4a", ".aac", ".dts", ".mpc", ".spx", ".wma",
-        ".aiff", ".au", ".voc", ".tak", ".it", ".mod", ".xm", ".s3m", ".mtm", ".ahx", ".nsf",
-        ".kdm", ".m3u8", ".pls", ".cue", ".msi", ".cab", ".torrent", ".nzb", ".dat", ".vhdx",
-        ".vdi", ".vbox", ".vdmk", ".vmdk", ".fpk", ".sfs", ".wsf", ".odm", ".ods", ".odp", ".odg"
-    };
-
-    // Get the file's extension
-    std::string extension = filePath.extension().string();
-
-    // Check if the file extension is in the binaryExtensions set
-    return binaryExtensions.find(extension) != binaryExtensions.end();
+std::string_view FileManager::relativePath(std::string_view filePath, std::string& storage) const {
+    if (filePath.size() > dirPath.size() && filePath.compare(0, dirPath.size(), dirPath) == 0
+        && (filePath[dirPath.size()] == '/' || (!dirPath.empty() && dirPath.back() == '/'))) {
+        std::string_view relative = filePath.substr(dirPath.size());
+        if (relative.front() == '/') {
+            relative.remove_prefix(1);
+        }
+        return relative;
+    }
+    storage = std::filesystem::relative(std::filesystem::path(filePath), dirPath).string();
+    return storage;
 }
 
 /**
- * @brief Checks if a file is a hidden file.
+ * @brief Checks if a file has a binary extension.
  *
- * A file is considered hidden if its name starts with a dot (.) in Unix-like systems.
- * This function checks the file name to determine if it is hidden.
+ * This function looks the file name up in the `ExtensionTable`, which holds common binary file
+ * extensions like images, videos, audio files and archives, plus the user-defined ones. The
+ * lookup is case-insensitive and also matches multi-part extensions such as `.tar.gz`. With
+ * `-z`, the extensions of the compressed formats do not count, since such files are decompressed.
  *
  * @param filePath The path of the file to check.
- * @return True if the file is hidden, otherwise false.
+ * @return True if the file has a binary extension, otherwise false.
  */
-bool FileManager::isHiddenFile(const std::filesystem::path& filePath) const {
-    // A file is hidden if its filename starts with a dot (.)
-    return filePath.filename().string().front() == '.';
+bool FileManager::hasBinaryExtension(const std::filesystem::path& filePath) const {
+    const std::string& path = filePath.native();
+    std::size_t slash = path.find_last_of('/');
+    std::string_view name = std::string_view(path).substr(slash == std::string::npos ? 0 : slash + 1);
+    return ExtensionTable::isBinary(name) && !(Configuration::decompress && Decompressor::hasCompressedExtension(name));
 }
 
 /**
  * @brief Checks if a file has a text MIME type.
  *
- * This function uses libmagic to determine the MIME type of the file by reading its content.
+ * This function first looks the file up in the classification cache. Otherwise it classifies the
+ * file through the `Classifier` and records the result: in `magic` mode libmagic reads the file
+ * itself, in the other modes the beginning of the file is mapped and sniffed in-process first.
  *
  * @param filePath The path of the file to check.
  * @return True if the file has a text MIME type, otherwise false.
  */
 bool FileManager::isTextMimeType(const std::filesystem::path& filePath) const {
-    // Initialize the magic database
-    magic_t magicCookie = magic_open(MAGIC_MIME_TYPE);
-    if (magicCookie == nullptr) {
-        std::cerr << "Unable to initialize magic library\n";
-        return false;
+    ClassificationCache::Key key;
+    bool cacheable = ClassificationCache::keyOf(filePath.native(), key);
+    bool isText = false;
+    if (cacheable && ClassificationCache::lookup(key, isText)) {
+        return isText;
     }
 
-    if (magic_load(magicCookie, nullptr) != 0) {
-        std::cerr << "Unable to load magic database\n";
-        magic_close(magicCookie);
-        return false;
+    if (Configuration::classifierMode == ClassifierMode::Magic) {
+        isText = Classifier::isText(filePath);
+    } else {
+        FileBuffer buffer = FileReader::mapFile(filePath.string(), Classifier::sniffLength);
+        isText = Classifier::isTextContent(buffer.view());
     }
-
-    // Get the MIME type of the file
-    const char* mimeType = magic_file(magicCookie, filePath.c_str());
-    if (mimeType == nullptr) {
-        std::cerr << "Unable to determine MIME type of file\n";
-        magic_close(magicCookie);
-        return false;
+    if (cacheable) {
+        ClassificationCache::store(key, isText);
     }
-
-    // Check if the MIME type starts with "text/"
-    bool isText = (strncmp(mimeType, "text/", 5) == 0);
-
-    // Clean up
-    magic_close(magicCookie);
-
     return isText;
 }
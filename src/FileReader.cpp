@@ -7,52 +7,493 @@
  * related to file opening and reading, such as missing files, permissions errors, and other 
  * system-related issues.
  * 
- * Functions in this file make use of C++ Standard Library features such as ifstream, filesystem,
- * and exception handling.
+ * Regular files are memory-mapped and exposed as read-only views, so their content is never
+ * copied; other files (pipes, procfs entries, files that cannot be mapped) are read with
+ * buffered `read()` calls instead.
+ *
+ * Bounded previews (`--head`, `--tail`, `--max-bytes`) map the whole file too, but only touch
+ * the pages they display: the first lines are found by scanning forward, the last lines by
+ * scanning backwards from the end of the file.
+ *
+ * A file truncated while it is mapped raises `SIGBUS` when the pages past its new end are read.
+ * Every mapping is registered in a fixed table of guards; the `SIGBUS` handler maps a page of
+ * zeros over a faulting page of a registered mapping and counts the fault on the thread, so the
+ * file is reported as changed instead of killing the process. Faults elsewhere keep their
+ * default action.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
 #include "globals.h"
 #include "FileReader.h"
+#include "Profiler.h"
+
+namespace {
+
+/**
+ * @struct MappingGuard
+ * @brief A slot of the table of the mappings guarded against truncation.
+ *
+ * The fields are atomics so the `SIGBUS` handler can read them on any thread without a lock.
+ */
+struct MappingGuard {
+    std::atomic<bool> used{false};          ///< Whether the slot is taken.
+    std::atomic<std::uintptr_t> begin{0};   ///< The address of the mapping, or 0 while it is not mapped.
+    std::atomic<std::size_t> length{0};     ///< The length of the mapping in bytes.
+};
+
+/**
+ * @brief The number of mappings guarded at once. Mappings are held by the jobs of the pipeline,
+ *        whose number is bounded by the queue depth. A mapping beyond this is left unguarded, so
+ *        a truncation of its file still kills the process with `SIGBUS`.
+ */
+constexpr std::size_t maxGuardedMappings = 4096;
+
+MappingGuard mappingGuards[maxGuardedMappings]; ///< The guarded mappings.
+thread_local std::uint64_t truncatedReadCount = 0; ///< The faults repaired on the thread.
+std::uintptr_t pageSize = 0; ///< The page size, read before the handler is installed: `sysconf` is not async-signal-safe.
+
+/**
+ * @brief Repairs a read past the end of a truncated file, or lets any other fault kill the process.
+ *
+ * The faulting page is replaced by a page of zeros, and the faulting read is retried on return.
+ * Only async-signal-safe functions are called.
+ */
+void handleBusError(int signal, siginfo_t* info, void*) {
+    auto address = reinterpret_cast<std::uintptr_t>(info->si_addr);
+    for (const MappingGuard& guard : mappingGuards) {
+        std::uintptr_t begin = guard.begin.load(std::memory_order_acquire);
+        if (begin != 0 && address >= begin && address - begin < guard.length.load(std::memory_order_relaxed)) {
+            void* page = reinterpret_cast<void*>(address & ~(pageSize - 1));
+            if (mmap(page, pageSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED) {
+                ++truncatedReadCount;
+                return;
+            }
+            break;
+        }
+    }
+    // Not a mapped file: fault again with the default action
+    struct sigaction action = {};
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(signal, &action, nullptr);
+}
+
+/**
+ * @brief Registers a mapping in a free guard slot, installing the `SIGBUS` handler the first time.
+ *
+ * @return The slot, or -1 if all the slots are taken.
+ */
+int guardMapping(void* mapping, std::size_t length) {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+        struct sigaction action = {};
+        action.sa_sigaction = handleBusError;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGBUS, &action, nullptr);
+    });
+    for (std::size_t slot = 0; slot < maxGuardedMappings; ++slot) {
+        bool expected = false;
+        if (mappingGuards[slot].used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            mappingGuards[slot].length.store(length, std::memory_order_relaxed);
+            mappingGuards[slot].begin.store(reinterpret_cast<std::uintptr_t>(mapping), std::memory_order_release);
+            return static_cast<int>(slot);
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+/**
+ * @brief Creates a buffer over a read-only memory mapping, taking ownership of it and guarding it.
+ *
+ * @param mapping The address of the mapping.
+ * @param length The length of the mapping in bytes.
+ * @param fileSize The size of the whole file, larger than `length` if only a prefix is mapped.
+ */
+FileBuffer::FileBuffer(void* mapping, std::size_t length, std::uint64_t fileSize)
+    : mapping(mapping), length(length), guard(guardMapping(mapping, length)), fileSize(fileSize) {}
+
+/**
+ * @brief Releases the memory mapping, if any.
+ */
+FileBuffer::~FileBuffer() {
+    release();
+}
+
+/**
+ * @brief Moves a buffer, leaving the source empty.
+ */
+FileBuffer::FileBuffer(FileBuffer&& other) noexcept
+    : mapping(other.mapping), length(other.length), guard(other.guard), content(std::move(other.content)),
+      fileSize(other.fileSize) {
+    other.mapping = nullptr;
+    other.length = 0;
+    other.guard = -1;
+    other.fileSize = 0;
+}
+
+/**
+ * @brief Moves a buffer into this one, releasing the current content first.
+ */
+FileBuffer& FileBuffer::operator=(FileBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        mapping = other.mapping;
+        length = other.length;
+        guard = other.guard;
+        content = std::move(other.content);
+        fileSize = other.fileSize;
+        other.mapping = nullptr;
+        other.length = 0;
+        other.guard = -1;
+        other.fileSize = 0;
+    }
+    return *this;
+}
+
+/**
+ * @brief Stops guarding the mapping and releases it.
+ *
+ * The guard is cleared before the mapping is released, so that a later mapping at the same
+ * address is never taken for this one.
+ */
+void FileBuffer::release() {
+    if (guard >= 0) {
+        mappingGuards[guard].begin.store(0, std::memory_order_release);
+        mappingGuards[guard].used.store(false, std::memory_order_release);
+        guard = -1;
+    }
+    if (mapping != nullptr) {
+        munmap(mapping, length);
+        mapping = nullptr;
+    }
+}
+
+namespace {
+
+/**
+ * @brief Reads everything left in a file descriptor with buffered `read()` calls.
+ *
+ * @param fd The file descriptor to read from.
+ * @param sizeHint The expected size of the content, used to reserve memory up front.
+ * @return The content read.
+ * @throw std::system_error If a read fails.
+ */
+std::string readAll(int fd, std::size_t sizeHint) {
+    constexpr std::size_t chunkSize = 64 * 1024;
+    std::string content;
+    content.reserve(sizeHint);
+
+    std::size_t used = 0;
+    while (true) {
+        if (content.size() - used < chunkSize) {
+            content.resize(used + chunkSize);
+        }
+        ssize_t count = read(fd, &content[used], content.size() - used);
+        Profiler::count(Profiler::Counter::ReadCalls);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category(), "read failed");
+        }
+        if (count == 0) {
+            break;
+        }
+        used += static_cast<std::size_t>(count);
+    }
+    content.resize(used);
+    Profiler::count(Profiler::Counter::BytesRead, used);
+    return content;
+}
+
+} // namespace
 
 /**
  * @brief Reads the content of a file and returns it as a string.
  * 
- * This function opens the file specified by the given file path, reads its content, and returns
- * the content as a string. If the file cannot be opened, or if any error occurs during the reading
- * process, an error message is returned instead.
+ * This function reads the file through `mapFile` and copies its content into a string. If the
+ * file cannot be opened, or if any error occurs during the reading process, an error message is
+ * returned instead.
  * 
  * @param filePath The path to the file to be read.
  * @return A string containing the file content or an error message if the file cannot be read.
- * 
- * @throw std::filesystem::filesystem_error If the file cannot be opened due to system-related issues (e.g., missing file, permission denied).
- * @throw std::exception If any other error occurs during the reading process.
  */
 std::string FileReader::readFile(const std::string& filePath) {
+    return std::string(mapFile(filePath).view());
+}
+
+/**
+ * @brief Returns the number of reads of truncated mappings made by the calling thread.
+ */
+std::uint64_t FileReader::truncatedReads() {
+    return truncatedReadCount;
+}
+
+/**
+ * @brief Opens a file and returns its content without copying it.
+ *
+ * Regular files with a non-zero size are mapped read-only, up to `maxLength` bytes; every other
+ * file, or a file that cannot be mapped, is read with buffered `read()` calls.
+ *
+ * @param filePath The path to the file to be read.
+ * @param maxLength The maximum number of bytes of a regular file to map.
+ * @return A buffer holding the file content, or an error message if the file cannot be read.
+ *
+ * @note Errors are printed on the standard error stream; they do not throw.
+ */
+FileBuffer FileReader::mapFile(const std::string& filePath, std::size_t maxLength) {
+    return map(filePath, maxLength, false);
+}
+
+/**
+ * @brief Maps a whole file for a bounded preview, without reading it.
+ *
+ * @param filePath The path to the file to be read.
+ * @return A buffer holding the content of the file.
+ */
+FileBuffer FileReader::mapForPreview(const std::string& filePath) {
+    return map(filePath, std::numeric_limits<std::size_t>::max(), true);
+}
+
+/**
+ * @brief Checks whether `--head`, `--tail` or `--max-bytes` limit the displayed content.
+ */
+bool FileReader::isPreviewing() {
+    return Configuration::maxBytes > 0 || Configuration::headLines > 0 || Configuration::tailLines > 0;
+}
+
+/**
+ * @brief Selects the part of a file displayed by `--head`, `--tail` and `--max-bytes`.
+ *
+ * The backward scan reads the content in blocks aligned on `previewBlockSize`, asking the kernel
+ * to read each block ahead before searching it for newlines from its end.
+ *
+ * @param buffer The content of the file.
+ * @param isBinary Whether the file is binary.
+ * @return A view of the displayed part of the content, pointing into `buffer`.
+ */
+std::string_view FileReader::previewWindow(const FileBuffer& buffer, bool isBinary) {
+    std::string_view content = buffer.view();
+    const char* data = content.data();
+    std::size_t size = content.size();
+    std::size_t maxBytes = static_cast<std::size_t>(std::min<std::uint64_t>(Configuration::maxBytes, size));
+    if (Configuration::maxBytes == 0) {
+        maxBytes = size;
+    }
+
+    if (Configuration::tailLines > 0) {
+        std::size_t start = 0;
+        if (isBinary) {
+            std::uint64_t rows = Configuration::tailLines;
+            start = rows < size / binaryRowLength ? size - static_cast<std::size_t>(rows) * binaryRowLength : 0;
+        } else {
+            // The newline ending the last line does not start another one
+            std::size_t end = size > 0 && data[size - 1] == '\n' ? size - 1 : size;
+            std::uint64_t found = 0;
+            std::size_t limit = size - maxBytes;
+            while (end > limit && found < Configuration::tailLines) {
+                std::size_t blockStart = std::max((end - 1) / previewBlockSize * previewBlockSize, limit);
+                if (buffer.isMapped()) {
+                    std::size_t alignedStart = blockStart / previewBlockSize * previewBlockSize;
+                    madvise(const_cast<char*>(data) + alignedStart, end - alignedStart, MADV_WILLNEED);
+                }
+                const void* newline;
+                while (found < Configuration::tailLines
+                       && (newline = memrchr(data + blockStart, '\n', end - blockStart)) != nullptr) {
+                    end = static_cast<std::size_t>(static_cast<const char*>(newline) - data);
+                    ++found;
+                    start = end + 1;
+                }
+                if (found < Configuration::tailLines) {
+                    end = blockStart;
+                    start = blockStart;
+                }
+            }
+        }
+        start = std::max(start, size - maxBytes);
+        return content.substr(start);
+    }
+
+    std::size_t end = maxBytes;
+    if (Configuration::headLines > 0 && isBinary) {
+        std::uint64_t rows = Configuration::headLines;
+        end = rows < end / binaryRowLength ? static_cast<std::size_t>(rows) * binaryRowLength : end;
+    } else if (Configuration::headLines > 0) {
+        std::size_t position = 0;
+        for (std::uint64_t found = 0; found < Configuration::headLines && position < end; ++found) {
+            const void* newline = std::memchr(data + position, '\n', end - position);
+            if (newline == nullptr) {
+                position = end;
+                break;
+            }
+            position = static_cast<std::size_t>(static_cast<const char*>(newline) - data) + 1;
+        }
+        end = position;
+    }
+    return content.substr(0, end);
+}
+
+/**
+ * @brief Reads part of an open file at a given offset, retrying short reads.
+ *
+ * @param fd The open file.
+ * @param offset The offset of the first byte to read.
+ * @param buffer Receives the bytes.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read, less than `size` only at the end of the file.
+ * @throw std::system_error If reading fails.
+ */
+std::size_t FileReader::readAt(int fd, std::uint64_t offset, char* buffer, std::size_t size) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Read);
+    std::size_t used = 0;
+    while (used < size) {
+        ssize_t count = pread(fd, buffer + used, size - used, static_cast<off_t>(offset + used));
+        Profiler::count(Profiler::Counter::ReadCalls);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category(), "read failed");
+        }
+        if (count == 0) {
+            break;
+        }
+        used += static_cast<std::size_t>(count);
+    }
+    Profiler::count(Profiler::Counter::BytesRead, used);
+    return used;
+}
+
+/**
+ * @brief Opens a file and maps it, or reads it if it cannot be mapped.
+ *
+ * @param filePath The path to the file to be read.
+ * @param maxLength The maximum number of bytes of a regular file to map.
+ * @param preview Whether the mapping is read on demand by a preview rather than sequentially.
+ * @return A buffer holding the content of the file, or an error message.
+ */
+FileBuffer FileReader::map(const std::string& filePath, std::size_t maxLength, bool preview) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Read);
+    int fd = -1;
     try {
         // Attempt to open the file
-        std::ifstream file(filePath);
-
-        if (!file.is_open()) {
+        fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        Profiler::count(Profiler::Counter::ReadCalls);
+        if (fd < 0) {
             // If the file cannot be opened, throw a filesystem error
-            throw std::filesystem::filesystem_error("Cannot open file", std::filesystem::path(filePath), std::error_code());
+            throw std::filesystem::filesystem_error("Cannot open file", std::filesystem::path(filePath),
+                                                    std::error_code(errno, std::system_category()));
+        }
+
+        struct stat info;
+        std::uint64_t fileSize = (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+                                     ? static_cast<std::uint64_t>(info.st_size) : 0;
+        std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(fileSize, maxLength));
+        if (length > 0) {
+            // Map regular files; the mapping stays valid once the descriptor is closed
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            Profiler::count(Profiler::Counter::ReadCalls);
+            if (mapping != MAP_FAILED) {
+                if (!preview) {
+                    // Previews count the bytes they display instead
+                    Profiler::count(Profiler::Counter::BytesRead, length);
+                    madvise(mapping, length, MADV_SEQUENTIAL);
+                }
+                close(fd);
+                return FileBuffer(mapping, length, fileSize);
+            }
         }
 
-        // Read the entire file content into a string
-        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        return content;
+        // Fall back to buffered reads for pipes, procfs entries and unmappable files
+        FileBuffer buffer(readAll(fd, length));
+        close(fd);
+        return buffer;
 
     } catch (const std::filesystem::filesystem_error& e) {
         // Handle filesystem errors, e.g., file not found, permissions error
         std::cerr << SOFTWARE_NAME << ": error: " << e.what() << std::endl;
-        return std::string(SOFTWARE_NAME) + ": cannot open file `" + filePath + "`";
+        return FileBuffer(std::string(SOFTWARE_NAME) + ": cannot open file `" + filePath + "`");
 
     } catch (const std::exception& e) {
         // Handle other exceptions that may occur during file reading
+        if (fd >= 0) {
+            close(fd);
+        }
         std::cerr << SOFTWARE_NAME << ": error: " << e.what() << std::endl;
-        return std::string(SOFTWARE_NAME) + ": unknown error while reading file `" + filePath + "`";
+        return FileBuffer(std::string(SOFTWARE_NAME) + ": unknown error while reading file `" + filePath + "`");
+    }
+}
+
+/**
+ * @brief Opens a file for chunked reading.
+ *
+ * @param filePath The path to the file to be read.
+ * @param chunkSize The size of the chunks in bytes.
+ * @throw std::filesystem::filesystem_error If the file cannot be opened.
+ */
+FileChunkReader::FileChunkReader(const std::string& filePath, std::size_t chunkSize)
+    : fd(open(filePath.c_str(), O_RDONLY | O_CLOEXEC)), chunkSize(chunkSize == 0 ? 1 : chunkSize) {
+    Profiler::count(Profiler::Counter::ReadCalls);
+    if (fd < 0) {
+        throw std::filesystem::filesystem_error("Cannot open file", std::filesystem::path(filePath),
+                                                std::error_code(errno, std::system_category()));
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    buffer = std::make_unique<char[]>(this->chunkSize);
+}
+
+/**
+ * @brief Closes the file.
+ */
+FileChunkReader::~FileChunkReader() {
+    close(fd);
+}
+
+/**
+ * @brief Reads the next chunk of the file.
+ *
+ * Short reads are retried until the chunk is full or the end of the file is reached, so every
+ * chunk but the last one has exactly the chunk size.
+ *
+ * @param chunk Receives a view of the chunk, valid until the next call.
+ * @return `true` if a chunk was read, `false` at the end of the file.
+ * @throw std::system_error If reading fails.
+ */
+bool FileChunkReader::next(std::string_view& chunk) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Read);
+    std::size_t used = 0;
+    while (used < chunkSize) {
+        ssize_t count = read(fd, buffer.get() + used, chunkSize - used);
+        Profiler::count(Profiler::Counter::ReadCalls);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category(), "read failed");
+        }
+        if (count == 0) {
+            break;
+        }
+        used += static_cast<std::size_t>(count);
     }
+    chunk = std::string_view(buffer.get(), used);
+    Profiler::count(Profiler::Counter::BytesRead, used);
+    return used > 0;
 }
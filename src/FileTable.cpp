@@ -0,0 +1,110 @@
+/**
+ * @file FileTable.cpp
+ * @headerfile FileTable.h
+ * @brief This file contains the implementation of the FileTable class.
+ *
+ * A file costs a 32-byte record and its name in the arena, instead of a `std::filesystem::path`
+ * holding its whole path in a heap allocation of its own. Relative paths are rebuilt by walking
+ * up the parent indices and appending the names from the root down.
+ */
+
+#include "FileTable.h"
+
+/**
+ * @brief Creates an empty table for the tree at a given path.
+ *
+ * @param rootPath The path of the root directory, as given to the walk.
+ */
+FileTable::FileTable(std::string rootPath) : root(std::move(rootPath)) {
+    directories.push_back({0, 0, noDirectory});
+}
+
+/**
+ * @brief Adds a directory.
+ *
+ * @param parent The index of the parent directory.
+ * @param name The name of the directory.
+ * @return The index of the new directory.
+ */
+std::uint32_t FileTable::addDirectory(std::uint32_t parent, std::string_view name) {
+    directories.push_back({names.size(), static_cast<std::uint32_t>(name.size()), parent});
+    names.append(name);
+    return static_cast<std::uint32_t>(directories.size() - 1);
+}
+
+/**
+ * @brief Adds a file.
+ *
+ * @param directory The index of the directory holding the file.
+ * @param name The name of the file.
+ * @param type The type of the file.
+ * @param size The size of the file in bytes, or `unknownSize`.
+ */
+void FileTable::addFile(std::uint32_t directory, std::string_view name, Type type, std::uint64_t size) {
+    files.push_back({names.size(), size, static_cast<std::uint32_t>(name.size()), directory, type});
+    names.append(name);
+}
+
+/**
+ * @brief Removes the last file added, releasing its name from the arena.
+ *
+ * The name of a file is the last one in the arena as long as no directory was added after it.
+ */
+void FileTable::removeLastFile() {
+    const File& file = files.back();
+    if (file.nameOffset + file.nameLength == names.size()) {
+        names.resize(file.nameOffset);
+    }
+    files.pop_back();
+}
+
+/**
+ * @brief Writes the path of a file relative to the root.
+ *
+ * @param file The index of the file.
+ * @param output Receives the path, replacing its content. Its capacity is reused.
+ */
+void FileTable::relativePath(std::size_t file, std::string& output) const {
+    output.clear();
+    appendDirectory(files[file].directory, output);
+    output.append(name(file));
+}
+
+/**
+ * @brief Writes the path of a file, starting with the root path as the walk does.
+ *
+ * The root and the relative path are joined the way `std::filesystem::path::operator/` does, so
+ * the result is the path the walker hands out for the file.
+ *
+ * @param file The index of the file.
+ * @param output Receives the path, replacing its content. Its capacity is reused.
+ */
+void FileTable::path(std::size_t file, std::string& output) const {
+    output.assign(root);
+    if (!output.empty() && output.back() != '/') {
+        output += '/';
+    }
+    appendDirectory(files[file].directory, output);
+    output.append(name(file));
+}
+
+/**
+ * @brief Returns the number of bytes allocated by the table.
+ */
+std::size_t FileTable::memoryUsage() const {
+    return root.capacity() + names.capacity() + directories.capacity() * sizeof(Directory)
+           + files.capacity() * sizeof(File);
+}
+
+/**
+ * @brief Appends the path of a directory relative to the root, followed by a slash unless it is the root.
+ */
+void FileTable::appendDirectory(std::uint32_t directory, std::string& output) const {
+    if (directory == rootDirectory) {
+        return;
+    }
+    const Directory& entry = directories[directory];
+    appendDirectory(entry.parent, output);
+    output.append(names, entry.nameOffset, entry.nameLength);
+    output += '/';
+}
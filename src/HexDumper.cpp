@@ -0,0 +1,423 @@
+/**
+ * @file HexDumper.cpp
+ * @headerfile HexDumper.h
+ * @brief This file contains the implementation of the HexDumper class.
+ *
+ * A row is written as its offset followed by a body of fixed length: two spaces, the 16 bytes in
+ * hexadecimal with an extra space between the two groups of eight, the printable characters
+ * between bars and a newline. The scalar kernel copies a template of the body and fills in the
+ * digit pairs and the characters from lookup tables. The SSSE3 kernel computes the digits and
+ * the characters of a row in registers and spreads them over the body with `pshufb`, using masks
+ * computed at compile time, so a row costs a handful of shuffles and five stores.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include "HexDumper.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr std::size_t bodySize = 71;     ///< Length of a row after its offset.
+constexpr std::size_t hexStart = 2;      ///< Position of the first digit in the body.
+constexpr std::size_t asciiStart = 53;   ///< Position of the first character in the body.
+constexpr char digits[] = "0123456789abcdef";
+
+/**
+ * @brief Returns the position of the digits of a byte of the row in the hexadecimal area.
+ */
+constexpr std::size_t hexPosition(std::size_t byte) {
+    return 3 * byte + (byte >= 8 ? 1 : 0);
+}
+
+/**
+ * @brief Lookup table mapping each byte to its two hexadecimal digits.
+ */
+constexpr std::array<std::array<char, 2>, 256> makePairTable() {
+    std::array<std::array<char, 2>, 256> table{};
+    for (std::size_t byte = 0; byte < 256; ++byte) {
+        table[byte] = {digits[byte >> 4], digits[byte & 0x0f]};
+    }
+    return table;
+}
+
+constexpr auto pairTable = makePairTable();
+
+/**
+ * @brief Lookup table mapping each byte to the character displayed for it: itself if it is
+ *        printable ASCII, otherwise a dot.
+ */
+constexpr std::array<char, 256> makeAsciiTable() {
+    std::array<char, 256> table{};
+    for (std::size_t byte = 0; byte < 256; ++byte) {
+        table[byte] = (byte >= 0x20 && byte < 0x7f) ? static_cast<char>(byte) : '.';
+    }
+    return table;
+}
+
+constexpr auto asciiTable = makeAsciiTable();
+
+/**
+ * @brief The body of a row without its bytes: spaces, the two bars and the newline.
+ */
+constexpr std::array<char, bodySize> makeBodyTemplate() {
+    std::array<char, bodySize> body{};
+    for (char& c : body) {
+        c = ' ';
+    }
+    body[asciiStart - 1] = '|';
+    body[asciiStart + HexDumper::rowSize] = '|';
+    body[bodySize - 1] = '\n';
+    return body;
+}
+
+constexpr auto bodyTemplate = makeBodyTemplate();
+
+/**
+ * @brief Writes an offset in hexadecimal, on at least eight digits.
+ *
+ * @return The end of the offset.
+ */
+inline char* writeOffset(std::uint64_t offset, char* output) {
+    if ((offset >> 32) == 0) {
+        std::memcpy(output, pairTable[(offset >> 24) & 0xff].data(), 2);
+        std::memcpy(output + 2, pairTable[(offset >> 16) & 0xff].data(), 2);
+        std::memcpy(output + 4, pairTable[(offset >> 8) & 0xff].data(), 2);
+        std::memcpy(output + 6, pairTable[offset & 0xff].data(), 2);
+        return output + 8;
+    }
+    std::size_t count = 9;
+    while (count < 16 && (offset >> (4 * count)) != 0) {
+        ++count;
+    }
+    for (std::size_t i = count; i-- > 0;) {
+        *output++ = digits[(offset >> (4 * i)) & 0x0f];
+    }
+    return output;
+}
+
+/**
+ * @brief Writes a row of up to 16 bytes; the digits of the missing bytes are left blank.
+ *
+ * @return The end of the row.
+ */
+inline char* writeRow(std::uint64_t offset, const char* row, std::size_t size, char* output) {
+    output = writeOffset(offset, output);
+    std::memcpy(output, bodyTemplate.data(), bodySize);
+    for (std::size_t i = 0; i < size; ++i) {
+        unsigned char byte = static_cast<unsigned char>(row[i]);
+        std::memcpy(output + hexStart + hexPosition(i), pairTable[byte].data(), 2);
+        output[asciiStart + i] = asciiTable[byte];
+    }
+    if (size == HexDumper::rowSize) {
+        return output + bodySize;
+    }
+    // A shorter row ends after its characters
+    output[asciiStart + size] = '|';
+    output[asciiStart + size + 1] = '\n';
+    return output + asciiStart + size + 2;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+constexpr std::size_t registerCount = 5; ///< Number of 16-byte stores covering a body.
+
+/**
+ * @brief Positions of the stores of a body; the last one overlaps the previous one.
+ */
+constexpr std::size_t registerStart[registerCount] = {0, 16, 32, 48, bodySize - 16};
+
+/**
+ * @struct RowMasks
+ * @brief The `pshufb` masks spreading the digits and the characters of a row over its body.
+ *
+ * The digits of bytes 0-7 are held in one register (`low`) and those of bytes 8-15 in another
+ * (`high`), as pairs; the characters in a third one (`ascii`). Every store of the body ORs the
+ * shuffles of the registers it takes bytes from with the fixed bytes of the template; `0x80`
+ * entries produce zeros.
+ */
+struct RowMasks {
+    alignas(16) std::uint8_t low[registerCount][16];   ///< Bytes taken from the digits of bytes 0-7.
+    alignas(16) std::uint8_t high[registerCount][16];  ///< Bytes taken from the digits of bytes 8-15.
+    alignas(16) std::uint8_t ascii[registerCount][16]; ///< Bytes taken from the characters.
+    alignas(16) std::uint8_t fill[registerCount][16];  ///< Fixed bytes: spaces, bars and newline.
+};
+
+constexpr RowMasks makeRowMasks() {
+    RowMasks masks{};
+    for (std::size_t reg = 0; reg < registerCount; ++reg) {
+        for (std::size_t i = 0; i < 16; ++i) {
+            const std::size_t position = registerStart[reg] + i;
+            masks.low[reg][i] = 0x80;
+            masks.high[reg][i] = 0x80;
+            masks.ascii[reg][i] = 0x80;
+            masks.fill[reg][i] = 0;
+            bool filled = false;
+            for (std::size_t byte = 0; byte < HexDumper::rowSize; ++byte) {
+                const std::size_t digit = hexStart + hexPosition(byte);
+                if (position == digit || position == digit + 1) {
+                    const auto pair = static_cast<std::uint8_t>(2 * (byte % 8) + (position - digit));
+                    (byte < 8 ? masks.low : masks.high)[reg][i] = pair;
+                    filled = true;
+                }
+                if (position == asciiStart + byte) {
+                    masks.ascii[reg][i] = static_cast<std::uint8_t>(byte);
+                    filled = true;
+                }
+            }
+            if (!filled) {
+                masks.fill[reg][i] = static_cast<std::uint8_t>(bodyTemplate[position]);
+            }
+        }
+    }
+    return masks;
+}
+
+constexpr RowMasks rowMasks = makeRowMasks();
+
+alignas(16) constexpr char digitTable[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+};
+
+#endif
+
+} // namespace
+
+/**
+ * @brief Formats complete rows with the portable kernel.
+ *
+ * A row equal to the previous one is not written: the first of a run is replaced by a `*` line.
+ *
+ * @param dumper The dumper, whose offset and last row are updated.
+ * @param rows The bytes of the rows.
+ * @param rowCount The number of rows.
+ * @param output The destination, at least `rowCount * maxLineSize` bytes long.
+ * @return The end of the output.
+ */
+char* HexDumper::dumpScalar(HexDumper& dumper, const char* rows, std::size_t rowCount, char* output) {
+    for (std::size_t row = 0; row < rowCount; ++row, rows += rowSize) {
+        if (dumper.dumped && std::memcmp(rows, dumper.previous, rowSize) == 0) {
+            if (!dumper.squeezing) {
+                *output++ = '*';
+                *output++ = '\n';
+                dumper.squeezing = true;
+            }
+        } else {
+            output = writeRow(dumper.offset, rows, rowSize, output);
+            std::memcpy(dumper.previous, rows, rowSize);
+            dumper.squeezing = false;
+        }
+        dumper.dumped = true;
+        dumper.offset += rowSize;
+    }
+    return output;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * @brief Formats complete rows with the SSSE3 kernel.
+ *
+ * The last row is kept in a register, so detecting a repeated row costs one comparison.
+ *
+ * @param dumper The dumper, whose offset and last row are updated.
+ * @param rows The bytes of the rows.
+ * @param rowCount The number of rows.
+ * @param output The destination, at least `rowCount * maxLineSize` bytes long.
+ * @return The end of the output.
+ */
+__attribute__((target("ssse3")))
+char* HexDumper::dumpSsse3(HexDumper& dumper, const char* rows, std::size_t rowCount, char* output) {
+    const __m128i digitsRegister = _mm_load_si128(reinterpret_cast<const __m128i*>(digitTable));
+    const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+    const __m128i dots = _mm_set1_epi8('.');
+    const __m128i firstPrintable = _mm_set1_epi8(0x1f);
+    const __m128i lastPrintable = _mm_set1_epi8(0x7f);
+    auto mask = [](const std::uint8_t* bytes) { return _mm_load_si128(reinterpret_cast<const __m128i*>(bytes)); };
+
+    __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dumper.previous));
+    bool dumped = dumper.dumped;
+    bool squeezing = dumper.squeezing;
+    std::uint64_t offset = dumper.offset;
+    for (std::size_t row = 0; row < rowCount; ++row, rows += rowSize, offset += rowSize) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows));
+        if (dumped && _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, previous)) == 0xffff) {
+            if (!squeezing) {
+                *output++ = '*';
+                *output++ = '\n';
+                squeezing = true;
+            }
+            continue;
+        }
+        dumped = true;
+        squeezing = false;
+        previous = bytes;
+
+        const __m128i high = _mm_shuffle_epi8(digitsRegister, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbleMask));
+        const __m128i low = _mm_shuffle_epi8(digitsRegister, _mm_and_si128(bytes, nibbleMask));
+        const __m128i pairs0 = _mm_unpacklo_epi8(high, low);
+        const __m128i pairs1 = _mm_unpackhi_epi8(high, low);
+        // Signed comparisons: bytes from 0x80 up are negative, hence not printable either
+        const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, firstPrintable), _mm_cmplt_epi8(bytes, lastPrintable));
+        const __m128i ascii = _mm_or_si128(_mm_and_si128(printable, bytes), _mm_andnot_si128(printable, dots));
+
+        // Each store takes bytes from the registers that reach into it, as laid out by `makeRowMasks`
+        const __m128i out0 = _mm_or_si128(_mm_shuffle_epi8(pairs0, mask(rowMasks.low[0])), mask(rowMasks.fill[0]));
+        const __m128i out1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(pairs0, mask(rowMasks.low[1])),
+                                                       _mm_shuffle_epi8(pairs1, mask(rowMasks.high[1]))), mask(rowMasks.fill[1]));
+        const __m128i out2 = _mm_or_si128(_mm_shuffle_epi8(pairs1, mask(rowMasks.high[2])), mask(rowMasks.fill[2]));
+        const __m128i out3 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(pairs1, mask(rowMasks.high[3])),
+                                                       _mm_shuffle_epi8(ascii, mask(rowMasks.ascii[3]))), mask(rowMasks.fill[3]));
+        const __m128i out4 = _mm_or_si128(_mm_shuffle_epi8(ascii, mask(rowMasks.ascii[4])), mask(rowMasks.fill[4]));
+
+        if ((offset >> 32) == 0) {
+            // The eight digits of the offset, from its bytes in big-endian order
+            const __m128i value = _mm_cvtsi32_si128(static_cast<int>(__builtin_bswap32(static_cast<std::uint32_t>(offset))));
+            const __m128i offsetDigits = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(value, 4), nibbleMask),
+                                                           _mm_and_si128(value, nibbleMask));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_shuffle_epi8(digitsRegister, offsetDigits));
+            output += 8;
+        } else {
+            output = writeOffset(offset, output);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + registerStart[0]), out0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + registerStart[1]), out1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + registerStart[2]), out2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + registerStart[3]), out3);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + registerStart[4]), out4);
+        output += bodySize;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dumper.previous), previous);
+    dumper.dumped = dumped;
+    dumper.squeezing = squeezing;
+    dumper.offset = offset;
+    return output;
+}
+
+#endif
+
+namespace {
+
+/**
+ * @brief Picks the fastest kernel supported by the CPU.
+ */
+HexDumper::Kernel selectKernel(const char** name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        *name = "ssse3";
+        return &HexDumper::dumpSsse3;
+    }
+#endif
+    *name = "scalar";
+    return &HexDumper::dumpScalar;
+}
+
+/**
+ * @struct Dispatch
+ * @brief The kernel selected for this CPU, resolved once on first use.
+ */
+struct Dispatch {
+    const char* name = nullptr;
+    HexDumper::Kernel kernel = selectKernel(&name);
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch selected;
+    return selected;
+}
+
+} // namespace
+
+/**
+ * @brief Creates a dumper resuming a dump at a row boundary, from the rows that precede it.
+ *
+ * The last row before `offset` is the one the next row is compared with, and the previous
+ * rows were being squeezed if it is equal to the row before it.
+ *
+ * @param offset The offset of the first byte to dump.
+ * @param before The up to two complete rows just before `offset`.
+ */
+HexDumper::HexDumper(std::uint64_t offset, std::string_view before) : offset(offset) {
+    if (before.size() >= rowSize) {
+        const char* last = before.data() + before.size() - rowSize;
+        std::memcpy(previous, last, rowSize);
+        dumped = true;
+        squeezing = before.size() >= 2 * rowSize && std::memcmp(last - rowSize, last, rowSize) == 0;
+    }
+}
+
+/**
+ * @brief Appends the rows completed by a piece of content.
+ *
+ * The bytes of an incomplete row are kept until the next piece completes it, so the rows do not
+ * depend on how the content is split.
+ *
+ * @param input The next bytes of the content.
+ * @param output The buffer receiving the rows.
+ */
+void HexDumper::dump(std::string_view input, std::string& output) {
+    if (!pending.empty()) {
+        std::size_t taken = std::min(rowSize - pending.size(), input.size());
+        pending.append(input.substr(0, taken));
+        input.remove_prefix(taken);
+        if (pending.size() < rowSize) {
+            return;
+        }
+        dumpRows(pending.data(), 1, output);
+        pending.clear();
+    }
+    std::size_t rowCount = input.size() / rowSize;
+    dumpRows(input.data(), rowCount, output);
+    pending.assign(input.substr(rowCount * rowSize));
+}
+
+/**
+ * @brief Appends the incomplete last row, if any, and the line holding the final offset.
+ *
+ * As with `hexdump -C`, the last line holds the offset just past the content.
+ *
+ * @param output The buffer receiving the rows.
+ */
+void HexDumper::finish(std::string& output) {
+    char lines[2 * maxLineSize];
+    char* end = lines;
+    if (!pending.empty()) {
+        end = writeRow(offset, pending.data(), pending.size(), end);
+        offset += pending.size();
+        dumped = true;
+        pending.clear();
+    }
+    if (dumped) {
+        end = writeOffset(offset, end);
+        *end++ = '\n';
+    }
+    output.append(lines, static_cast<std::size_t>(end - lines));
+}
+
+/**
+ * @brief Returns the name of the kernel used by `dump`.
+ */
+const char* HexDumper::kernelName() {
+    return dispatch().name;
+}
+
+/**
+ * @brief Appends complete rows with the fastest kernel supported by the CPU.
+ *
+ * The output is grown to hold the longest possible rows, then cut to what the kernel wrote.
+ */
+void HexDumper::dumpRows(const char* rows, std::size_t rowCount, std::string& output) {
+    if (rowCount == 0) {
+        return;
+    }
+    std::size_t used = output.size();
+    output.resize(used + rowCount * maxLineSize);
+    char* end = dispatch().kernel(*this, rows, rowCount, output.data() + used);
+    output.resize(static_cast<std::size_t>(end - output.data()));
+}
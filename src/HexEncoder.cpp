@@ -0,0 +1,261 @@
+/**
+ * @file HexEncoder.cpp
+ * @headerfile HexEncoder.h
+ * @brief This file contains the implementation of the HexEncoder class.
+ *
+ * The HexEncoder class converts bytes to the hexadecimal format used to display binary files:
+ * two lowercase digits followed by a space for every byte. It provides a scalar lookup-table
+ * kernel and, on x86, SSSE3 and AVX2 kernels selected at runtime according to the CPU.
+ *
+ * The vector kernels split each byte into its two nibbles, turn the nibbles into digits with a
+ * 16-entry table lookup (`pshufb`), and then spread the digit pairs over three output registers,
+ * leaving a gap after every pair that is filled with a space.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include "HexEncoder.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Lookup table mapping each byte to its `"xx "` token (the fourth byte is padding).
+ */
+constexpr std::array<std::array<char, 4>, 256> makeTokenTable() {
+    constexpr char digits[] = "0123456789abcdef";
+    std::array<std::array<char, 4>, 256> table{};
+    for (std::size_t byte = 0; byte < 256; ++byte) {
+        table[byte] = {digits[byte >> 4], digits[byte & 0x0f], ' ', '\0'};
+    }
+    return table;
+}
+
+constexpr auto tokenTable = makeTokenTable();
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * @struct ShuffleMasks
+ * @brief The `pshufb` masks spreading 16 digit pairs over 48 output bytes.
+ *
+ * The digits of bytes 0-7 of a 16-byte block are held in one register (`pairs0`) and those of
+ * bytes 8-15 in another (`pairs1`). Output bytes 0-15 come from `pairs0`, bytes 16-31 from both,
+ * bytes 32-47 from `pairs1`; `0x80` entries produce zeros, later replaced by spaces. Every mask is
+ * repeated in both 128-bit lanes so the AVX2 kernel can use it as is.
+ */
+struct ShuffleMasks {
+    alignas(32) std::uint8_t first[32];        ///< Output bytes 0-15, from `pairs0`.
+    alignas(32) std::uint8_t middleLow[32];    ///< Output bytes 16-31, the part from `pairs0`.
+    alignas(32) std::uint8_t middleHigh[32];   ///< Output bytes 16-31, the part from `pairs1`.
+    alignas(32) std::uint8_t last[32];         ///< Output bytes 32-47, from `pairs1`.
+    alignas(32) std::uint8_t spacesFirst[32];  ///< Spaces of output bytes 0-15.
+    alignas(32) std::uint8_t spacesMiddle[32]; ///< Spaces of output bytes 16-31.
+    alignas(32) std::uint8_t spacesLast[32];   ///< Spaces of output bytes 32-47.
+};
+
+constexpr ShuffleMasks makeShuffleMasks() {
+    ShuffleMasks masks{};
+    for (int lane = 0; lane < 2; ++lane) {
+        for (int i = 0; i < 16; ++i) {
+            const int slot = lane * 16 + i;
+            for (int part = 0; part < 3; ++part) {
+                const int position = part * 16 + i;  // Position in the 48 output bytes
+                const int byte = position / 3;        // Input byte written at that position
+                const int digit = position % 3;       // 0 and 1: digits, 2: space
+                const bool space = digit == 2;
+                const std::uint8_t low = (!space && byte < 8) ? static_cast<std::uint8_t>(2 * byte + digit) : 0x80;
+                const std::uint8_t high = (!space && byte >= 8) ? static_cast<std::uint8_t>(2 * (byte - 8) + digit) : 0x80;
+                const std::uint8_t fill = space ? ' ' : 0;
+                if (part == 0) {
+                    masks.first[slot] = low;
+                    masks.spacesFirst[slot] = fill;
+                } else if (part == 1) {
+                    masks.middleLow[slot] = low;
+                    masks.middleHigh[slot] = high;
+                    masks.spacesMiddle[slot] = fill;
+                } else {
+                    masks.last[slot] = high;
+                    masks.spacesLast[slot] = fill;
+                }
+            }
+        }
+    }
+    return masks;
+}
+
+constexpr ShuffleMasks shuffleMasks = makeShuffleMasks();
+
+alignas(32) constexpr char digitTable[32] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+};
+
+#endif
+
+} // namespace
+
+/**
+ * @brief Encodes the input with the portable lookup-table kernel.
+ *
+ * @param input The bytes to encode.
+ * @param output The destination, at least `encodedSize(input.size())` bytes long.
+ */
+void HexEncoder::encodeScalar(std::string_view input, char* output) {
+    for (unsigned char byte : input) {
+        std::memcpy(output, tokenTable[byte].data(), 3);
+        output += 3;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * @brief Encodes the input with the SSSE3 kernel, 16 bytes at a time.
+ *
+ * @param input The bytes to encode.
+ * @param output The destination, at least `encodedSize(input.size())` bytes long.
+ */
+__attribute__((target("ssse3")))
+void HexEncoder::encodeSsse3(std::string_view input, char* output) {
+    const __m128i digits = _mm_load_si128(reinterpret_cast<const __m128i*>(digitTable));
+    const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+    const __m128i first = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleMasks.first));
+    const __m128i middleLow = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleMasks.middleLow));
+    const __m128i middleHigh = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleMasks.middleHigh));
+    const __m128i last = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleMasks.last));
+    const __m128i spacesFirst = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleMasks.spacesFirst));
+    const __m128i spacesMiddle = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleMasks.spacesMiddle));
+    const __m128i spacesLast = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleMasks.spacesLast));
+
+    const char* data = input.data();
+    std::size_t remaining = input.size();
+    while (remaining >= 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbleMask));
+        const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibbleMask));
+        const __m128i pairs0 = _mm_unpacklo_epi8(high, low);
+        const __m128i pairs1 = _mm_unpackhi_epi8(high, low);
+
+        const __m128i out0 = _mm_or_si128(_mm_shuffle_epi8(pairs0, first), spacesFirst);
+        const __m128i out1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(pairs0, middleLow),
+                                                       _mm_shuffle_epi8(pairs1, middleHigh)), spacesMiddle);
+        const __m128i out2 = _mm_or_si128(_mm_shuffle_epi8(pairs1, last), spacesLast);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), out0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 16), out1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 32), out2);
+
+        data += 16;
+        output += 48;
+        remaining -= 16;
+    }
+    encodeScalar(std::string_view(data, remaining), output);
+}
+
+/**
+ * @brief Encodes the input with the AVX2 kernel, 32 bytes at a time.
+ *
+ * `vpshufb` works within 128-bit lanes, so each lane encodes 16 bytes exactly like the SSSE3
+ * kernel; the six resulting half-registers are then reordered into three consecutive stores.
+ *
+ * @param input The bytes to encode.
+ * @param output The destination, at least `encodedSize(input.size())` bytes long.
+ */
+__attribute__((target("avx2")))
+void HexEncoder::encodeAvx2(std::string_view input, char* output) {
+    const __m256i digits = _mm256_load_si256(reinterpret_cast<const __m256i*>(digitTable));
+    const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+    const __m256i first = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffleMasks.first));
+    const __m256i middleLow = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffleMasks.middleLow));
+    const __m256i middleHigh = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffleMasks.middleHigh));
+    const __m256i last = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffleMasks.last));
+    const __m256i spacesFirst = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffleMasks.spacesFirst));
+    const __m256i spacesMiddle = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffleMasks.spacesMiddle));
+    const __m256i spacesLast = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffleMasks.spacesLast));
+
+    const char* data = input.data();
+    std::size_t remaining = input.size();
+    while (remaining >= 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        const __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibbleMask));
+        const __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, nibbleMask));
+        const __m256i pairs0 = _mm256_unpacklo_epi8(high, low);
+        const __m256i pairs1 = _mm256_unpackhi_epi8(high, low);
+
+        // Lane 0 encodes input bytes 0-15, lane 1 input bytes 16-31
+        const __m256i out0 = _mm256_or_si256(_mm256_shuffle_epi8(pairs0, first), spacesFirst);
+        const __m256i out1 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(pairs0, middleLow),
+                                                             _mm256_shuffle_epi8(pairs1, middleHigh)), spacesMiddle);
+        const __m256i out2 = _mm256_or_si256(_mm256_shuffle_epi8(pairs1, last), spacesLast);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), _mm256_permute2x128_si256(out0, out1, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 32), _mm256_permute2x128_si256(out2, out0, 0x30));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 64), _mm256_permute2x128_si256(out1, out2, 0x31));
+
+        data += 32;
+        output += 96;
+        remaining -= 32;
+    }
+    encodeSsse3(std::string_view(data, remaining), output);
+}
+
+#endif
+
+namespace {
+
+/**
+ * @brief Picks the fastest kernel supported by the CPU.
+ */
+HexEncoder::Kernel selectKernel(const char** name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return &HexEncoder::encodeAvx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        *name = "ssse3";
+        return &HexEncoder::encodeSsse3;
+    }
+#endif
+    *name = "scalar";
+    return &HexEncoder::encodeScalar;
+}
+
+/**
+ * @struct Dispatch
+ * @brief The kernel selected for this CPU, resolved once on first use.
+ */
+struct Dispatch {
+    const char* name = nullptr;
+    HexEncoder::Kernel kernel = selectKernel(&name);
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch selected;
+    return selected;
+}
+
+} // namespace
+
+/**
+ * @brief Encodes the input with the fastest kernel supported by the CPU.
+ *
+ * @param input The bytes to encode.
+ * @param output The destination, at least `encodedSize(input.size())` bytes long.
+ */
+void HexEncoder::encode(std::string_view input, char* output) {
+    dispatch().kernel(input, output);
+}
+
+/**
+ * @brief Returns the name of the kernel used by `encode`.
+ */
+const char* HexEncoder::kernelName() {
+    return dispatch().name;
+}
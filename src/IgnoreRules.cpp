@@ -0,0 +1,279 @@
+/**
+ * @file IgnoreRules.cpp
+ * @headerfile IgnoreRules.h
+ * @brief This file contains the implementation of the IgnoreRules class.
+ *
+ * Every pattern is translated into a regular expression matching the whole path relative to the
+ * directory of its source: a star becomes `[^/]*`, a double star followed by a slash becomes an
+ * optional sequence of directories, and patterns without a slash are prefixed with that same
+ * optional sequence so they match names at any depth. The expressions of a run of patterns are
+ * joined into one alternation and compiled by the `Matcher` into a deterministic automaton.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include "globals.h"
+#include "IgnoreRules.h"
+
+namespace {
+
+/**
+ * @struct Pattern
+ * @brief One pattern, translated into a regular expression.
+ */
+struct Pattern {
+    std::string source;         ///< The pattern as written.
+    std::string expression;     ///< The regular expression matching the paths of the pattern, without anchors.
+    bool negated = false;       ///< Whether the pattern starts with `!`.
+    bool directoryOnly = false; ///< Whether the pattern ends with `/`.
+};
+
+/**
+ * @brief Appends a character to a regular expression, escaped if it is special.
+ */
+void appendLiteral(std::string& expression, char c) {
+    if (std::string_view("\\^$.[]|()*+?{}").find(c) != std::string_view::npos) {
+        expression += '\\';
+    }
+    expression += c;
+}
+
+/**
+ * @brief Translates a `.gitignore` line into a regular expression.
+ *
+ * @param line The line.
+ * @param pattern Receives the translated pattern.
+ * @return `false` if the line is blank or a comment.
+ */
+bool translate(std::string line, Pattern& pattern) {
+    pattern.source = line;
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+        return false;
+    }
+    // Trailing spaces are ignored unless escaped
+    while (!line.empty() && line.back() == ' ' && !(line.size() >= 2 && line[line.size() - 2] == '\\')) {
+        line.pop_back();
+    }
+    if (!line.empty() && line[0] == '!') {
+        pattern.negated = true;
+        line.erase(0, 1);
+    }
+    if (!line.empty() && line.back() == '/') {
+        pattern.directoryOnly = true;
+        line.pop_back();
+    }
+    if (line.empty()) {
+        return false;
+    }
+
+    // A slash anywhere but at the end anchors the pattern to the directory of the source
+    bool anchored = line.find('/') != std::string::npos;
+    if (line[0] == '/') {
+        line.erase(0, 1);
+    }
+
+    std::string& expression = pattern.expression;
+    expression = anchored ? "" : "(.*/)?";
+    std::size_t size = line.size();
+    for (std::size_t i = 0; i < size;) {
+        char c = line[i];
+        bool segmentStart = i == 0 || line[i - 1] == '/';
+        if (c == '*' && i + 1 < size && line[i + 1] == '*' && segmentStart && (i + 2 == size || line[i + 2] == '/')) {
+            // `**/` matches any number of directories, a final `**` anything below
+            if (i + 2 == size) {
+                expression += ".*";
+                i += 2;
+            } else {
+                expression += "(.*/)?";
+                i += 3;
+            }
+        } else if (c == '*') {
+            expression += "[^/]*";
+            while (i < size && line[i] == '*') {
+                ++i;
+            }
+        } else if (c == '?') {
+            expression += "[^/]";
+            ++i;
+        } else if (c == '[') {
+            // Find the end of the bracket expression; without one, the bracket is a literal
+            std::size_t end = i + 1;
+            bool negatedSet = end < size && (line[end] == '!' || line[end] == '^');
+            if (negatedSet) {
+                ++end;
+            }
+            if (end < size && line[end] == ']') {
+                ++end;
+            }
+            while (end < size && line[end] != ']') {
+                ++end;
+            }
+            if (end >= size) {
+                appendLiteral(expression, c);
+                ++i;
+                continue;
+            }
+            expression += negatedSet ? "[^/" : "[";
+            for (std::size_t j = i + 1 + (negatedSet ? 1 : 0); j < end; ++j) {
+                if (line[j] == '\\') {
+                    expression += '\\';
+                }
+                expression += line[j];
+            }
+            expression += ']';
+            i = end + 1;
+        } else if (c == '\\' && i + 1 < size) {
+            appendLiteral(expression, line[i + 1]);
+            i += 2;
+        } else {
+            appendLiteral(expression, c);
+            ++i;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Compiles a list of expressions into as few automata as possible.
+ *
+ * The expressions are compiled into a single alternation; if its automaton is too large, they
+ * are compiled one by one. An expression that cannot be compiled on its own is reported and dropped.
+ *
+ * @param patterns The patterns whose expressions are compiled.
+ * @param matchers Receives the automata.
+ */
+void compile(const std::vector<const Pattern*>& patterns, std::vector<Matcher>& matchers) {
+    if (patterns.empty()) {
+        return;
+    }
+    std::string alternation;
+    for (const Pattern* pattern : patterns) {
+        alternation += alternation.empty() ? "^(" : "|";
+        alternation += pattern->expression;
+    }
+    alternation += ")$";
+    try {
+        matchers.emplace_back(alternation);
+        return;
+    } catch (const std::invalid_argument&) {
+        // Too large to be merged: fall back to one automaton per pattern
+    }
+    for (const Pattern* pattern : patterns) {
+        try {
+            matchers.emplace_back("^(" + pattern->expression + ")$");
+        } catch (const std::invalid_argument& e) {
+            std::cerr << std::string(SOFTWARE_NAME) + ": error: " + e.what()
+                       + " in ignore pattern `" + pattern->source + "`\n" << std::flush;
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Compiles a list of patterns.
+ *
+ * @param patterns The patterns, in the syntax of `.gitignore` lines.
+ * @param basePath The directory the patterns are relative to, relative to the root of the walk.
+ * @param parent The rules in force in the parent directory, or `nullptr`.
+ */
+IgnoreRules::IgnoreRules(const std::vector<std::string>& patterns, std::string basePath,
+                         std::shared_ptr<const IgnoreRules> parent)
+    : basePath(std::move(basePath)), parent(std::move(parent)) {
+    if (!this->basePath.empty() && this->basePath.back() != '/') {
+        this->basePath += '/';
+    }
+
+    std::vector<Pattern> translated;
+    for (const std::string& line : patterns) {
+        Pattern pattern;
+        if (translate(line, pattern)) {
+            translated.push_back(std::move(pattern));
+        }
+    }
+
+    // Group consecutive patterns of the same kind: the last matching run decides
+    for (std::size_t first = 0; first < translated.size();) {
+        std::size_t last = first;
+        while (last < translated.size() && translated[last].negated == translated[first].negated) {
+            ++last;
+        }
+        std::vector<const Pattern*> all;
+        std::vector<const Pattern*> files;
+        for (std::size_t i = first; i < last; ++i) {
+            all.push_back(&translated[i]);
+            if (!translated[i].directoryOnly) {
+                files.push_back(&translated[i]);
+            }
+        }
+        Run run;
+        run.negated = translated[first].negated;
+        compile(all, run.directoryMatchers);
+        compile(files, run.fileMatchers);
+        runs.push_back(std::move(run));
+        first = last;
+    }
+}
+
+/**
+ * @brief Reads the lines of an ignore file.
+ *
+ * @param filePath The path of the file.
+ * @param patterns Receives the lines of the file, appended.
+ * @return `true` if the file could be read.
+ */
+bool IgnoreRules::readPatterns(const std::string& filePath, std::vector<std::string>& patterns) {
+    std::ifstream file(filePath);
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        patterns.push_back(line);
+    }
+    return true;
+}
+
+/**
+ * @brief Matches a path against these rules and those of the parent directories.
+ *
+ * @param relativePath The path, relative to the root of the walk.
+ * @param isDirectory Whether the path is a directory.
+ * @return The verdict of the innermost rules that match, or `Verdict::None`.
+ */
+IgnoreRules::Verdict IgnoreRules::match(std::string_view relativePath, bool isDirectory) const {
+    for (const IgnoreRules* rules = this; rules != nullptr; rules = rules->parent.get()) {
+        Verdict verdict = rules->matchLocal(relativePath, isDirectory);
+        if (verdict != Verdict::None) {
+            return verdict;
+        }
+    }
+    return Verdict::None;
+}
+
+/**
+ * @brief Checks whether one level of rules matches a path, without looking at the parents.
+ *
+ * @param relativePath The path, relative to the root of the walk; it must lie below `basePath`.
+ * @param isDirectory Whether the path is a directory.
+ * @return The verdict of the last matching run, or `Verdict::None`.
+ */
+IgnoreRules::Verdict IgnoreRules::matchLocal(std::string_view relativePath, bool isDirectory) const {
+    if (relativePath.compare(0, basePath.size(), basePath) != 0) {
+        return Verdict::None;
+    }
+    std::string_view localPath = relativePath.substr(basePath.size());
+    for (auto run = runs.rbegin(); run != runs.rend(); ++run) {
+        const std::vector<Matcher>& matchers = isDirectory ? run->directoryMatchers : run->fileMatchers;
+        if (std::any_of(matchers.begin(), matchers.end(), [localPath](const Matcher& matcher) {
+                return matcher.matches(localPath); })) {
+            return run->negated ? Verdict::Negated : Verdict::Matched;
+        }
+    }
+    return Verdict::None;
+}
@@ -0,0 +1,827 @@
+/**
+ * @file Matcher.cpp
+ * @headerfile Matcher.h
+ * @brief This file contains the implementation of the Matcher class.
+ *
+ * Literals are searched with the "first and last byte" filter: at every position of a block of
+ * 16 or 32 bytes, the first byte of the literal is compared with the content at that position
+ * and its last byte with the content at the position plus the length of the literal, both with
+ * one vector comparison; only the positions where both match are compared in full.
+ *
+ * Regular expressions are parsed into a syntax tree, compiled into a Thompson automaton, then
+ * turned into a deterministic automaton by subset construction over classes of equivalent bytes.
+ * The automaton searches for a match anywhere in a line: the start state is added back after
+ * every byte, and newlines bring the automaton back to its line start state.
+ */
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include "Matcher.h"
+#include "Profiler.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using ByteSet = std::bitset<256>;
+
+/**
+ * @struct Node
+ * @brief A node of the syntax tree of a regular expression.
+ */
+struct Node {
+    enum class Type { Set, Concat, Alternate, Repeat, LineStart, LineEnd, Empty };
+
+    explicit Node(Type type) : type(type) {}
+
+    Type type;
+    ByteSet set;                                ///< The bytes matched by a `Set`.
+    std::vector<std::unique_ptr<Node>> children; ///< The operands of `Concat`, `Alternate` and `Repeat`.
+    int min = 0;                                ///< The minimum count of a `Repeat`.
+    int max = 0;                                ///< The maximum count of a `Repeat`, or -1 if unbounded.
+};
+
+/**
+ * @brief Adds the other case of every ASCII letter of a set.
+ */
+void foldCase(ByteSet& set) {
+    for (int c = 'a'; c <= 'z'; ++c) {
+        if (set[c] || set[c - 'a' + 'A']) {
+            set.set(c);
+            set.set(c - 'a' + 'A');
+        }
+    }
+}
+
+ByteSet rangeSet(int first, int last) {
+    ByteSet set;
+    for (int c = first; c <= last; ++c) {
+        set.set(c);
+    }
+    return set;
+}
+
+ByteSet digitSet() { return rangeSet('0', '9'); }
+ByteSet wordSet() { return rangeSet('a', 'z') | rangeSet('A', 'Z') | digitSet() | rangeSet('_', '_'); }
+ByteSet spaceSet() { return rangeSet(' ', ' ') | rangeSet('\t', '\t') | rangeSet('\v', '\r'); }
+
+/**
+ * @brief Complements a set. Newlines are never part of the result: matches do not span lines.
+ */
+ByteSet negate(ByteSet set) {
+    set.flip();
+    set.reset('\n');
+    return set;
+}
+
+/**
+ * @brief Finds the smallest byte of a set, or returns 256 if the set is empty.
+ */
+int firstByte(const ByteSet& set) {
+    int c = 0;
+    while (c < 256 && !set[c]) {
+        ++c;
+    }
+    return c;
+}
+
+/**
+ * @class Parser
+ * @brief Recursive-descent parser of the supported regular expression syntax.
+ */
+class Parser {
+public:
+    Parser(std::string_view pattern, bool ignoreCase) : pattern(pattern), ignoreCase(ignoreCase) {}
+
+    std::unique_ptr<Node> parse() {
+        std::unique_ptr<Node> node = parseAlternation();
+        if (position < pattern.size()) {
+            fail("unmatched `)`");
+        }
+        return node;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& reason) const {
+        throw std::invalid_argument("invalid pattern `" + std::string(pattern) + "`: " + reason);
+    }
+
+    bool atEnd() const { return position >= pattern.size(); }
+    char peek() const { return pattern[position]; }
+
+    std::unique_ptr<Node> makeSet(ByteSet set) const {
+        auto node = std::make_unique<Node>(Node::Type::Set);
+        if (ignoreCase) {
+            foldCase(set);
+        }
+        node->set = set;
+        return node;
+    }
+
+    std::unique_ptr<Node> parseAlternation() {
+        std::unique_ptr<Node> first = parseConcatenation();
+        if (atEnd() || peek() != '|') {
+            return first;
+        }
+        auto node = std::make_unique<Node>(Node::Type::Alternate);
+        node->children.push_back(std::move(first));
+        while (!atEnd() && peek() == '|') {
+            ++position;
+            node->children.push_back(parseConcatenation());
+        }
+        return node;
+    }
+
+    std::unique_ptr<Node> parseConcatenation() {
+        auto node = std::make_unique<Node>(Node::Type::Concat);
+        while (!atEnd() && peek() != '|' && peek() != ')') {
+            node->children.push_back(parseRepetition());
+        }
+        if (node->children.empty()) {
+            return std::make_unique<Node>(Node::Type::Empty);
+        }
+        if (node->children.size() == 1) {
+            return std::move(node->children.front());
+        }
+        return node;
+    }
+
+    std::unique_ptr<Node> parseRepetition() {
+        std::unique_ptr<Node> node = parseAtom();
+        while (!atEnd()) {
+            int min = 0;
+            int max = 0;
+            if (peek() == '*') {
+                min = 0, max = -1;
+                ++position;
+            } else if (peek() == '+') {
+                min = 1, max = -1;
+                ++position;
+            } else if (peek() == '?') {
+                min = 0, max = 1;
+                ++position;
+            } else if (peek() == '{' && parseBounds(min, max)) {
+                // Bounds parsed
+            } else {
+                break;
+            }
+            auto repeat = std::make_unique<Node>(Node::Type::Repeat);
+            repeat->min = min;
+            repeat->max = max;
+            repeat->children.push_back(std::move(node));
+            node = std::move(repeat);
+        }
+        return node;
+    }
+
+    /**
+     * @brief Parses `{m}`, `{m,}` or `{m,n}`. A brace not followed by a count is a literal.
+     */
+    bool parseBounds(int& min, int& max) {
+        std::size_t start = position + 1;
+        auto readNumber = [this](std::size_t& at, int& value) {
+            std::size_t first = at;
+            value = 0;
+            while (at < pattern.size() && pattern[at] >= '0' && pattern[at] <= '9') {
+                value = std::min(value * 10 + (pattern[at] - '0'), maxRepeatParsed);
+                ++at;
+            }
+            return at > first;
+        };
+        std::size_t at = start;
+        if (!readNumber(at, min)) {
+            return false;
+        }
+        max = min;
+        if (at < pattern.size() && pattern[at] == ',') {
+            ++at;
+            if (!readNumber(at, max)) {
+                max = -1;
+            }
+        }
+        if (at >= pattern.size() || pattern[at] != '}') {
+            return false;
+        }
+        if ((max != -1 && max < min) || min > Matcher::maxRepeat || max > Matcher::maxRepeat) {
+            fail("invalid repetition count");
+        }
+        position = at + 1;
+        return true;
+    }
+
+    std::unique_ptr<Node> parseAtom() {
+        char c = peek();
+        ++position;
+        switch (c) {
+            case '(': {
+                std::unique_ptr<Node> node = parseAlternation();
+                if (atEnd() || peek() != ')') {
+                    fail("unmatched `(`");
+                }
+                ++position;
+                return node;
+            }
+            case '[':
+                return makeSet(parseBracket());
+            case '.':
+                return makeSet(negate(ByteSet()));
+            case '^':
+                return std::make_unique<Node>(Node::Type::LineStart);
+            case '$':
+                return std::make_unique<Node>(Node::Type::LineEnd);
+            case '\\':
+                return makeSet(parseEscape());
+            case '*':
+            case '+':
+            case '?':
+                fail(std::string("nothing to repeat before `") + c + "`");
+            default:
+                return makeSet(rangeSet(static_cast<unsigned char>(c), static_cast<unsigned char>(c)));
+        }
+    }
+
+    /**
+     * @brief Parses the character following a backslash. Any other escaped character than the
+     * supported ones must be a punctuation character other than `<` and `>`, which then stands for
+     * itself.
+     */
+    ByteSet parseEscape() {
+        if (atEnd()) {
+            fail("trailing backslash");
+        }
+        char c = peek();
+        ++position;
+        switch (c) {
+            case 'd': return digitSet();
+            case 'D': return negate(digitSet());
+            case 'w': return wordSet();
+            case 'W': return negate(wordSet());
+            case 's': return spaceSet();
+            case 'S': return negate(spaceSet());
+            case 't': return rangeSet('\t', '\t');
+            case 'n': return rangeSet('\n', '\n');
+            case 'r': return rangeSet('\r', '\r');
+            default:
+                // `\<` and `\>` are word boundaries in other syntaxes: never match them literally
+                if (!std::ispunct(static_cast<unsigned char>(c)) || c == '<' || c == '>') {
+                    fail(std::string("unsupported escape `\\") + c + "`");
+                }
+                return rangeSet(static_cast<unsigned char>(c), static_cast<unsigned char>(c));
+        }
+    }
+
+    /**
+     * @brief Parses a bracket expression, after its opening bracket.
+     */
+    ByteSet parseBracket() {
+        static const std::pair<const char*, ByteSet (*)()> namedClasses[] = {
+            {"[:digit:]", [] { return digitSet(); }},
+            {"[:alpha:]", [] { return rangeSet('a', 'z') | rangeSet('A', 'Z'); }},
+            {"[:alnum:]", [] { return rangeSet('a', 'z') | rangeSet('A', 'Z') | digitSet(); }},
+            {"[:upper:]", [] { return rangeSet('A', 'Z'); }},
+            {"[:lower:]", [] { return rangeSet('a', 'z'); }},
+            {"[:space:]", [] { return spaceSet(); }},
+            {"[:xdigit:]", [] { return digitSet() | rangeSet('a', 'f') | rangeSet('A', 'F'); }},
+            {"[:punct:]", [] { return rangeSet('!', '/') | rangeSet(':', '@') | rangeSet('[', '`') | rangeSet('{', '~'); }},
+        };
+
+        ByteSet set;
+        bool negated = !atEnd() && peek() == '^';
+        if (negated) {
+            ++position;
+        }
+        bool first = true;
+        while (true) {
+            if (atEnd()) {
+                fail("unmatched `[`");
+            }
+            char c = peek();
+            if (c == ']' && !first) {
+                ++position;
+                break;
+            }
+            first = false;
+
+            bool named = false;
+            for (const auto& [name, make] : namedClasses) {
+                if (pattern.substr(position).compare(0, std::strlen(name), name) == 0) {
+                    set |= make();
+                    position += std::strlen(name);
+                    named = true;
+                    break;
+                }
+            }
+            if (named) {
+                continue;
+            }
+
+            int low;
+            ++position;
+            if (c == '\\') {
+                ByteSet escaped = parseEscape();
+                if (escaped.count() != 1) {
+                    set |= escaped;
+                    continue;
+                }
+                low = firstByte(escaped);
+            } else {
+                low = static_cast<unsigned char>(c);
+            }
+
+            // A range, unless the dash is the last character of the expression
+            if (position + 1 < pattern.size() && peek() == '-' && pattern[position + 1] != ']') {
+                ++position;
+                int high = static_cast<unsigned char>(peek());
+                ++position;
+                if (high == '\\') {
+                    ByteSet escaped = parseEscape();
+                    if (escaped.count() != 1) {
+                        fail("invalid range in bracket expression");
+                    }
+                    high = firstByte(escaped);
+                }
+                if (high < low) {
+                    fail("invalid range in bracket expression");
+                }
+                set |= rangeSet(low, high);
+            } else {
+                set.set(static_cast<std::size_t>(low));
+            }
+        }
+        return negated ? negate(set) : set;
+    }
+
+    static constexpr int maxRepeatParsed = 100000;
+
+    std::string_view pattern;
+    bool ignoreCase;
+    std::size_t position = 0;
+};
+
+/**
+ * @struct NfaState
+ * @brief A state of the Thompson automaton.
+ */
+struct NfaState {
+    enum class Kind { Byte, Split, LineStart, LineEnd, Match };
+
+    Kind kind;
+    ByteSet set;   ///< The bytes accepted by a `Byte` state.
+    int out = -1;  ///< The next state.
+    int out1 = -1; ///< The alternative next state of a `Split`.
+};
+
+constexpr std::size_t maxNfaStates = 200000;
+
+/**
+ * @class NfaBuilder
+ * @brief Compiles a syntax tree into a Thompson automaton, from the end of the pattern backwards.
+ */
+class NfaBuilder {
+public:
+    std::vector<NfaState> states;
+
+    int add(NfaState state) {
+        if (states.size() >= maxNfaStates) {
+            throw std::invalid_argument("pattern too large");
+        }
+        states.push_back(state);
+        return static_cast<int>(states.size() - 1);
+    }
+
+    /**
+     * @brief Compiles a node whose matches continue with state `next`, and returns its entry state.
+     */
+    int compile(const Node& node, int next) {
+        switch (node.type) {
+            case Node::Type::Set:
+                return add({NfaState::Kind::Byte, node.set, next});
+            case Node::Type::Concat:
+                for (auto child = node.children.rbegin(); child != node.children.rend(); ++child) {
+                    next = compile(**child, next);
+                }
+                return next;
+            case Node::Type::Alternate: {
+                int entry = compile(*node.children.back(), next);
+                for (std::size_t i = node.children.size() - 1; i-- > 0;) {
+                    int branch = compile(*node.children[i], next);
+                    entry = add({NfaState::Kind::Split, ByteSet(), branch, entry});
+                }
+                return entry;
+            }
+            case Node::Type::Repeat: {
+                const Node& child = *node.children.front();
+                int entry = next;
+                if (node.max == -1) {
+                    // Loop: the body goes back to the split, which may exit
+                    int loop = add({NfaState::Kind::Split, ByteSet(), -1, next});
+                    int body = compile(child, loop);
+                    states[static_cast<std::size_t>(loop)].out = body;
+                    entry = loop;
+                } else {
+                    // Optional copies, nested: X{0,2} is (X(X)?)?
+                    for (int i = node.min; i < node.max; ++i) {
+                        int body = compile(child, entry);
+                        entry = add({NfaState::Kind::Split, ByteSet(), body, next});
+                    }
+                }
+                for (int i = 0; i < node.min; ++i) {
+                    entry = compile(child, entry);
+                }
+                return entry;
+            }
+            case Node::Type::LineStart:
+                return add({NfaState::Kind::LineStart, ByteSet(), next});
+            case Node::Type::LineEnd:
+                return add({NfaState::Kind::LineEnd, ByteSet(), next});
+            case Node::Type::Empty:
+                return next;
+        }
+        return next;
+    }
+};
+
+/**
+ * @brief Adds to `result` the states reachable from `start` without reading a byte.
+ *
+ * `Byte`, `Match` and `LineEnd` states are kept; `LineEnd` assertions are only crossed at the end
+ * of a line, by `matchesAtLineEnd`. `LineStart` assertions are crossed only at the start of a line.
+ */
+void closure(const std::vector<NfaState>& states, int start, bool atLineStart,
+             std::vector<char>& visited, std::vector<int>& result) {
+    std::vector<int> stack{start};
+    while (!stack.empty()) {
+        int index = stack.back();
+        stack.pop_back();
+        if (index < 0 || visited[static_cast<std::size_t>(index)]) {
+            continue;
+        }
+        visited[static_cast<std::size_t>(index)] = 1;
+        const NfaState& state = states[static_cast<std::size_t>(index)];
+        switch (state.kind) {
+            case NfaState::Kind::Byte:
+            case NfaState::Kind::Match:
+            case NfaState::Kind::LineEnd:
+                result.push_back(index);
+                break;
+            case NfaState::Kind::Split:
+                stack.push_back(state.out1);
+                stack.push_back(state.out);
+                break;
+            case NfaState::Kind::LineStart:
+                if (atLineStart) {
+                    stack.push_back(state.out);
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Checks whether a set of states reaches a match when the line ends here.
+ */
+bool matchesAtLineEnd(const std::vector<NfaState>& states, const std::vector<int>& set) {
+    std::vector<char> visited(states.size(), 0);
+    std::vector<int> stack(set.begin(), set.end());
+    while (!stack.empty()) {
+        int index = stack.back();
+        stack.pop_back();
+        if (index < 0 || visited[static_cast<std::size_t>(index)]) {
+            continue;
+        }
+        visited[static_cast<std::size_t>(index)] = 1;
+        const NfaState& state = states[static_cast<std::size_t>(index)];
+        if (state.kind == NfaState::Kind::Match) {
+            return true;
+        }
+        if (state.kind == NfaState::Kind::LineEnd) {
+            stack.push_back(state.out);
+        } else if (state.kind == NfaState::Kind::Split) {
+            stack.push_back(state.out);
+            stack.push_back(state.out1);
+        }
+    }
+    return false;
+}
+
+constexpr std::uint8_t matchFlag = 1;        ///< The state has matched.
+constexpr std::uint8_t lineEndMatchFlag = 2; ///< The state matches if the line ends here.
+
+/**
+ * @brief Escapes the special characters of a literal, to compile it as a regular expression.
+ */
+std::string escapeLiteral(const std::string& literal) {
+    std::string escaped;
+    for (char c : literal) {
+        if (std::strchr("\\^$.[]|()*+?{}", c) != nullptr && c != '\0') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+using FindKernel = std::size_t (*)(std::string_view content, std::string_view literal);
+
+std::size_t findScalar(std::string_view content, std::string_view literal) {
+    return content.find(literal);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse2")))
+std::size_t findSse2(std::string_view content, std::string_view literal) {
+    std::size_t length = literal.size();
+    if (length < 2) {
+        return content.find(literal);
+    }
+    const char* data = content.data();
+    const __m128i first = _mm_set1_epi8(literal.front());
+    const __m128i last = _mm_set1_epi8(literal.back());
+    std::size_t i = 0;
+    for (; i + length - 1 + 16 <= content.size(); i += 16) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + length - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+        while (mask != 0) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (std::memcmp(data + i + bit + 1, literal.data() + 1, length - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    std::size_t rest = content.substr(i).find(literal);
+    return rest == std::string_view::npos ? rest : i + rest;
+}
+
+__attribute__((target("avx2")))
+std::size_t findAvx2(std::string_view content, std::string_view literal) {
+    std::size_t length = literal.size();
+    if (length < 2) {
+        return content.find(literal);
+    }
+    const char* data = content.data();
+    const __m256i first = _mm256_set1_epi8(literal.front());
+    const __m256i last = _mm256_set1_epi8(literal.back());
+    std::size_t i = 0;
+    for (; i + length - 1 + 32 <= content.size(); i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + length - 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast))));
+        while (mask != 0) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (std::memcmp(data + i + bit + 1, literal.data() + 1, length - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    std::size_t rest = content.substr(i).find(literal);
+    return rest == std::string_view::npos ? rest : i + rest;
+}
+
+#endif
+
+/**
+ * @brief Picks the fastest literal search supported by the CPU, once.
+ */
+FindKernel findKernel() {
+    static const FindKernel kernel = [] {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return &findAvx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return &findSse2;
+        }
+#endif
+        return &findScalar;
+    }();
+    return kernel;
+}
+
+} // namespace
+
+/**
+ * @brief Compiles a pattern.
+ *
+ * @param pattern The pattern to search.
+ * @param fixedStrings Whether the pattern is a literal.
+ * @param ignoreCase Whether ASCII letters match regardless of their case.
+ * @throw std::invalid_argument If the pattern is malformed or its automaton is too large.
+ */
+Matcher::Matcher(const std::string& pattern, bool fixedStrings, bool ignoreCase) {
+    bool hasSpecialCharacters = pattern.find_first_of("\\^$.[]|()*+?{}") != std::string::npos;
+    if (!ignoreCase && (fixedStrings || !hasSpecialCharacters)) {
+        literalSearch = true;
+        literal = pattern;
+        return;
+    }
+
+    // Parse and compile the pattern into a Thompson automaton
+    std::unique_ptr<Node> tree = Parser(fixedStrings ? escapeLiteral(pattern) : pattern, ignoreCase).parse();
+    NfaBuilder builder;
+    int match = builder.add({NfaState::Kind::Match, ByteSet()});
+    int start = builder.compile(*tree, match);
+    const std::vector<NfaState>& states = builder.states;
+
+    // Split the bytes into classes that no state tells apart; newlines get their own class
+    std::vector<ByteSet> sets{rangeSet('\n', '\n')};
+    for (const NfaState& state : states) {
+        if (state.kind == NfaState::Kind::Byte) {
+            sets.push_back(state.set);
+        }
+    }
+    std::map<std::vector<bool>, std::uint8_t> signatures;
+    std::vector<int> representatives;
+    for (int byte = 0; byte < 256; ++byte) {
+        std::vector<bool> signature(sets.size());
+        for (std::size_t i = 0; i < sets.size(); ++i) {
+            signature[i] = sets[i][static_cast<std::size_t>(byte)];
+        }
+        auto [entry, inserted] = signatures.emplace(std::move(signature), static_cast<std::uint8_t>(signatures.size()));
+        if (inserted) {
+            representatives.push_back(byte);
+        }
+        byteClasses[static_cast<std::size_t>(byte)] = entry->second;
+    }
+    classCount = representatives.size();
+
+    // Subset construction. The start state is added back after every byte, so that a match may
+    // start anywhere in the line
+    std::vector<char> visited(states.size());
+    std::vector<int> restart;
+    closure(states, start, false, visited, restart);
+
+    std::map<std::vector<int>, std::int32_t> ids;
+    std::vector<std::vector<int>> subsets;
+    auto stateOf = [&](std::vector<int> subset) {
+        std::sort(subset.begin(), subset.end());
+        subset.erase(std::unique(subset.begin(), subset.end()), subset.end());
+        auto found = ids.find(subset);
+        if (found != ids.end()) {
+            return found->second;
+        }
+        if (subsets.size() >= maxStates) {
+            throw std::invalid_argument("pattern too complex");
+        }
+        std::int32_t id = static_cast<std::int32_t>(subsets.size());
+        std::uint8_t stateFlags = 0;
+        if (std::any_of(subset.begin(), subset.end(), [&](int index) {
+                return states[static_cast<std::size_t>(index)].kind == NfaState::Kind::Match; })) {
+            stateFlags = matchFlag | lineEndMatchFlag;
+        } else if (matchesAtLineEnd(states, subset)) {
+            stateFlags = lineEndMatchFlag;
+        }
+        if (subset.empty()) {
+            deadState = id;
+        }
+        flags.push_back(stateFlags);
+        ids.emplace(subset, id);
+        subsets.push_back(std::move(subset));
+        return id;
+    };
+
+    std::vector<int> initial;
+    std::fill(visited.begin(), visited.end(), 0);
+    closure(states, start, true, visited, initial);
+    lineStartState = stateOf(initial);
+
+    for (std::size_t current = 0; current < subsets.size(); ++current) {
+        transitions.resize(subsets.size() * classCount, -1);
+        for (std::size_t byteClass = 0; byteClass < classCount; ++byteClass) {
+            std::int32_t next;
+            if (flags[current] & matchFlag) {
+                // Once matched, the line matches whatever follows
+                next = static_cast<std::int32_t>(current);
+            } else {
+                std::vector<int> subset = restart;
+                std::fill(visited.begin(), visited.end(), 0);
+                int byte = representatives[byteClass];
+                for (int index : subsets[current]) {
+                    const NfaState& state = states[static_cast<std::size_t>(index)];
+                    if (state.kind == NfaState::Kind::Byte && state.set[static_cast<std::size_t>(byte)]) {
+                        closure(states, state.out, false, visited, subset);
+                    }
+                }
+                next = stateOf(std::move(subset));
+            }
+            transitions[current * classCount + byteClass] = next;
+        }
+    }
+    transitions.resize(subsets.size() * classCount, -1);
+}
+
+/**
+ * @brief Finds the next line holding a match.
+ *
+ * @param content The content to search.
+ * @param from The offset where the search starts, at the start of a line.
+ * @param lineBegin Receives the offset of the matching line.
+ * @param lineEnd Receives the offset of the end of the matching line, excluding the newline.
+ * @return `true` if a matching line was found.
+ */
+bool Matcher::findLine(std::string_view content, std::size_t from, std::size_t& lineBegin, std::size_t& lineEnd) const {
+    Profiler::ScopedTimer timer(Profiler::Stage::Search);
+    if (from >= content.size()) {
+        return false;
+    }
+    return literalSearch ? findLineLiteral(content, from, lineBegin, lineEnd)
+                         : findLineDfa(content, from, lineBegin, lineEnd);
+}
+
+/**
+ * @brief Checks whether a single line holds a match.
+ *
+ * @param line The line, without any newline.
+ * @return `true` if the line holds a match.
+ */
+bool Matcher::matches(std::string_view line) const {
+    std::size_t lineBegin = 0;
+    std::size_t lineEnd = 0;
+    if (literalSearch) {
+        return !line.empty() ? findLineLiteral(line, 0, lineBegin, lineEnd) : literal.empty();
+    }
+    if (line.empty()) {
+        // The automaton only runs over non-empty content; an empty line ends right at its start
+        return (flags[static_cast<std::size_t>(lineStartState)] & (matchFlag | lineEndMatchFlag)) != 0;
+    }
+    return findLineDfa(line, 0, lineBegin, lineEnd);
+}
+
+/**
+ * @brief Finds the next line holding the literal, then extends the match to its line.
+ */
+bool Matcher::findLineLiteral(std::string_view content, std::size_t from, std::size_t& lineBegin, std::size_t& lineEnd) const {
+    std::size_t found = findKernel()(content.substr(from), literal);
+    if (found == std::string_view::npos) {
+        return false;
+    }
+    found += from;
+
+    const char* data = content.data();
+    const void* previousNewline = memrchr(data + from, '\n', found - from);
+    lineBegin = previousNewline != nullptr ? static_cast<std::size_t>(static_cast<const char*>(previousNewline) - data) + 1 : from;
+    const void* nextNewline = std::memchr(data + found, '\n', content.size() - found);
+    lineEnd = nextNewline != nullptr ? static_cast<std::size_t>(static_cast<const char*>(nextNewline) - data) : content.size();
+    return true;
+}
+
+/**
+ * @brief Runs the automaton over the content, line by line, until a line matches.
+ *
+ * Lines on which the automaton reaches its dead state (only possible for anchored patterns) are
+ * skipped with `memchr` without looking at their remaining bytes.
+ */
+bool Matcher::findLineDfa(std::string_view content, std::size_t from, std::size_t& lineBegin, std::size_t& lineEnd) const {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(content.data());
+    const std::size_t size = content.size();
+    const std::int32_t* table = transitions.data();
+    const std::uint8_t* stateFlags = flags.data();
+
+    std::size_t begin = from;
+    std::int32_t state = lineStartState;
+    std::size_t i = from;
+    while (true) {
+        if (stateFlags[state] & matchFlag) {
+            // The line matches: find its end
+            const void* newline = std::memchr(data + i, '\n', size - i);
+            lineBegin = begin;
+            lineEnd = newline != nullptr ? static_cast<std::size_t>(static_cast<const unsigned char*>(newline) - data) : size;
+            return true;
+        }
+        if (state == deadState) {
+            const void* newline = std::memchr(data + i, '\n', size - i);
+            if (newline == nullptr) {
+                return false;
+            }
+            i = static_cast<std::size_t>(static_cast<const unsigned char*>(newline) - data);
+        }
+        if (i >= size || data[i] == '\n') {
+            if (stateFlags[state] & lineEndMatchFlag) {
+                lineBegin = begin;
+                lineEnd = i;
+                return true;
+            }
+            if (i + 1 >= size) {
+                return false;
+            }
+            begin = ++i;
+            state = lineStartState;
+            continue;
+        }
+        state = table[static_cast<std::size_t>(state) * classCount + byteClasses[data[i]]];
+        ++i;
+    }
+}
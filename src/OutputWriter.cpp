@@ -0,0 +1,178 @@
+/**
+ * @file OutputWriter.cpp
+ * @headerfile OutputWriter.h
+ * @brief This file contains the implementation of the OutputWriter class.
+ *
+ * The OutputWriter class batches everything written to a file descriptor into a large reusable
+ * buffer and issues it with `writev`. Small pieces (separators, colorized paths, short files)
+ * are copied into the buffer; large pieces (the content of big files) are written in place,
+ * together with the buffered bytes, in a single system call.
+ *
+ * The kernel reads the pieces written in place itself, so a page of a mapped file that is gone
+ * (the file was truncated) makes `writev` fail with `EFAULT` rather than raise `SIGBUS`. Only
+ * that piece is dropped: the buffered bytes, which are always readable, are still written.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/uio.h>
+#include <system_error>
+#include <unistd.h>
+#include "globals.h"
+#include "OutputWriter.h"
+#include "Profiler.h"
+
+/**
+ * @brief Constructs a writer for a file descriptor.
+ *
+ * @param fd The file descriptor to write to.
+ */
+OutputWriter::OutputWriter(int fd)
+    : fd(fd), isTerminal(isatty(fd) == 1), buffer(std::make_unique<char[]>(bufferCapacity)) {}
+
+/**
+ * @brief Flushes the pending output.
+ */
+OutputWriter::~OutputWriter() {
+    flush();
+}
+
+/**
+ * @brief Returns the writer of the standard output.
+ */
+OutputWriter& OutputWriter::standardOutput() {
+    static OutputWriter writer(STDOUT_FILENO);
+    return writer;
+}
+
+/**
+ * @brief Appends data to the output.
+ *
+ * @param data The data to write.
+ */
+void OutputWriter::write(std::string_view data) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Write);
+    ++stats.segments;
+    if (data.size() <= copyThreshold && buffered + data.size() <= bufferCapacity) {
+        std::memcpy(buffer.get() + buffered, data.data(), data.size());
+        buffered += data.size();
+    } else if (data.size() <= copyThreshold) {
+        // The buffer is full: flush it and start over with this piece
+        writeOut({});
+        std::memcpy(buffer.get(), data.data(), data.size());
+        buffered = data.size();
+    } else {
+        // Write large pieces in place rather than copying them
+        writeOut(data);
+    }
+}
+
+/**
+ * @brief Marks the end of the output of a file.
+ *
+ * On a terminal the output is flushed so that each file appears as soon as it is complete;
+ * otherwise the buffered files are written together once the buffer is full.
+ */
+void OutputWriter::endFile() {
+    if (isTerminal) {
+        flush();
+    }
+}
+
+/**
+ * @brief Returns free space at the end of the buffer, for an encoder to write into.
+ *
+ * The buffered bytes are written first if less than `size` bytes are free, so encoders produce
+ * their output in place instead of building it in a string of their own.
+ *
+ * @param size The number of bytes needed, at most `bufferCapacity`.
+ * @return The address of `size` writable bytes, valid until the next call to the writer.
+ */
+char* OutputWriter::reserve(std::size_t size) {
+    if (buffered + size > bufferCapacity) {
+        Profiler::ScopedTimer timer(Profiler::Stage::Write);
+        writeOut({});
+    }
+    return buffer.get() + buffered;
+}
+
+/**
+ * @brief Adds to the output the bytes written at the address returned by `reserve`.
+ *
+ * @param size The number of bytes written, at most the size passed to `reserve`.
+ */
+void OutputWriter::commit(std::size_t size) {
+    ++stats.segments;
+    buffered += size;
+}
+
+/**
+ * @brief Writes all buffered data.
+ */
+void OutputWriter::flush() {
+    Profiler::ScopedTimer timer(Profiler::Stage::Write);
+    if (buffered > 0) {
+        writeOut({});
+    }
+}
+
+/**
+ * @brief Writes the buffered bytes followed by `extra`, retrying after partial writes.
+ *
+ * If `extra` cannot be read, the rest of it is dropped and counted in `faultCount`. Any other
+ * error drops what is left of the call and is reported the first time; only a closed descriptor
+ * or a broken pipe discards the output for good.
+ *
+ * @param extra Data written after the buffered bytes, possibly empty.
+ */
+void OutputWriter::writeOut(std::string_view extra) {
+    iovec vectors[2];
+    int count = 0;
+    if (buffered > 0) {
+        vectors[count++] = {buffer.get(), buffered};
+    }
+    if (!extra.empty()) {
+        vectors[count++] = {const_cast<char*>(extra.data()), extra.size()};
+    }
+
+    iovec* current = vectors;
+    while (count > 0 && !closed) {
+        ssize_t written = writev(fd, current, count);
+        ++stats.syscalls;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EFAULT && !extra.empty()) {
+                // Only `extra` may be unreadable: drop it, but finish writing the buffered bytes
+                ++faultCount;
+                count = current == vectors && buffered > 0 ? 1 : 0;
+                continue;
+            }
+            int code = errno;
+            if (error == 0) {
+                error = code;
+                std::cerr << SOFTWARE_NAME << ": error: cannot write the output: "
+                          << std::error_code(code, std::system_category()).message() << std::endl;
+            }
+            // Nobody reads the output anymore: discard it from now on
+            closed = code == EPIPE || code == EBADF;
+            break;
+        }
+        stats.bytes += static_cast<std::uint64_t>(written);
+
+        // Skip what has been written, then retry with the rest
+        std::size_t remaining = static_cast<std::size_t>(written);
+        while (count > 0 && remaining >= current->iov_len) {
+            remaining -= current->iov_len;
+            ++current;
+            --count;
+        }
+        if (count > 0) {
+            current->iov_base = static_cast<char*>(current->iov_base) + remaining;
+            current->iov_len -= remaining;
+        }
+    }
+    buffered = 0;
+}
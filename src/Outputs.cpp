@@ -11,12 +11,20 @@
  */
 
 #include "globals.h"
+#include "ClassificationCache.h"
+#include "Classifier.h"
+#include "HexDumper.h"
+#include "HexEncoder.h"
+#include "OutputWriter.h"
 #include "Outputs.h"
+#include "Profiler.h"
+#include <cstdint>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <cstdlib>
 
 /**
@@ -64,18 +72,50 @@ std::string Outputs::capitalize(const std::string& str) {
  * @brief Converts a string to its hexadecimal representation.
  * 
  * This function converts each character of the string to its hexadecimal value,
- * with each byte formatted as two hexadecimal digits.
+ * with each byte formatted as two hexadecimal digits followed by a space.
  *
  * @param content The string to convert to hexadecimal.
  * @return A string containing the hexadecimal representation of the input string.
  */
-std::string Outputs::convertToHex(const std::string& content) {
-    std::ostringstream hexStream;
-    hexStream << std::hex << std::setfill('0');
-    for (unsigned char c : content) {
-        hexStream << std::setw(2) << static_cast<int>(c) << ' ';
-    }
-    return hexStream.str();
+std::string Outputs::convertToHex(std::string_view content) {
+    std::string hexContent;
+    convertToHex(content, hexContent);
+    return hexContent;
+}
+
+/**
+ * @brief Converts a string to its hexadecimal representation into an existing buffer.
+ * 
+ * The buffer is resized to the exact output size and filled by the `HexEncoder`, which uses
+ * the fastest kernel available on the CPU. Reusing the same buffer across calls avoids an
+ * allocation per conversion.
+ *
+ * @param content The string to convert to hexadecimal.
+ * @param hexContent Receives the hexadecimal representation, replacing its previous content.
+ */
+void Outputs::convertToHex(std::string_view content, std::string& hexContent) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Hex);
+    hexContent.resize(HexEncoder::encodedSize(content.size()));
+    HexEncoder::encode(content, hexContent.data());
+}
+
+/**
+ * @brief Converts a string to canonical hexdump rows.
+ * 
+ * The rows are produced by a `HexDumper`, which uses the fastest kernel available on the CPU.
+ * Offsets start at the given one, so a preview shows the offsets of its bytes in the file.
+ *
+ * @param content The string to convert.
+ * @param offset The offset of the first byte of `content` in its file.
+ * @return A string containing the rows and the final offset.
+ */
+std::string Outputs::convertToHexDump(std::string_view content, std::uint64_t offset) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Hex);
+    std::string rows;
+    HexDumper dumper(offset);
+    dumper.dump(content, rows);
+    dumper.finish(rows);
+    return rows;
 }
 
 /**
@@ -85,52 +125,272 @@ std::string Outputs::convertToHex(const std::string& content) {
  * The file path is shown with different color coding for folders and the file itself.
  * The content is printed in gray.
  *
- * @param baseDir The base directory to compute relative paths.
- * @param filePath The full path to the file to display.
+ * @param relativePath The path of the file relative to the explored directory.
  * @param content The content of the file to display.
+ * @param duplicates The other files with the same content, listed under the path.
+ */
+void Outputs::displayFileContent(std::string_view relativePath, std::string_view content,
+                                  const std::vector<std::string>& duplicates) {
+    displayFileHeader(relativePath, duplicates);
+    displayContentChunk(content);
+    displayFileFooter();
+}
+
+/**
+ * @brief Displays part of the content of a file, with markers for the bytes left out.
+ * 
+ * The marker of the skipped bytes is a line of its own before the content; the marker of the
+ * remaining bytes starts on a new line after the content, and the footer ends it.
+ *
+ * @param relativePath The path of the file relative to the explored directory.
+ * @param content The displayed part of the content.
+ * @param skippedBefore The number of bytes of the file before `content`.
+ * @param skippedAfter The number of bytes of the file after `content`.
+ * @param duplicates The other files with the same content, listed under the path.
  */
-void Outputs::displayFileContent(const std::filesystem::path& baseDir,
-                                  const std::filesystem::path& filePath,
-                                  const std::string& content) {
-    // Compute relative path from baseDir
-    std::filesystem::path relativePath = std::filesystem::relative(filePath, baseDir);
-    std::string pathStr = relativePath.string() + ":";
+void Outputs::displayFilePreview(std::string_view relativePath,
+                                  std::string_view content,
+                                  std::uint64_t skippedBefore,
+                                  std::uint64_t skippedAfter,
+                                  const std::vector<std::string>& duplicates) {
+    OutputWriter& writer = OutputWriter::standardOutput();
+    displayFileHeader(relativePath, duplicates);
+    if (skippedBefore > 0) {
+        writer.write("\033[33m[... " + std::to_string(skippedBefore) + (skippedBefore == 1 ? " byte" : " bytes")
+                     + " skipped]\033[90m\n");
+    }
+    displayContentChunk(content);
+    if (skippedAfter > 0) {
+        bool newLine = content.empty() || content.back() == '\n';
+        writer.write((newLine ? "" : "\n") + std::string("\033[33m[... ") + std::to_string(skippedAfter)
+                     + (skippedAfter == 1 ? " more byte]" : " more bytes]"));
+    }
+    displayFileFooter();
+}
 
-    // Line length for the top and bottom separators
+/**
+ * @brief Displays the header introducing the content of a file.
+ * 
+ * This function displays the relative path of the file between two separator lines, then
+ * switches the output to gray for the content that follows. The whole header is built in one
+ * reusable string and handed to the output writer at once.
+ *
+ * The relative path is supplied by the caller, which cuts it from the path of the walk, so no
+ * path is normalized or allocated per file. With `--dedupe`, the other files holding the same
+ * content are listed in gray under the path, each after an equal sign.
+ *
+ * @param relativePath The path of the file relative to the explored directory.
+ * @param duplicates The other files with the same content, listed under the path.
+ */
+void Outputs::displayFileHeader(std::string_view relativePath, const std::vector<std::string>& duplicates) {
+    // Line length for the top and bottom separators, which cover the path and its colon
     const int minEquals = 20;
-    int lineLength = std::max(minEquals, static_cast<int>(pathStr.length()));
+    int lineLength = std::max(minEquals, static_cast<int>(relativePath.length() + 1));
+    for (const std::string& duplicate : duplicates) {
+        lineLength = std::max(lineLength, static_cast<int>(duplicate.length() + 2));
+    }
+
+    thread_local std::string header;
+    header.clear();
 
-    // Display top line separator
-    std::cout << "\033[1m" << std::string(lineLength, '=') << "\033[0m" << std::endl;
+    // Top line separator
+    header.append("\033[1m").append(lineLength, '=').append("\033[0m\n");
 
-    // Display the path with color formatting
-    std::cout << "\033[1m"; // Enable bold style
-    size_t lastSlashPos = pathStr.find_last_of("/\\");  // Find last slash (path separator)
+    // The path with color formatting
+    header.append("\033[1m"); // Enable bold style
+    size_t lastSlashPos = relativePath.find_last_of("/\\");  // Find last slash (path separator)
 
     if (lastSlashPos == std::string::npos) {
         // If no slash is found, treat as a file at root level
-        std::cout << "\033[37m" << pathStr << "\033[0m" << std::endl;  // Print in white
+        header.append("\033[37m").append(relativePath).append(":\033[0m\n");  // White
     } else {
         // Colorize path with different colors for folders and file
-        for (size_t i = 0; i < pathStr.length(); ++i) {
-            if (pathStr[i] == '/' || pathStr[i] == '\\') {
-                std::cout << "\033[32m" << pathStr[i] << "\033[37m";  // Green for '/'
+        for (size_t i = 0; i < relativePath.length(); ++i) {
+            if (relativePath[i] == '/' || relativePath[i] == '\\') {
+                header.append("\033[32m").append(1, relativePath[i]).append("\033[37m");  // Green for '/'
             } else {
                 if (i > lastSlashPos) {
-                    std::cout << "\033[37m" << pathStr[i];  // White for the file
+                    header.append("\033[37m").append(1, relativePath[i]);  // White for the file
                 } else {
-                    std::cout << "\033[90m" << pathStr[i] << "\033[37m";  // Gray for folders
+                    header.append("\033[90m").append(1, relativePath[i]).append("\033[37m");  // Gray for folders
                 }
             }
         }
-        std::cout << "\033[0m" << std::endl; // Reset color and style
+        header.append("\033[37m:\033[0m\n"); // White colon, then reset color and style
+    }
+
+    // The files with the same content
+    for (const std::string& duplicate : duplicates) {
+        header.append("\033[90m= ").append(duplicate).append("\033[0m\n");
     }
 
-    // Display bottom line separator
-    std::cout << "\033[1m" << std::string(lineLength, '=') << "\033[0m" << std::endl;
+    // Bottom line separator
+    header.append("\033[1m").append(lineLength, '=').append("\033[0m\n");
 
-    // Display the file content in gray
-    std::cout << "\033[90m" << content << "\033[0m" << std::endl << std::endl;
+    // The file content is displayed in gray
+    header.append("\033[90m");
+
+    OutputWriter::standardOutput().write(header);
+}
+
+/**
+ * @brief Displays a piece of the content of a file.
+ * 
+ * This function writes the content as is; it must be called between `displayFileHeader` and
+ * `displayFileFooter`, once for the whole content or once per chunk.
+ *
+ * @param content The piece of content to display.
+ */
+void Outputs::displayContentChunk(std::string_view content) {
+    OutputWriter::standardOutput().write(content);
+}
+
+/**
+ * @brief Displays the end of the content of a file.
+ * 
+ * This function resets the color, leaves an empty line after the content, and marks the file
+ * boundary, where the output writer may flush.
+ */
+void Outputs::displayFileFooter() {
+    OutputWriter& writer = OutputWriter::standardOutput();
+    writer.write("\033[0m\n\n");
+    writer.endFile();
+}
+
+/**
+ * @brief Appends a line matching the searched pattern, preceded by its line number.
+ * 
+ * The line number is written in green, then the color goes back to the gray of the content.
+ * The structured output formats get the line number and the line without colors.
+ *
+ * @param output The buffer receiving the formatted line.
+ * @param lineNumber The number of the line, starting at 1.
+ * @param line The content of the line, without its newline.
+ */
+void Outputs::appendMatchingLine(std::string& output, std::size_t lineNumber, std::string_view line) {
+    if (Configuration::outputFormat != OutputFormat::Text) {
+        output.append(std::to_string(lineNumber)).append(1, ':').append(line).append(1, '\n');
+        return;
+    }
+    output.append("\033[32m").append(std::to_string(lineNumber)).append(":\033[90m").append(line).append(1, '\n');
+}
+
+/**
+ * @brief Displays the statistics of the output writer on the standard error stream.
+ * 
+ * This function flushes the output first, then reports how many bytes were written, in how many
+ * pieces and with how many system calls, and how many calls the batching saved compared with
+ * one write per piece.
+ */
+void Outputs::displayOutputStatistics() {
+    OutputWriter& writer = OutputWriter::standardOutput();
+    writer.flush();
+
+    const OutputWriter::Statistics& stats = writer.statistics();
+    std::uint64_t saved = stats.segments > stats.syscalls ? stats.segments - stats.syscalls : 0;
+    std::cerr << SOFTWARE_NAME << ": stats: output: " << stats.bytes << " bytes, "
+              << stats.segments << " pieces, " << stats.syscalls << " write calls, "
+              << saved << " calls saved" << std::endl;
+}
+
+/**
+ * @brief Displays the classification statistics on the standard error stream.
+ * 
+ * This function reports how many files the in-process sniffer decided as text or binary, how
+ * many were guessed (in `fast` mode) and how many were handed to libmagic.
+ */
+void Outputs::displayClassifierStatistics() {
+    Classifier::Statistics stats = Classifier::statistics();
+    std::cerr << SOFTWARE_NAME << ": stats: classifier: " << stats.sniffedText << " sniffed as text, "
+              << stats.sniffedBinary << " sniffed as binary, " << stats.guessed << " guessed, "
+              << stats.magic << " by libmagic" << std::endl;
+}
+
+/**
+ * @brief Displays the statistics of the classification cache on the standard error stream.
+ * 
+ * This function reports the cache hits and misses of the run, the results added to the cache,
+ * and whether the cache file was compacted. Nothing is displayed when the cache is disabled.
+ */
+void Outputs::displayCacheStatistics() {
+    if (!Configuration::useCache) {
+        return;
+    }
+    ClassificationCache::Statistics stats = ClassificationCache::statistics();
+    std::cerr << SOFTWARE_NAME << ": stats: cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+              << stats.stored << " stored" << (stats.compacted ? ", compacted" : "") << std::endl;
+}
+
+/**
+ * @brief Displays the profile of the run on the standard error stream.
+ * 
+ * This function flushes the standard output first, so that the final write is part of the
+ * profile. Stage times are summed over all threads and may therefore exceed the wall time.
+ * Memory-mapped content is read lazily: the page faults are part of the stage that first
+ * touches the content (usually sniffing or hexadecimal conversion), not of the read stage.
+ */
+void Outputs::displayProfileStatistics() {
+    OutputWriter& writer = OutputWriter::standardOutput();
+    writer.flush();
+    Profiler::Report report = Profiler::report();
+    const OutputWriter::Statistics& output = writer.statistics();
+    auto counter = [&report](Profiler::Counter counter) { return report.counters[static_cast<std::size_t>(counter)]; };
+
+    // Format in a separate stream to leave the flags of std::cerr untouched
+    std::ostringstream stats;
+    stats << std::fixed << std::setprecision(3);
+    stats << SOFTWARE_NAME << ": stats: files: " << counter(Profiler::Counter::FilesVisited) << " visited, "
+          << counter(Profiler::Counter::FilesDisplayed) << " displayed\n";
+    stats << SOFTWARE_NAME << ": stats: bytes: " << counter(Profiler::Counter::BytesRead) << " read, "
+          << output.bytes << " emitted\n";
+    stats << SOFTWARE_NAME << ": stats: syscalls: " << counter(Profiler::Counter::ReadCalls) << " read, "
+          << output.syscalls << " write\n";
+    stats << SOFTWARE_NAME << ": stats: time:";
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Profiler::Stage::Count); ++i) {
+        stats << ' ' << Profiler::stageName(static_cast<Profiler::Stage>(i)) << ' ' << report.stageSeconds[i] * 1e3 << " ms,";
+    }
+    stats << " wall " << report.wallSeconds * 1e3 << " ms\n";
+    stats << SOFTWARE_NAME << ": stats: latency: p50 " << report.latencyP50 * 1e6 << " us, p99 "
+          << report.latencyP99 * 1e6 << " us over " << report.latencySamples << " files\n";
+    std::cerr << stats.str() << std::flush;
+}
+
+/**
+ * @brief Displays all statistics as a single JSON object on the standard error stream.
+ * 
+ * The object holds the same figures as the text report, under stable keys, so that runs can be
+ * compared by tools. Times are in seconds.
+ */
+void Outputs::displayStatisticsJson() {
+    OutputWriter& writer = OutputWriter::standardOutput();
+    writer.flush();
+    Profiler::Report report = Profiler::report();
+    const OutputWriter::Statistics& output = writer.statistics();
+    Classifier::Statistics classifier = Classifier::statistics();
+    ClassificationCache::Statistics cache = ClassificationCache::statistics();
+
+    std::ostringstream stats;
+    stats << std::setprecision(9);
+    stats << "{\"output\":{\"bytes\":" << output.bytes << ",\"pieces\":" << output.segments
+          << ",\"writeCalls\":" << output.syscalls << "}";
+    stats << ",\"classifier\":{\"sniffedText\":" << classifier.sniffedText << ",\"sniffedBinary\":"
+          << classifier.sniffedBinary << ",\"guessed\":" << classifier.guessed << ",\"libmagic\":" << classifier.magic << "}";
+    stats << ",\"cache\":{\"enabled\":" << (Configuration::useCache ? "true" : "false") << ",\"hits\":" << cache.hits
+          << ",\"misses\":" << cache.misses << ",\"stored\":" << cache.stored
+          << ",\"compacted\":" << (cache.compacted ? "true" : "false") << "}";
+    stats << ",\"counters\":{";
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Profiler::Counter::Count); ++i) {
+        stats << (i == 0 ? "" : ",") << '"' << Profiler::counterName(static_cast<Profiler::Counter>(i)) << "\":" << report.counters[i];
+    }
+    stats << "},\"stages\":{";
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Profiler::Stage::Count); ++i) {
+        stats << (i == 0 ? "" : ",") << '"' << Profiler::stageName(static_cast<Profiler::Stage>(i)) << "\":{\"seconds\":"
+              << report.stageSeconds[i] << ",\"calls\":" << report.stageCalls[i] << "}";
+    }
+    stats << "},\"wallSeconds\":" << report.wallSeconds;
+    stats << ",\"latency\":{\"files\":" << report.latencySamples << ",\"p50Seconds\":" << report.latencyP50
+          << ",\"p99Seconds\":" << report.latencyP99 << "}}\n";
+    std::cerr << stats.str() << std::flush;
 }
 
 /**
@@ -166,6 +426,42 @@ void Outputs::displayHelp() {
               << "  -b         Show binary files" << std::endl
               << "  -a         Show binary and hidden files" << std::endl
               << "  -c         Clear the previous terminal outputs" << std::endl
+              << "  -j N       Use N threads to walk directories (default: one per CPU)" << std::endl
+              << "  -z         Display gzip, xz and bzip2 files decompressed" << std::endl
+              << "  --stats[=text|json]" << std::endl
+              << "             Report statistics and per-stage timings on the standard error stream" << std::endl
+              << "  --classifier=fast|magic|hybrid" << std::endl
+              << "             Classify files in-process, with libmagic, or both (default: hybrid)" << std::endl
+              << "  --grep=PATTERN" << std::endl
+              << "             Only display the lines matching a regular expression, and the files holding them" << std::endl
+              << "  --fixed-strings" << std::endl
+              << "             Search the pattern of --grep as a literal string" << std::endl
+              << "  --ignore-case" << std::endl
+              << "             Search the pattern of --grep regardless of the case of letters" << std::endl
+              << "  --no-ignore" << std::endl
+              << "             Do not skip the files listed in .gitignore and .ignore files" << std::endl
+              << "  --exclude=GLOB" << std::endl
+              << "             Skip the files and directories matching GLOB (repeatable)" << std::endl
+              << "  --include=GLOB" << std::endl
+              << "             Only display the files matching GLOB (repeatable)" << std::endl
+              << "  --watch    Keep running and display the files again when they are created or modified" << std::endl
+              << "  --format=text|jsonl|nul|raw" << std::endl
+              << "             Write colored text, JSON lines, NUL-separated or length-prefixed records (default: text)" << std::endl
+              << "  --binary-encoding=base64|hex" << std::endl
+              << "             Encode binary content in base64 or hexadecimal with --format=jsonl|nul (default: base64)" << std::endl
+              << "  --hex-style=plain|canonical" << std::endl
+              << "             Display binary files as one line of bytes or as offset rows like hexdump -C (default: plain)" << std::endl
+              << "  --max-bytes=N" << std::endl
+              << "             Display at most N bytes of each file" << std::endl
+              << "  --head=N   Display the first N lines of each file" << std::endl
+              << "  --tail=N   Display the last N lines of each file" << std::endl
+              << "  --io=threads|uring" << std::endl
+              << "             Read small files on the worker threads or in io_uring batches (default: threads)" << std::endl
+              << "  --dedupe   Display files with the same content once, listing the other paths" << std::endl
+              << "  --archives Explore tar, tar.gz, tar.xz, tar.bz2 and zip archives like directories" << std::endl
+              << "  --no-cache Do not use the classification cache" << std::endl
+              << "  --clear-cache" << std::endl
+              << "             Delete the classification cache before exploring" << std::endl
               << "  --version  Show program version" << std::endl
               << "  --help     Show this help message" << std::endl
               << "  --credits  Show the credits" << std::endl;
@@ -0,0 +1,194 @@
+/**
+ * @file Profiler.cpp
+ * @headerfile Profiler.h
+ * @brief This file contains the implementation of the Profiler class.
+ *
+ * Each thread owns a block of counters, registered in a global list the first time the thread
+ * records something and kept after the thread exits, so the figures of the pool workers are
+ * still there when the report is built. Recording only touches the block of the calling thread.
+ *
+ * Per-file latencies go to a log-linear histogram: 16 linear buckets per power of two, which
+ * bounds the error of the percentiles to about 6% with a fixed, small amount of memory.
+ */
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Profiler.h"
+
+namespace {
+
+constexpr std::size_t stageCount = static_cast<std::size_t>(Profiler::Stage::Count);
+constexpr std::size_t counterCount = static_cast<std::size_t>(Profiler::Counter::Count);
+constexpr unsigned subBucketBits = 4;
+constexpr std::size_t bucketCount = (64 - subBucketBits + 1) << subBucketBits;
+
+/**
+ * @struct ThreadFigures
+ * @brief The figures recorded by one thread.
+ */
+struct ThreadFigures {
+    std::uint64_t stageNanoseconds[stageCount] = {};
+    std::uint64_t stageCalls[stageCount] = {};
+    std::uint64_t counters[counterCount] = {};
+    std::uint64_t latencyBuckets[bucketCount] = {};
+};
+
+std::mutex registryMutex;                               ///< Protects `registry`.
+std::vector<std::unique_ptr<ThreadFigures>> registry;   ///< The figures of every thread that recorded something.
+std::chrono::steady_clock::time_point startTime;        ///< Set by `enable`.
+
+/**
+ * @brief Returns the figures of the calling thread, registering them on first use.
+ */
+ThreadFigures& threadFigures() {
+    thread_local ThreadFigures* figures = [] {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(std::make_unique<ThreadFigures>());
+        return registry.back().get();
+    }();
+    return *figures;
+}
+
+/**
+ * @brief Returns the histogram bucket of a value in nanoseconds.
+ */
+std::size_t bucketOf(std::uint64_t value) {
+    if (value < (1u << subBucketBits)) {
+        return static_cast<std::size_t>(value);
+    }
+    unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));
+    std::uint64_t subBucket = (value >> (exponent - subBucketBits)) & ((1u << subBucketBits) - 1);
+    return ((exponent - subBucketBits + 1) << subBucketBits) + static_cast<std::size_t>(subBucket);
+}
+
+/**
+ * @brief Returns the middle of the range of values of a bucket, in nanoseconds.
+ */
+double bucketValue(std::size_t bucket) {
+    if (bucket < (1u << subBucketBits)) {
+        return static_cast<double>(bucket);
+    }
+    unsigned exponent = static_cast<unsigned>(bucket >> subBucketBits) + subBucketBits - 1;
+    std::uint64_t subBucket = bucket & ((1u << subBucketBits) - 1);
+    double width = static_cast<double>(std::uint64_t{1} << (exponent - subBucketBits));
+    return static_cast<double>((std::uint64_t{1} << exponent) + subBucket * (std::uint64_t{1} << (exponent - subBucketBits))) + width / 2;
+}
+
+/**
+ * @brief Returns the value below which a fraction of the samples of a histogram fall, in seconds.
+ */
+double percentile(const std::vector<std::uint64_t>& buckets, std::uint64_t samples, double fraction) {
+    std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(samples - 1));
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < bucketCount; ++bucket) {
+        seen += buckets[bucket];
+        if (seen > rank) {
+            return bucketValue(bucket) / 1e9;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+bool Profiler::enabled = false;
+
+/**
+ * @brief Enables profiling and starts the wall clock.
+ */
+void Profiler::enable() {
+    enabled = true;
+    startTime = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Adds the time of a timed scope to a stage of the calling thread.
+ */
+void Profiler::addTime(Stage stage, std::chrono::steady_clock::duration elapsed) {
+    ThreadFigures& figures = threadFigures();
+    std::size_t index = static_cast<std::size_t>(stage);
+    figures.stageNanoseconds[index] += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    ++figures.stageCalls[index];
+}
+
+/**
+ * @brief Adds to a counter of the calling thread.
+ */
+void Profiler::addCount(Counter counter, std::uint64_t amount) {
+    threadFigures().counters[static_cast<std::size_t>(counter)] += amount;
+}
+
+/**
+ * @brief Records the latency of one file in the histogram of the calling thread.
+ */
+void Profiler::addLatency(std::chrono::steady_clock::duration latency) {
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    ++threadFigures().latencyBuckets[bucketOf(static_cast<std::uint64_t>(nanoseconds < 0 ? 0 : nanoseconds))];
+}
+
+/**
+ * @brief Merges the figures of all threads.
+ *
+ * @return The merged figures, with the per-file latency percentiles.
+ */
+Profiler::Report Profiler::report() {
+    Report report;
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - startTime;
+    report.wallSeconds = wall.count();
+
+    std::vector<std::uint64_t> latencyBuckets(bucketCount);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& figures : registry) {
+        for (std::size_t i = 0; i < stageCount; ++i) {
+            report.stageSeconds[i] += static_cast<double>(figures->stageNanoseconds[i]) / 1e9;
+            report.stageCalls[i] += figures->stageCalls[i];
+        }
+        for (std::size_t i = 0; i < counterCount; ++i) {
+            report.counters[i] += figures->counters[i];
+        }
+        for (std::size_t i = 0; i < bucketCount; ++i) {
+            latencyBuckets[i] += figures->latencyBuckets[i];
+            report.latencySamples += figures->latencyBuckets[i];
+        }
+    }
+    if (report.latencySamples > 0) {
+        report.latencyP50 = percentile(latencyBuckets, report.latencySamples, 0.50);
+        report.latencyP99 = percentile(latencyBuckets, report.latencySamples, 0.99);
+    }
+    return report;
+}
+
+/**
+ * @brief Returns the name of a stage, as used in the report.
+ */
+const char* Profiler::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Traversal: return "traversal";
+        case Stage::Sniff: return "sniff";
+        case Stage::Libmagic: return "libmagic";
+        case Stage::Read: return "read";
+        case Stage::Hex: return "hex";
+        case Stage::Write: return "write";
+        case Stage::Search: return "search";
+        case Stage::Encode: return "encode";
+        case Stage::Hash: return "hash";
+        case Stage::Decompress: return "decompress";
+        case Stage::Count: break;
+    }
+    return "";
+}
+
+/**
+ * @brief Returns the name of a counter, as used in the report.
+ */
+const char* Profiler::counterName(Counter counter) {
+    switch (counter) {
+        case Counter::FilesVisited: return "filesVisited";
+        case Counter::FilesDisplayed: return "filesDisplayed";
+        case Counter::BytesRead: return "bytesRead";
+        case Counter::ReadCalls: return "readCalls";
+        case Counter::Count: break;
+    }
+    return "";
+}
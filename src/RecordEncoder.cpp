@@ -0,0 +1,458 @@
+/**
+ * @file RecordEncoder.cpp
+ * @headerfile RecordEncoder.h
+ * @brief This file contains the implementation of the RecordEncoder class.
+ *
+ * Every encoder reserves room for the worst-case expansion of a block of content in the buffer
+ * of the output writer (six bytes per input byte for JSON escapes, four per three for base64,
+ * three per byte for hexadecimal), encodes the block in place, and commits the bytes actually
+ * produced. The JSON escaper copies runs of plain ASCII bytes at once and only looks closely at
+ * control characters, quotes, backslashes and non-ASCII bytes, which it validates as UTF-8.
+ */
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include "globals.h"
+#include "HexEncoder.h"
+#include "OutputWriter.h"
+#include "Profiler.h"
+#include "RecordEncoder.h"
+
+namespace {
+
+/**
+ * @enum ByteClass
+ * @brief How the JSON escaper handles a byte of text content.
+ */
+enum ByteClass : std::uint8_t {
+    Plain,   ///< Copied as is.
+    Escaped, ///< A control character, a quote or a backslash, written as an escape sequence.
+    Unicode, ///< The start or the continuation of a multibyte UTF-8 sequence, validated first.
+};
+
+/**
+ * @brief Lookup table mapping each byte to its class for the JSON escaper.
+ */
+constexpr std::array<ByteClass, 256> makeByteClassTable() {
+    std::array<ByteClass, 256> table{};
+    for (std::size_t byte = 0; byte < 256; ++byte) {
+        if (byte < 0x20 || byte == '"' || byte == '\\') {
+            table[byte] = Escaped;
+        } else if (byte >= 0x80) {
+            table[byte] = Unicode;
+        } else {
+            table[byte] = Plain;
+        }
+    }
+    return table;
+}
+
+constexpr auto byteClassTable = makeByteClassTable();
+
+constexpr char hexDigits[] = "0123456789abcdef";
+constexpr char base64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * @brief Returns the length of the valid UTF-8 sequence starting at `input`.
+ *
+ * @param input The bytes, starting with a non-ASCII byte.
+ * @param size The number of bytes available.
+ * @return The length of the sequence, 0 if it is invalid, or -1 if it is valid so far but cut
+ *         by the end of the input.
+ */
+int utf8SequenceLength(const unsigned char* input, std::size_t size) {
+    unsigned char lead = input[0];
+    int length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    // The ranges of the second byte exclude overlong forms, surrogates and values above U+10FFFF
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        low = lead == 0xe0 ? 0xa0 : 0x80;
+        high = lead == 0xed ? 0x9f : 0xbf;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        low = lead == 0xf0 ? 0x90 : 0x80;
+        high = lead == 0xf4 ? 0x8f : 0xbf;
+    } else {
+        return 0;
+    }
+    for (int i = 1; i < length; ++i) {
+        if (static_cast<std::size_t>(i) >= size) {
+            return -1;
+        }
+        unsigned char byte = input[i];
+        if (byte < low || byte > high) {
+            return 0;
+        }
+        low = 0x80;
+        high = 0xbf;
+    }
+    return length;
+}
+
+/**
+ * @brief Escapes text as the body of a JSON string.
+ *
+ * @param input The text.
+ * @param size The number of bytes of the text.
+ * @param final Whether an incomplete UTF-8 sequence at the end is escaped rather than left over.
+ * @param output The destination, at least `6 * size` bytes long.
+ * @param written Receives the number of bytes written.
+ * @return The number of bytes consumed: `size`, unless an incomplete sequence is left over.
+ */
+std::size_t escapeJsonText(const unsigned char* input, std::size_t size, bool final, char* output, std::size_t& written) {
+    char* out = output;
+    std::size_t i = 0;
+    while (i < size) {
+        // Copy the run of plain bytes at once
+        std::size_t run = i;
+        while (run < size && byteClassTable[input[run]] == Plain) {
+            ++run;
+        }
+        std::memcpy(out, input + i, run - i);
+        out += run - i;
+        i = run;
+        if (i == size) {
+            break;
+        }
+
+        unsigned char byte = input[i];
+        if (byteClassTable[byte] == Escaped) {
+            *out++ = '\\';
+            switch (byte) {
+                case '"': *out++ = '"'; break;
+                case '\\': *out++ = '\\'; break;
+                case '\b': *out++ = 'b'; break;
+                case '\f': *out++ = 'f'; break;
+                case '\n': *out++ = 'n'; break;
+                case '\r': *out++ = 'r'; break;
+                case '\t': *out++ = 't'; break;
+                default:
+                    out = std::copy_n("u00", 3, out);
+                    *out++ = hexDigits[byte >> 4];
+                    *out++ = hexDigits[byte & 0x0f];
+            }
+            ++i;
+            continue;
+        }
+
+        int length = utf8SequenceLength(input + i, size - i);
+        if (length < 0 && !final) {
+            // Wait for the rest of the sequence
+            break;
+        }
+        if (length > 0) {
+            out = std::copy_n(input + i, length, out);
+            i += static_cast<std::size_t>(length);
+        } else {
+            // Keep the invalid byte as a lone low surrogate, as Python's `surrogateescape` does
+            out = std::copy_n("\\udc", 4, out);
+            *out++ = hexDigits[byte >> 4];
+            *out++ = hexDigits[byte & 0x0f];
+            ++i;
+        }
+    }
+    written = static_cast<std::size_t>(out - output);
+    return i;
+}
+
+/**
+ * @brief Encodes whole groups of three bytes in base64.
+ *
+ * @param input The bytes; their number must be a multiple of three.
+ * @param size The number of bytes.
+ * @param output The destination, at least `RecordEncoder::base64Size(size)` bytes long.
+ */
+void encodeBase64Groups(const unsigned char* input, std::size_t size, char* output) {
+    for (std::size_t i = 0; i < size; i += 3) {
+        std::uint32_t group = (std::uint32_t(input[i]) << 16) | (std::uint32_t(input[i + 1]) << 8) | input[i + 2];
+        output[0] = base64Digits[group >> 18];
+        output[1] = base64Digits[(group >> 12) & 0x3f];
+        output[2] = base64Digits[(group >> 6) & 0x3f];
+        output[3] = base64Digits[group & 0x3f];
+        output += 4;
+    }
+}
+
+/**
+ * @brief Encodes the last one or two bytes of some content in base64, with padding.
+ *
+ * @param input The bytes.
+ * @param size The number of bytes, 1 or 2.
+ * @param output The destination, 4 bytes long.
+ */
+void encodeBase64Tail(const unsigned char* input, std::size_t size, char* output) {
+    std::uint32_t group = std::uint32_t(input[0]) << 16;
+    if (size == 2) {
+        group |= std::uint32_t(input[1]) << 8;
+    }
+    output[0] = base64Digits[group >> 18];
+    output[1] = base64Digits[(group >> 12) & 0x3f];
+    output[2] = size == 2 ? base64Digits[(group >> 6) & 0x3f] : '=';
+    output[3] = '=';
+}
+
+/**
+ * @brief Writes a number in decimal, formatted on the stack.
+ */
+void writeNumber(OutputWriter& writer, std::uint64_t value) {
+    char digits[20];
+    char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    writer.write(std::string_view(digits, static_cast<std::size_t>(end - digits)));
+}
+
+/**
+ * @brief Returns the name of the encoding of the content of a record, as written in `jsonl`.
+ */
+const char* encodingName(bool encoded) {
+    if (!encoded) {
+        return "utf8";
+    }
+    return Configuration::binaryEncoding == BinaryEncoding::Hex ? "hex" : "base64";
+}
+
+} // namespace
+
+/**
+ * @brief Constructs an encoder writing the format of `Configuration::outputFormat`.
+ *
+ * @param writer The writer receiving the records.
+ */
+RecordEncoder::RecordEncoder(OutputWriter& writer) : writer(writer) {}
+
+/**
+ * @brief Starts a record.
+ *
+ * The description of the file is written with literal pieces and numbers formatted on the stack;
+ * the path is escaped like text content in `jsonl`.
+ *
+ * @param record The description of the file.
+ */
+void RecordEncoder::begin(const Record& record) {
+    encoded = record.encoded;
+    remaining = record.contentSize;
+    pendingSize = 0;
+
+    switch (Configuration::outputFormat) {
+        case OutputFormat::Jsonl:
+            writer.write("{\"path\":\"");
+            escapeJson(record.path, true);
+            writer.write("\",\"size\":");
+            writeNumber(writer, record.size);
+            if (record.truncated > 0) {
+                writer.write(",\"offset\":");
+                writeNumber(writer, record.offset);
+                writer.write(",\"truncated\":");
+                writeNumber(writer, record.truncated);
+            }
+            if (record.duplicates != nullptr && !record.duplicates->empty()) {
+                writer.write(",\"duplicates\":[");
+                for (std::size_t i = 0; i < record.duplicates->size(); ++i) {
+                    writer.write(i == 0 ? "\"" : ",\"");
+                    escapeJson((*record.duplicates)[i], true);
+                    writer.write("\"");
+                }
+                writer.write("]");
+            }
+            writer.write(record.isBinary ? ",\"type\":\"binary\",\"encoding\":\"" : ",\"type\":\"text\",\"encoding\":\"");
+            writer.write(encodingName(encoded));
+            writer.write("\",\"content\":\"");
+            break;
+        case OutputFormat::Nul:
+            writer.write(record.path);
+            writer.write(std::string_view("\0", 1));
+            break;
+        case OutputFormat::Raw:
+            writer.write(record.isBinary ? "binary " : "text ");
+            writeNumber(writer, record.contentSize);
+            writer.write(" ");
+            writeNumber(writer, record.path.size());
+            writer.write("\n");
+            writer.write(record.path);
+            writer.write("\n");
+            break;
+        case OutputFormat::Text:
+            break;
+    }
+}
+
+/**
+ * @brief Writes a piece of the content of the current record.
+ *
+ * @param content The next bytes of the content.
+ */
+void RecordEncoder::write(std::string_view content) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Encode);
+    if (Configuration::outputFormat == OutputFormat::Raw) {
+        writeRaw(content);
+    } else if (encoded) {
+        encodeBinary(content, false);
+    } else if (Configuration::outputFormat == OutputFormat::Jsonl) {
+        escapeJson(content, false);
+    } else {
+        writer.write(content);
+    }
+}
+
+/**
+ * @brief Ends the current record, marking a file boundary for the writer.
+ *
+ * The bytes kept back are encoded first: the last base64 group is padded, and the bytes of an
+ * incomplete UTF-8 sequence are escaped one by one. A raw record whose file shrank while it was
+ * read is padded with NUL bytes up to the announced size.
+ */
+void RecordEncoder::end() {
+    switch (Configuration::outputFormat) {
+        case OutputFormat::Jsonl:
+            if (encoded) {
+                encodeBinary({}, true);
+            } else {
+                escapeJson({}, true);
+            }
+            writer.write("\"}\n");
+            break;
+        case OutputFormat::Nul:
+            if (encoded) {
+                encodeBinary({}, true);
+            }
+            writer.write(std::string_view("\0", 1));
+            break;
+        case OutputFormat::Raw:
+            while (remaining > 0) {
+                std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, blockSize));
+                std::memset(writer.reserve(size), 0, size);
+                writer.commit(size);
+                remaining -= size;
+            }
+            writer.write("\n");
+            break;
+        case OutputFormat::Text:
+            break;
+    }
+    writer.endFile();
+}
+
+/**
+ * @brief Escapes text content as the body of a JSON string.
+ *
+ * A UTF-8 sequence left incomplete by the previous call is completed with the first bytes of
+ * `content` and escaped on its own; the rest is escaped block by block, straight into the writer.
+ *
+ * @param content The content; an incomplete UTF-8 sequence at its end is kept for the next call.
+ * @param final Whether no content follows, so incomplete sequences are escaped byte by byte.
+ */
+void RecordEncoder::escapeJson(std::string_view content, bool final) {
+    const auto* input = reinterpret_cast<const unsigned char*>(content.data());
+    std::size_t size = content.size();
+    std::size_t written = 0;
+
+    if (pendingSize > 0) {
+        // Join the kept bytes with enough new ones to complete the sequence
+        unsigned char joined[sizeof(pending) + 3];
+        std::memcpy(joined, pending, pendingSize);
+        std::size_t taken = std::min<std::size_t>(size, 3);
+        std::memcpy(joined + pendingSize, input, taken);
+        std::size_t joinedSize = pendingSize + taken;
+        std::size_t consumed = escapeJsonText(joined, joinedSize, final && taken == size,
+                                              writer.reserve(6 * joinedSize), written);
+        writer.commit(written);
+        if (consumed < pendingSize) {
+            // Still incomplete: every new byte was taken
+            pendingSize = joinedSize - consumed;
+            std::memmove(pending, joined + consumed, pendingSize);
+            return;
+        }
+        input += consumed - pendingSize;
+        size -= consumed - pendingSize;
+        pendingSize = 0;
+    }
+
+    while (size > 0) {
+        std::size_t block = std::min(size, blockSize);
+        bool last = block == size;
+        std::size_t consumed = escapeJsonText(input, block, last && final, writer.reserve(6 * block), written);
+        writer.commit(written);
+        input += consumed;
+        size -= consumed;
+        if (last && consumed < block) {
+            // Keep the start of a sequence completed by the next call
+            pendingSize = block - consumed;
+            std::memcpy(pending, input, pendingSize);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Encodes binary content in the selected binary encoding.
+ *
+ * Hexadecimal content is converted by the `HexEncoder` block by block. Base64 content is encoded
+ * by groups of three bytes; the one or two bytes left over are kept until more content arrives.
+ *
+ * @param content The content; the bytes left over from a base64 group are kept for the next call.
+ * @param final Whether no content follows, so the last group is padded.
+ */
+void RecordEncoder::encodeBinary(std::string_view content, bool final) {
+    if (Configuration::binaryEncoding == BinaryEncoding::Hex) {
+        for (std::size_t offset = 0; offset < content.size(); offset += blockSize) {
+            std::string_view block = content.substr(offset, blockSize);
+            std::size_t size = HexEncoder::encodedSize(block.size());
+            HexEncoder::encode(block, writer.reserve(size));
+            writer.commit(size);
+        }
+        return;
+    }
+
+    const auto* input = reinterpret_cast<const unsigned char*>(content.data());
+    std::size_t size = content.size();
+    if (pendingSize > 0) {
+        // Complete the group started by the previous call
+        std::size_t taken = std::min(size, 3 - pendingSize);
+        std::memcpy(pending + pendingSize, input, taken);
+        pendingSize += taken;
+        input += taken;
+        size -= taken;
+        if (pendingSize == 3) {
+            encodeBase64Groups(reinterpret_cast<const unsigned char*>(pending), 3, writer.reserve(4));
+            writer.commit(4);
+            pendingSize = 0;
+        }
+    }
+
+    // Blocks of whole groups, a multiple of three bytes long
+    constexpr std::size_t groupBlock = blockSize / 3 * 3;
+    while (size >= 3) {
+        std::size_t block = std::min(size / 3 * 3, groupBlock);
+        encodeBase64Groups(input, block, writer.reserve(base64Size(block)));
+        writer.commit(base64Size(block));
+        input += block;
+        size -= block;
+    }
+    if (size > 0) {
+        std::memcpy(pending + pendingSize, input, size);
+        pendingSize += size;
+    }
+
+    if (final && pendingSize > 0) {
+        encodeBase64Tail(reinterpret_cast<const unsigned char*>(pending), pendingSize, writer.reserve(4));
+        writer.commit(4);
+        pendingSize = 0;
+    }
+}
+
+/**
+ * @brief Writes the content of a raw record, up to the announced size.
+ *
+ * The content is handed to the writer as is, so large pieces are written without being copied.
+ * Bytes beyond the announced size (a file that grew while it was read) are dropped.
+ */
+void RecordEncoder::writeRaw(std::string_view content) {
+    std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, content.size()));
+    writer.write(content.substr(0, size));
+    remaining -= size;
+}
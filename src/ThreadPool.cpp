@@ -0,0 +1,170 @@
+/**
+ * @file ThreadPool.cpp
+ * @headerfile ThreadPool.h
+ * @brief This file contains the implementation of the ThreadPool class.
+ *
+ * The ThreadPool class runs tasks on a fixed set of worker threads. Each worker owns a task
+ * queue; a worker pushes and pops tasks at the back of its own queue and, when it runs out of
+ * work, steals from the front of the queues of the other workers.
+ */
+
+#include <exception>
+#include <iostream>
+#include "globals.h"
+#include "ThreadPool.h"
+
+namespace {
+
+thread_local const ThreadPool* currentPool = nullptr; ///< The pool owning the calling thread, if any.
+thread_local unsigned currentWorker = 0;              ///< The worker index of the calling thread.
+
+} // namespace
+
+/**
+ * @brief Resolves a requested thread count, mapping `0` to the number of hardware threads.
+ *
+ * @param threadCount The requested thread count.
+ * @return The effective thread count, at least 1.
+ */
+unsigned ThreadPool::resolveThreadCount(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    return threadCount == 0 ? 1 : threadCount;
+}
+
+/**
+ * @brief Constructs a ThreadPool and starts its worker threads.
+ *
+ * @param threadCount The number of worker threads. `0` uses the number of hardware threads.
+ */
+ThreadPool::ThreadPool(unsigned threadCount) {
+    threadCount = resolveThreadCount(threadCount);
+
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+/**
+ * @brief Waits for all pending tasks to complete and joins the worker threads.
+ */
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief Schedules a task for execution on one of the worker threads.
+ *
+ * A worker of this pool pushes the task on its own queue; other threads spread their tasks
+ * over the workers in round-robin order.
+ *
+ * @param task The task to run.
+ */
+void ThreadPool::submit(std::function<void()> task) {
+    unsigned index = (currentPool == this)
+        ? currentWorker
+        : nextWorker.fetch_add(1, std::memory_order_relaxed) % size();
+
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+
+    // Taking the state lock orders this wake-up after any worker that is about to sleep
+    { std::lock_guard<std::mutex> lock(stateMutex); }
+    workAvailable.notify_one();
+}
+
+/**
+ * @brief Blocks until every submitted task has completed.
+ */
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return pending.load() == 0; });
+}
+
+/**
+ * @brief Takes a task from the worker's own queue, or steals one from another worker.
+ *
+ * The worker's own queue is used as a stack (newest task first), which keeps the working set
+ * small; stolen tasks are taken from the other end (oldest task first), which tends to hand
+ * over the largest pieces of remaining work.
+ *
+ * @param index The index of the worker looking for a task.
+ * @param task Receives the task.
+ * @return `true` if a task was found, otherwise `false`.
+ */
+bool ThreadPool::takeTask(unsigned index, std::function<void()>& task) {
+    {
+        Worker& own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    for (unsigned offset = 1; offset < size(); ++offset) {
+        Worker& victim = *workers[(index + offset) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Main loop of a worker thread.
+ *
+ * The worker runs tasks until the pool is stopped, sleeping whenever every queue is empty.
+ *
+ * @param index The index of the worker in `workers`.
+ */
+void ThreadPool::run(unsigned index) {
+    currentPool = this;
+    currentWorker = index;
+
+    std::function<void()> task;
+    while (true) {
+        if (takeTask(index, task)) {
+            try {
+                task();
+            } catch (const std::exception& e) {
+                std::cerr << SOFTWARE_NAME << ": error: " << e.what() << " in worker thread" << std::endl;
+            }
+            task = nullptr;
+
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        workAvailable.wait(lock, [this] { return queued.load() > 0 || stopping; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
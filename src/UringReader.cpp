@@ -0,0 +1,289 @@
+/**
+ * @file UringReader.cpp
+ * @headerfile UringReader.h
+ * @brief This file contains the implementation of the UringReader class.
+ *
+ * The ring is set up and driven with the raw `io_uring_setup`, `io_uring_register` and
+ * `io_uring_enter` system calls, so no library is needed. A batch takes two submissions: one
+ * `statx` per file, then, for every small regular file, an `openat` into a registered descriptor
+ * slot, a `read` of its whole size and a `close`, linked so that they run in order. The links are
+ * hard links, so the slot is closed even when the read fails.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <system_error>
+#include <unistd.h>
+#include "globals.h"
+#include "Profiler.h"
+#include "UringReader.h"
+
+namespace {
+
+/**
+ * @brief Operations of the entries of a load, stored in the low bits of their user data.
+ */
+enum Operation : std::uint64_t { Open = 0, Read = 1, Close = 2 };
+
+/**
+ * @brief Loads a value shared with the kernel, ordered after the writes that produced it.
+ */
+unsigned loadAcquire(const unsigned* value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Stores a value shared with the kernel, ordered after the writes it publishes.
+ */
+void storeRelease(unsigned* value, unsigned newValue) {
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Converts the status read by `statx` to a `struct stat`, for the fields the program uses.
+ */
+void toStat(const struct statx& status, struct stat& info) {
+    info = {};
+    info.st_dev = makedev(status.stx_dev_major, status.stx_dev_minor);
+    info.st_ino = static_cast<ino_t>(status.stx_ino);
+    info.st_mode = status.stx_mode;
+    info.st_nlink = status.stx_nlink;
+    info.st_size = static_cast<off_t>(status.stx_size);
+    info.st_mtim.tv_sec = status.stx_mtime.tv_sec;
+    info.st_mtim.tv_nsec = status.stx_mtime.tv_nsec;
+}
+
+} // namespace
+
+/**
+ * @brief Creates the io_uring instance and its table of registered descriptors.
+ *
+ * The rings hold four entries per request, enough for the three linked entries of a load. The
+ * descriptor table has one empty slot per request; every load reuses the slots from the start,
+ * since all the files of the previous batch are closed by then.
+ *
+ * @param batchSize The largest number of requests in a batch.
+ * @throw std::system_error If io_uring is not available.
+ */
+UringReader::UringReader(std::size_t batchSize)
+    : batchSize(std::max<std::size_t>(1, std::min(batchSize, maxBatchSize))), statusBuffers(this->batchSize) {
+    io_uring_params params{};
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(4 * this->batchSize), &params));
+    if (ringFd < 0) {
+        throw std::system_error(errno, std::system_category(), "cannot set io_uring up");
+    }
+
+    // Map the rings; recent kernels share one mapping for both
+    submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    std::size_t completionSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping) {
+        submissionRingSize = std::max(submissionRingSize, completionSize);
+    }
+    entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    submissionRing = mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (submissionRing == MAP_FAILED) {
+        int error = errno;
+        submissionRing = nullptr;
+        close(ringFd);
+        throw std::system_error(error, std::system_category(), "cannot map the io_uring submission ring");
+    }
+    completionRing = submissionRing;
+    if (!singleMapping) {
+        completionRingSize = completionSize;
+        completionRing = mmap(nullptr, completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    }
+    void* entriesMapping = completionRing == MAP_FAILED ? MAP_FAILED
+                           : mmap(nullptr, entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+
+    // Start with an empty slot per request in the table of registered descriptors
+    std::vector<int> slots(this->batchSize, -1);
+    if (entriesMapping == MAP_FAILED
+        || syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_FILES, slots.data(), static_cast<unsigned>(slots.size())) < 0) {
+        int error = errno;
+        if (entriesMapping != MAP_FAILED) {
+            munmap(entriesMapping, entriesSize);
+        }
+        if (completionRingSize > 0 && completionRing != MAP_FAILED) {
+            munmap(completionRing, completionRingSize);
+        }
+        munmap(submissionRing, submissionRingSize);
+        close(ringFd);
+        throw std::system_error(error, std::system_category(), "cannot set the io_uring descriptors up");
+    }
+    entries = static_cast<io_uring_sqe*>(entriesMapping);
+
+    char* submission = static_cast<char*>(submissionRing);
+    submissionTail = reinterpret_cast<unsigned*>(submission + params.sq_off.tail);
+    submissionArray = reinterpret_cast<unsigned*>(submission + params.sq_off.array);
+    submissionMask = *reinterpret_cast<unsigned*>(submission + params.sq_off.ring_mask);
+    queuedTail = *submissionTail;
+    char* completion = static_cast<char*>(completionRing);
+    completionHead = reinterpret_cast<unsigned*>(completion + params.cq_off.head);
+    completionTail = reinterpret_cast<unsigned*>(completion + params.cq_off.tail);
+    completionMask = *reinterpret_cast<unsigned*>(completion + params.cq_off.ring_mask);
+    completionEntries = reinterpret_cast<io_uring_cqe*>(completion + params.cq_off.cqes);
+}
+
+/**
+ * @brief Releases the io_uring instance.
+ */
+UringReader::~UringReader() {
+    munmap(entries, entriesSize);
+    if (completionRingSize > 0) {
+        munmap(completionRing, completionRingSize);
+    }
+    munmap(submissionRing, submissionRingSize);
+    close(ringFd);
+}
+
+/**
+ * @brief Reads the status of every file of a batch.
+ *
+ * Files whose status cannot be read are left with `statted` unset.
+ *
+ * @param requests The requests of the batch, at most `batchSize`.
+ * @throw std::system_error If the ring cannot be used anymore.
+ */
+void UringReader::stat(std::vector<Request>& requests) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Read);
+    unsigned count = 0;
+    for (std::size_t i = 0; i < requests.size() && i < batchSize; ++i) {
+        io_uring_sqe* entry = nextEntry();
+        entry->opcode = IORING_OP_STATX;
+        entry->fd = AT_FDCWD;
+        entry->addr = reinterpret_cast<std::uintptr_t>(requests[i].path->c_str());
+        entry->len = STATX_BASIC_STATS;
+        entry->off = reinterpret_cast<std::uintptr_t>(&statusBuffers[i]);
+        entry->user_data = i;
+        ++count;
+    }
+    submit(count);
+
+    for (const auto& [index, result] : completions) {
+        Request& request = requests[index];
+        request.statted = result == 0;
+        if (request.statted) {
+            toStat(statusBuffers[index], request.info);
+        }
+    }
+}
+
+/**
+ * @brief Reads the content of the wanted regular files of a batch up to `maxFileSize` bytes.
+ *
+ * Empty files are left to the caller too, since special files often report a size of zero.
+ *
+ * @param requests The requests of the batch, with their status read.
+ * @throw std::system_error If the ring cannot be used anymore.
+ */
+void UringReader::load(std::vector<Request>& requests) {
+    Profiler::ScopedTimer timer(Profiler::Stage::Read);
+    unsigned count = 0;
+    unsigned slot = 0;
+    for (std::size_t i = 0; i < requests.size() && i < batchSize; ++i) {
+        Request& request = requests[i];
+        if (!request.wanted || !request.statted || !S_ISREG(request.info.st_mode) || request.info.st_size <= 0
+            || static_cast<std::uint64_t>(request.info.st_size) > maxFileSize) {
+            continue;
+        }
+        request.content.resize(static_cast<std::size_t>(request.info.st_size));
+
+        // Open into the slot, read the whole file, close the slot, in this order
+        io_uring_sqe* entry = nextEntry();
+        entry->opcode = IORING_OP_OPENAT;
+        entry->flags = IOSQE_IO_HARDLINK;
+        entry->fd = AT_FDCWD;
+        entry->addr = reinterpret_cast<std::uintptr_t>(request.path->c_str());
+        entry->open_flags = O_RDONLY;
+        entry->file_index = slot + 1;
+        entry->user_data = (i << 2) | Open;
+
+        entry = nextEntry();
+        entry->opcode = IORING_OP_READ;
+        entry->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+        entry->fd = static_cast<int>(slot);
+        entry->addr = reinterpret_cast<std::uintptr_t>(request.content.data());
+        entry->len = static_cast<unsigned>(request.content.size());
+        entry->user_data = (i << 2) | Read;
+
+        entry = nextEntry();
+        entry->opcode = IORING_OP_CLOSE;
+        entry->file_index = slot + 1;
+        entry->user_data = (i << 2) | Close;
+
+        count += 3;
+        ++slot;
+    }
+    if (count == 0) {
+        return;
+    }
+    submit(count);
+
+    for (const auto& [data, result] : completions) {
+        if ((data & 3) != Read) {
+            continue;
+        }
+        Request& request = requests[data >> 2];
+        // A short read means that the file changed since its status was read
+        request.loaded = result >= 0 && static_cast<std::size_t>(result) == request.content.size();
+        if (request.loaded) {
+            Profiler::count(Profiler::Counter::BytesRead, request.content.size());
+        } else {
+            request.content = std::string();
+        }
+    }
+}
+
+/**
+ * @brief Returns a cleared submission queue entry at the tail of the queue.
+ *
+ * The entry is only seen by the kernel once `submit` publishes the new tail.
+ */
+io_uring_sqe* UringReader::nextEntry() {
+    unsigned index = queuedTail & submissionMask;
+    io_uring_sqe* entry = &entries[index];
+    *entry = {};
+    submissionArray[index] = index;
+    ++queuedTail;
+    return entry;
+}
+
+/**
+ * @brief Submits the queued entries and waits for all their completions.
+ *
+ * `io_uring_enter` is called until every entry is consumed and completed; the completions are
+ * reaped into `completions` as they arrive. Each call counts as one read system call.
+ *
+ * @param count The number of queued entries.
+ * @throw std::system_error If the submission fails.
+ */
+void UringReader::submit(unsigned count) {
+    completions.clear();
+    storeRelease(submissionTail, queuedTail);
+    unsigned submitted = 0;
+    while (completions.size() < count) {
+        unsigned waited = count - static_cast<unsigned>(completions.size());
+        long result = syscall(__NR_io_uring_enter, ringFd, count - submitted, waited, IORING_ENTER_GETEVENTS, nullptr, 0);
+        Profiler::count(Profiler::Counter::ReadCalls);
+        if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            throw std::system_error(errno, std::system_category(), "cannot submit to io_uring");
+        }
+        if (result > 0) {
+            submitted += static_cast<unsigned>(result);
+        }
+
+        unsigned head = *completionHead;
+        unsigned tail = loadAcquire(completionTail);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& completion = completionEntries[head & completionMask];
+            completions.emplace_back(completion.user_data, completion.res);
+        }
+        storeRelease(completionHead, head);
+    }
+}
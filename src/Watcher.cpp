@@ -0,0 +1,372 @@
+/**
+ * @file Watcher.cpp
+ * @headerfile Watcher.h
+ * @brief This file contains the implementation of the Watcher class.
+ *
+ * Files are reported when they are closed after being written (`IN_CLOSE_WRITE`) or moved into a
+ * watched directory (`IN_MOVED_TO`), so a file is displayed once its content is complete rather
+ * than at every write. Changes to ignore files, directories moved away and queue overflows
+ * invalidate the watch table, which is then rebuilt by walking the trees again. `SIGINT` and
+ * `SIGTERM` are caught while watching and end the run, so the program can exit normally.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include "globals.h"
+#include "FileExplorer.h"
+#include "OutputWriter.h"
+#include "Outputs.h"
+#include "ThreadPool.h"
+#include "Watcher.h"
+
+namespace {
+
+constexpr std::uint32_t directoryEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MOVE_SELF | IN_DELETE_SELF | IN_ONLYDIR;
+
+/**
+ * @brief Joins the relative path of a directory and an entry name; the root has an empty relative path.
+ */
+std::string joinRelativePath(const std::string& directory, const std::string& name) {
+    return directory.empty() ? name : directory + '/' + name;
+}
+
+/**
+ * @brief Checks whether a path still names a regular file.
+ */
+bool isRegularFile(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+int interruptWriteFd = -1;               ///< The end of the interrupt pipe written by the signal handler.
+struct sigaction previousInterruptAction; ///< The `SIGINT` action replaced by the watcher.
+struct sigaction previousTerminateAction; ///< The `SIGTERM` action replaced by the watcher.
+
+/**
+ * @brief Wakes the watcher up when it is asked to stop. A second signal kills the program.
+ */
+void handleInterrupt(int) {
+    int savedErrno = errno;
+    char byte = 0;
+    [[maybe_unused]] ssize_t written = write(interruptWriteFd, &byte, 1);
+    errno = savedErrno;
+}
+
+} // namespace
+
+/**
+ * @brief Creates the inotify instance and catches `SIGINT` and `SIGTERM`.
+ *
+ * The signals are written to a pipe polled with the inotify instance, so they end `run` instead
+ * of the program. The handler is reset when it runs, so a second signal kills the program even
+ * while a long update is displayed.
+ *
+ * The directories are resolved as `FileExplorer` resolves them, so a directory reached twice,
+ * through a symbolic link or as a nested root, gets a single watch owned by a single tree. The
+ * pool and the explorer are kept for the whole run, so a burst of events starts no threads.
+ *
+ * @param roots The directories to watch.
+ * @param matcher The pattern searched in the files, or `nullptr`.
+ * @throw std::system_error If inotify or the pipe cannot be initialized.
+ */
+Watcher::Watcher(const std::vector<std::string>& roots, const Matcher* matcher)
+    : roots(FileExplorer::resolveRoots(roots)), filter(!Configuration::showHiddenFiles, true),
+      explorer(this->roots, matcher), pool(Configuration::threadCount), inotifyFd(inotify_init1(IN_CLOEXEC)) {
+    if (inotifyFd < 0) {
+        throw std::system_error(errno, std::system_category(), "cannot initialize inotify");
+    }
+    int interruptPipe[2];
+    if (pipe2(interruptPipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+        std::error_code error(errno, std::system_category());
+        close(inotifyFd);
+        throw std::system_error(error, "cannot create the interrupt pipe");
+    }
+    interruptFd = interruptPipe[0];
+    interruptWriteFd = interruptPipe[1];
+
+    struct sigaction action = {};
+    action.sa_handler = handleInterrupt;
+    action.sa_flags = SA_RESETHAND | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &previousInterruptAction);
+    sigaction(SIGTERM, &action, &previousTerminateAction);
+}
+
+/**
+ * @brief Restores the signal actions and closes the inotify instance, which drops all the watches.
+ */
+Watcher::~Watcher() {
+    sigaction(SIGINT, &previousInterruptAction, nullptr);
+    sigaction(SIGTERM, &previousTerminateAction, nullptr);
+    close(interruptWriteFd);
+    interruptWriteFd = -1;
+    close(interruptFd);
+    close(inotifyFd);
+}
+
+/**
+ * @brief Displays the trees, then displays the changed files as they change, until interrupted.
+ *
+ * The trees are walked once, adding a watch on every directory read, and their files are
+ * displayed. Then each burst of events displays the files it changed, tree by tree, in path
+ * order, through a single pipeline; the trees without changes are skipped. The run ends on
+ * `SIGINT` or `SIGTERM`; the changes of an unfinished burst are not displayed.
+ *
+ * @param clearTerminal Whether the terminal is cleared before the changed files are displayed.
+ * @throw std::system_error If reading the events fails.
+ */
+void Watcher::run(bool clearTerminal) {
+    Changes changes(roots.size());
+    rescan(&changes);
+
+    bool initial = true;
+    while (true) {
+        bool changed = std::any_of(changes.begin(), changes.end(), [](const auto& files) { return !files.empty(); });
+        if (changed) {
+            if (clearTerminal && !initial) {
+                Outputs::clear();
+            }
+            std::vector<std::pair<std::string, std::size_t>> files;
+            for (std::size_t root = 0; root < roots.size(); ++root) {
+                for (const std::string& file : changes[root]) {
+                    // Skip the files removed since the event
+                    if (isRegularFile(file)) {
+                        files.emplace_back(file, root);
+                    }
+                }
+                changes[root].clear();
+            }
+            explorer.exploreFiles(pool, files);
+            OutputWriter::standardOutput().flush();
+        }
+        initial = false;
+
+        bool rescanNeeded = waitForChanges(changes);
+        if (interrupted) {
+            return;
+        }
+        if (rescanNeeded) {
+            rescan(nullptr);
+        }
+    }
+}
+
+/**
+ * @brief Adds a watch on a directory.
+ *
+ * @param root The index of the tree of the directory.
+ * @param path The path of the directory.
+ * @param relativePath The path of the directory relative to the root of its tree.
+ * @param rules The ignore rules in force for its entries.
+ */
+void Watcher::addWatch(std::size_t root, const std::string& path, const std::string& relativePath,
+                       const std::shared_ptr<const IgnoreRules>& rules) {
+    int watch = inotify_add_watch(inotifyFd, path.c_str(), directoryEvents);
+    if (watch < 0) {
+        std::error_code error(errno, std::system_category());
+        std::cerr << std::string(SOFTWARE_NAME) + ": error: cannot watch directory `" + path + "`: "
+                   + error.message() + "\n" << std::flush;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(directoriesMutex);
+    directories[watch] = Directory{root, path, relativePath, rules};
+}
+
+/**
+ * @brief Walks and watches every tree from scratch.
+ *
+ * The previous watches are removed first, so directories that left the trees are no longer watched.
+ * The files are not classified here: the binary ones are left out when they are displayed.
+ *
+ * @param changes Receives every file of the trees, or `nullptr`.
+ */
+void Watcher::rescan(Changes* changes) {
+    for (const auto& [watch, directory] : directories) {
+        inotify_rm_watch(inotifyFd, watch);
+    }
+    directories.clear();
+
+    for (std::size_t root = 0; root < roots.size(); ++root) {
+        DirectoryWalker walker(pool, roots[root].path, walkFilter(root),
+                               [this, root](const std::string& path, const std::string& relativePath,
+                                            const std::shared_ptr<const IgnoreRules>& rules) {
+                                   addWatch(root, path, relativePath, rules);
+                               });
+        std::string path;
+        while (walker.next(path)) {
+            if (changes != nullptr) {
+                (*changes)[root].insert(path);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Walks and watches a directory that appeared in a watched directory.
+ *
+ * The directory is walked with the ignore rules of its parent, and all its files are reported as
+ * changed, since files may have been written to it before its watch was added.
+ *
+ * @param parent The watched directory holding it.
+ * @param name The name of the new directory.
+ * @param changes Receives the files of the new directory.
+ */
+void Watcher::watchNewDirectory(const Directory& parent, const std::string& name, Changes& changes) {
+    std::string relativePath = joinRelativePath(parent.relativePath, name);
+    if ((filter.skipHidden && name[0] == '.') || filter.isFiltered(parent.rules.get(), relativePath, true)) {
+        return;
+    }
+    std::size_t root = parent.root;
+    DirectoryWalker walker(pool, (std::filesystem::path(parent.path) / name).string(), walkFilter(root),
+                           [this, root](const std::string& path, const std::string& relative,
+                                        const std::shared_ptr<const IgnoreRules>& rules) {
+                               addWatch(root, path, relative, rules);
+                           },
+                           relativePath, parent.rules);
+    std::string filePath;
+    while (walker.next(filePath)) {
+        changes[root].insert(filePath);
+    }
+}
+
+/**
+ * @brief Builds the filter of the walks of a tree.
+ *
+ * @param root The index of the tree.
+ * @return The common filter, which also skips the trees nested in this one.
+ */
+DirectoryWalker::Filter Watcher::walkFilter(std::size_t root) const {
+    DirectoryWalker::Filter rootFilter = filter;
+    rootFilter.skippedDirectories = roots[root].nestedDirectories;
+    return rootFilter;
+}
+
+/**
+ * @brief Blocks until a burst of events is over, and records the changes it brought.
+ *
+ * The first `poll` blocks without a timeout. Once an event has arrived, events are read until
+ * none arrives for `debounceWindow`, or until `maxDelay` has passed since the first one. A
+ * signal written to the interrupt pipe sets `interrupted` and ends the wait at once.
+ *
+ * @param changes Receives the changed files.
+ * @return `true` if the trees must be walked again.
+ * @throw std::system_error If reading the events fails.
+ */
+bool Watcher::waitForChanges(Changes& changes) {
+    alignas(inotify_event) char buffer[64 * 1024];
+    pollfd descriptors[] = {{inotifyFd, POLLIN, 0}, {interruptFd, POLLIN, 0}};
+    bool rescanNeeded = false;
+    bool waiting = true;
+    std::chrono::steady_clock::time_point firstEvent;
+
+    while (true) {
+        int timeout = -1;
+        if (!waiting) {
+            auto left = maxDelay - std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - firstEvent);
+            if (left.count() <= 0) {
+                break;
+            }
+            timeout = static_cast<int>(std::min(left, debounceWindow).count());
+        }
+        int ready = poll(descriptors, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category(), "cannot wait for inotify events");
+        }
+        if (ready == 0) {
+            // Quiet for a whole window: the burst is over
+            break;
+        }
+        if (descriptors[1].revents & POLLIN) {
+            interrupted = true;
+            break;
+        }
+
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category(), "cannot read inotify events");
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            rescanNeeded |= handleEvent(*event, changes);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+        if (waiting) {
+            waiting = false;
+            firstEvent = std::chrono::steady_clock::now();
+        }
+    }
+    return rescanNeeded;
+}
+
+/**
+ * @brief Records the change described by one event.
+ *
+ * Files are filtered with the ignore rules of their directory, as during the walk. New
+ * directories are walked and watched. A queue overflow reports every file of the trees.
+ *
+ * @param event The event.
+ * @param changes Receives the changed files.
+ * @return `true` if the trees must be walked again.
+ */
+bool Watcher::handleEvent(const inotify_event& event, Changes& changes) {
+    if (event.mask & IN_Q_OVERFLOW) {
+        // Events were lost: display everything again
+        rescan(&changes);
+        return false;
+    }
+    if (event.mask & IN_IGNORED) {
+        directories.erase(event.wd);
+        return false;
+    }
+    auto found = directories.find(event.wd);
+    if (found == directories.end()) {
+        return false;
+    }
+    if (event.mask & (IN_MOVE_SELF | IN_DELETE_SELF)) {
+        // The paths below the directory are stale
+        return (event.mask & IN_MOVE_SELF) != 0;
+    }
+    if (event.len == 0) {
+        return false;
+    }
+
+    const Directory directory = found->second;
+    std::string name = event.name;
+    if (event.mask & IN_ISDIR) {
+        if (event.mask & (IN_CREATE | IN_MOVED_TO)) {
+            watchNewDirectory(directory, name, changes);
+        }
+        return false;
+    }
+    if (!(event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO))) {
+        return false;
+    }
+    if (filter.useIgnoreFiles && std::any_of(std::begin(IgnoreRules::fileNames), std::end(IgnoreRules::fileNames),
+                                             [&name](const char* fileName) { return name == fileName; })) {
+        // The rules changed: rebuild the watch table with the new rules
+        return true;
+    }
+    if ((filter.skipHidden && name[0] == '.')
+        || filter.isFiltered(directory.rules.get(), joinRelativePath(directory.relativePath, name), false)) {
+        return false;
+    }
+    changes[directory.root].insert((std::filesystem::path(directory.path) / name).string());
+    return false;
+}
@@ -28,3 +28,132 @@ bool Configuration::showBinaryFiles = false;
  * will not be shown.
  */
 bool Configuration::showHiddenFiles = false;
+
+/**
+ * @brief Static member variable to control the number of worker threads.
+ * 
+ * This variable determines how many threads are used to walk directories concurrently.
+ * By default, it is set to 0, meaning one thread per hardware thread.
+ */
+unsigned Configuration::threadCount = 0;
+
+/**
+ * @brief Static member variable to control the statistics report.
+ * 
+ * This variable determines whether statistics about the run are printed at exit.
+ * By default, it is set to false.
+ */
+bool Configuration::showStats = false;
+
+/**
+ * @brief Static member variable to select the format of the statistics report.
+ * 
+ * By default, it is set to `StatsFormat::Text`.
+ */
+StatsFormat Configuration::statsFormat = StatsFormat::Text;
+
+/**
+ * @brief Static member variable to select how file contents are classified.
+ * 
+ * By default, it is set to `ClassifierMode::Hybrid`: files are sniffed in-process and only the
+ * ambiguous ones are handed to libmagic.
+ */
+ClassifierMode Configuration::classifierMode = ClassifierMode::Hybrid;
+
+/**
+ * @brief Static member variable to control the persistent classification cache.
+ * 
+ * By default, it is set to true: results are remembered between runs.
+ */
+bool Configuration::useCache = true;
+
+/**
+ * @brief Static member variable to control the ignore files.
+ * 
+ * By default, it is set to true: `.gitignore` and `.ignore` files are honoured.
+ */
+bool Configuration::useIgnoreFiles = true;
+
+/**
+ * @brief Static member variable listing the globs of the files and directories to exclude.
+ * 
+ * By default, it is empty.
+ */
+std::vector<std::string> Configuration::excludeGlobs;
+
+/**
+ * @brief Static member variable listing the globs of the files to display.
+ * 
+ * By default, it is empty, meaning every file is displayed.
+ */
+std::vector<std::string> Configuration::includeGlobs;
+
+/**
+ * @brief Static member variable selecting the format of the output.
+ * 
+ * By default, it is set to `OutputFormat::Text`: colored headers followed by the content.
+ */
+OutputFormat Configuration::outputFormat = OutputFormat::Text;
+
+/**
+ * @brief Static member variable selecting the encoding of binary content in structured formats.
+ * 
+ * By default, it is set to `BinaryEncoding::Base64`.
+ */
+BinaryEncoding Configuration::binaryEncoding = BinaryEncoding::Base64;
+
+/**
+ * @brief Static member variable selecting how binary content is displayed as text.
+ * 
+ * By default, it is set to `HexStyle::Plain`: a single line of hexadecimal bytes.
+ */
+HexStyle Configuration::hexStyle = HexStyle::Plain;
+
+/**
+ * @brief Static member variable limiting the number of bytes displayed per file.
+ * 
+ * By default, it is set to 0: files are displayed whole.
+ */
+std::uint64_t Configuration::maxBytes = 0;
+
+/**
+ * @brief Static member variable limiting the display to the first lines of each file.
+ * 
+ * By default, it is set to 0: files are displayed whole.
+ */
+std::uint64_t Configuration::headLines = 0;
+
+/**
+ * @brief Static member variable limiting the display to the last lines of each file.
+ * 
+ * By default, it is set to 0: files are displayed whole.
+ */
+std::uint64_t Configuration::tailLines = 0;
+
+/**
+ * @brief Static member variable selecting how the files are opened and read.
+ * 
+ * By default, it is set to `IoBackend::Threads`: every worker opens and maps its own files.
+ */
+IoBackend Configuration::ioBackend = IoBackend::Threads;
+
+/**
+ * @brief Static member variable controlling the deduplication of contents.
+ * 
+ * By default, it is set to false: every file is displayed, whatever its content.
+ */
+bool Configuration::dedupe = false;
+
+/**
+ * @brief Static member variable controlling the decompression of compressed files.
+ * 
+ * By default, it is set to false: compressed files are binary files like any other.
+ */
+bool Configuration::decompress = false;
+
+/**
+ * @brief Static member variable controlling the exploration of archives.
+ * 
+ * By default, it is set to false: archives are binary files like any other.
+ */
+bool Configuration::exploreArchives = false;
@@ -15,19 +15,53 @@
  * - `-b`: Show binary files.
  * - `-a`: Show both hidden and binary files.
  * - `-c`: Clear the terminal screen before output.
+ * - `-j N`: Use N threads to walk directories.
+ * - `-z`: Display compressed files decompressed.
+ * - `--stats[=text|json]`: Report statistics and per-stage timings on the standard error stream.
+ * - `--classifier=fast|magic|hybrid`: Select how files are classified as text or binary.
+ * - `--grep=PATTERN`: Only display the lines matching a regular expression.
+ * - `--fixed-strings`: Search the pattern of `--grep` as a literal string.
+ * - `--ignore-case`: Search the pattern of `--grep` regardless of case.
+ * - `--no-ignore`: Do not honour `.gitignore` and `.ignore` files.
+ * - `--exclude=GLOB`: Skip the files and directories matching a glob.
+ * - `--include=GLOB`: Only display the files matching a glob.
+ * - `--watch`: Display the files again whenever they are created or modified.
+ * - `--format=text|jsonl|nul|raw`: Select the format of the output.
+ * - `--binary-encoding=base64|hex`: Select how binary content is encoded by `--format`.
+ * - `--hex-style=plain|canonical`: Select how binary content is displayed as text.
+ * - `--max-bytes=N`: Display at most N bytes of each file.
+ * - `--head=N`: Display the first N lines of each file.
+ * - `--tail=N`: Display the last N lines of each file.
+ * - `--io=threads|uring`: Select how files are opened and read.
+ * - `--dedupe`: Display each distinct content once, with the paths holding it.
+ * - `--archives`: Explore tar and zip archives like directories.
+ * - `--no-cache`: Do not use the persistent classification cache.
+ * - `--clear-cache`: Delete the persistent classification cache before exploring.
  * - `--help`: Display help message.
  * - `--version`: Display software version.
  * - `--credits`: Display credits information.
  */
 
 #include "globals.h"
+#include "ClassificationCache.h"
+#include "ExtensionTable.h"
 #include "FileExplorer.h"
+#include "Matcher.h"
+#include "OutputWriter.h"
 #include "Outputs.h"
+#include "Profiler.h"
+#include "Watcher.h"
 #include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
+#include <getopt.h>
 #include <glob.h>
 #include <unistd.h>
 
@@ -56,6 +90,24 @@ std::vector<std::string> expandPath(const std::string& path) {
     return expandedPaths;
 }
 
+/**
+ * @brief Parses a positive count given to an option.
+ * 
+ * @param text The argument of the option.
+ * @param value Receives the count.
+ * @return `true` if the argument is a positive decimal number.
+ */
+bool parseCount(const char* text, std::uint64_t& value) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long count = std::strtoull(text, &end, 10);
+    if (*text == '\0' || *text == '-' || *end != '\0' || errno == ERANGE || count == 0) {
+        return false;
+    }
+    value = count;
+    return true;
+}
+
 /**
  * @brief The main entry point of the application.
  * 
@@ -81,10 +133,46 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Long options, mapped to values outside of the range of characters
+    enum LongOption { StatsOption = 256, ClassifierOption, NoCacheOption, ClearCacheOption,
+                      GrepOption, FixedStringsOption, IgnoreCaseOption,
+                      NoIgnoreOption, ExcludeOption, IncludeOption, WatchOption,
+                      FormatOption, BinaryEncodingOption, MaxBytesOption, HeadOption, TailOption,
+                      IoOption, DedupeOption, HexStyleOption, ArchivesOption };
+    const struct option longOptions[] = {
+        {"stats", optional_argument, nullptr, StatsOption},
+        {"classifier", required_argument, nullptr, ClassifierOption},
+        {"no-cache", no_argument, nullptr, NoCacheOption},
+        {"clear-cache", no_argument, nullptr, ClearCacheOption},
+        {"grep", required_argument, nullptr, GrepOption},
+        {"fixed-strings", no_argument, nullptr, FixedStringsOption},
+        {"ignore-case", no_argument, nullptr, IgnoreCaseOption},
+        {"no-ignore", no_argument, nullptr, NoIgnoreOption},
+        {"exclude", required_argument, nullptr, ExcludeOption},
+        {"include", required_argument, nullptr, IncludeOption},
+        {"watch", no_argument, nullptr, WatchOption},
+        {"format", required_argument, nullptr, FormatOption},
+        {"binary-encoding", required_argument, nullptr, BinaryEncodingOption},
+        {"max-bytes", required_argument, nullptr, MaxBytesOption},
+        {"head", required_argument, nullptr, HeadOption},
+        {"tail", required_argument, nullptr, TailOption},
+        {"io", required_argument, nullptr, IoOption},
+        {"dedupe", no_argument, nullptr, DedupeOption},
+        {"hex-style", required_argument, nullptr, HexStyleOption},
+        {"archives", no_argument, nullptr, ArchivesOption},
+        {nullptr, 0, nullptr, 0},
+    };
+
     bool clearTerminal = false;
+    bool clearCache = false;
+    bool watch = false;
+    bool searchPattern = false;
+    std::string pattern;
+    bool fixedStrings = false;
+    bool ignoreCase = false;
     int option;
     // Parse additional options with getopt
-    while ((option = getopt(argc, argv, "hbac")) != -1) {
+    while ((option = getopt_long(argc, argv, "hbacj:z", longOptions, nullptr)) != -1) {
         switch (option) {
             case 'h':
                 // Show hidden files
@@ -103,6 +191,170 @@ int main(int argc, char* argv[]) {
                 // Clear terminal screen
                 clearTerminal = true;
                 break;
+            case 'j': {
+                // Number of threads used to walk directories
+                char* end = nullptr;
+                long threads = std::strtol(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0' || threads < 1) {
+                    Outputs::displayInvalidArgument(std::string("-j ") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                Configuration::threadCount = static_cast<unsigned>(threads);
+                break;
+            }
+            case 'z':
+                // Display compressed files decompressed
+                Configuration::decompress = true;
+                break;
+            case StatsOption:
+                // Report statistics at exit, as text unless asked otherwise
+                Configuration::showStats = true;
+                if (optarg == nullptr || std::string(optarg) == "text") {
+                    Configuration::statsFormat = StatsFormat::Text;
+                } else if (std::string(optarg) == "json") {
+                    Configuration::statsFormat = StatsFormat::Json;
+                } else {
+                    Outputs::displayInvalidArgument(std::string("--stats=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                break;
+            case ClassifierOption:
+                // Select how files are classified as text or binary
+                if (std::string(optarg) == "fast") {
+                    Configuration::classifierMode = ClassifierMode::Fast;
+                } else if (std::string(optarg) == "magic") {
+                    Configuration::classifierMode = ClassifierMode::Magic;
+                } else if (std::string(optarg) == "hybrid") {
+                    Configuration::classifierMode = ClassifierMode::Hybrid;
+                } else {
+                    Outputs::displayInvalidArgument(std::string("--classifier=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                break;
+            case NoCacheOption:
+                // Classify every file again, without reading or writing the cache
+                Configuration::useCache = false;
+                break;
+            case ClearCacheOption:
+                // Invalidate every cached result
+                clearCache = true;
+                break;
+            case GrepOption:
+                // Only display the lines matching a pattern
+                searchPattern = true;
+                pattern = optarg;
+                break;
+            case FixedStringsOption:
+                fixedStrings = true;
+                break;
+            case IgnoreCaseOption:
+                ignoreCase = true;
+                break;
+            case NoIgnoreOption:
+                // Walk the files listed in ignore files too
+                Configuration::useIgnoreFiles = false;
+                break;
+            case ExcludeOption:
+                // Skip the files and directories matching a glob
+                Configuration::excludeGlobs.push_back(optarg);
+                break;
+            case IncludeOption:
+                // Only display the files matching one of the globs
+                Configuration::includeGlobs.push_back(optarg);
+                break;
+            case WatchOption:
+                // Keep running and display the files again as they change
+                watch = true;
+                break;
+            case FormatOption:
+                // Select the output format
+                if (std::string(optarg) == "text") {
+                    Configuration::outputFormat = OutputFormat::Text;
+                } else if (std::string(optarg) == "jsonl") {
+                    Configuration::outputFormat = OutputFormat::Jsonl;
+                } else if (std::string(optarg) == "nul") {
+                    Configuration::outputFormat = OutputFormat::Nul;
+                } else if (std::string(optarg) == "raw") {
+                    Configuration::outputFormat = OutputFormat::Raw;
+                } else {
+                    Outputs::displayInvalidArgument(std::string("--format=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                break;
+            case BinaryEncodingOption:
+                // Select how binary content is encoded in the structured formats
+                if (std::string(optarg) == "base64") {
+                    Configuration::binaryEncoding = BinaryEncoding::Base64;
+                } else if (std::string(optarg) == "hex") {
+                    Configuration::binaryEncoding = BinaryEncoding::Hex;
+                } else {
+                    Outputs::displayInvalidArgument(std::string("--binary-encoding=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                break;
+            case HexStyleOption:
+                // Select how binary content is displayed as text
+                if (std::string(optarg) == "plain") {
+                    Configuration::hexStyle = HexStyle::Plain;
+                } else if (std::string(optarg) == "canonical") {
+                    Configuration::hexStyle = HexStyle::Canonical;
+                } else {
+                    Outputs::displayInvalidArgument(std::string("--hex-style=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                break;
+            case MaxBytesOption:
+                // Display at most this many bytes of each file
+                if (!parseCount(optarg, Configuration::maxBytes)) {
+                    Outputs::displayInvalidArgument(std::string("--max-bytes=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                break;
+            case HeadOption:
+                // Display the first lines of each file, reading nothing past them
+                if (!parseCount(optarg, Configuration::headLines)) {
+                    Outputs::displayInvalidArgument(std::string("--head=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                Configuration::tailLines = 0;
+                break;
+            case TailOption:
+                // Display the last lines of each file, reading backwards from its end
+                if (!parseCount(optarg, Configuration::tailLines)) {
+                    Outputs::displayInvalidArgument(std::string("--tail=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                Configuration::headLines = 0;
+                break;
+            case IoOption:
+                // Select how files are opened and read
+                if (std::string(optarg) == "threads") {
+                    Configuration::ioBackend = IoBackend::Threads;
+                } else if (std::string(optarg) == "uring") {
+                    Configuration::ioBackend = IoBackend::Uring;
+                } else {
+                    Outputs::displayInvalidArgument(std::string("--io=") + optarg);
+                    Outputs::displayUsage();
+                    return 1;
+                }
+                break;
+            case DedupeOption:
+                // Display files with the same content once
+                Configuration::dedupe = true;
+                break;
+            case ArchivesOption:
+                // Explore archives like directories
+                Configuration::exploreArchives = true;
+                break;
             default:
                 // Handle invalid argument
                 Outputs::displayInvalidArgument(std::string(1, (char)option));
@@ -111,6 +363,33 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Compile the pattern once, before any file is searched
+    std::unique_ptr<Matcher> matcher;
+    if (searchPattern) {
+        try {
+            matcher = std::make_unique<Matcher>(pattern, fixedStrings, ignoreCase);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << SOFTWARE_NAME << ": error: " << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    // Start measuring before any thread is created
+    if (Configuration::showStats) {
+        Profiler::enable();
+    }
+
+    // Load the user-defined binary extensions once, before any file is classified
+    ExtensionTable::loadUserExtensions();
+
+    // Drop the cached results if asked to, then load the cache before any file is classified
+    if (clearCache && !ClassificationCache::clear()) {
+        std::cerr << SOFTWARE_NAME << ": error: cannot delete the cache `" << ClassificationCache::defaultPath() << "`" << std::endl;
+    }
+    if (Configuration::useCache) {
+        ClassificationCache::load();
+    }
+
     // Determine the directory to explore, defaulting to current directory
     std::string directory = (optind < argc) ? argv[optind] : "./";
 
@@ -122,16 +401,49 @@ int main(int argc, char* argv[]) {
         Outputs::clear();
     }
 
-    // Explore each of the expanded paths
-    for (const std::string& path : pathsToExplore) {
+    int status = 0;
+    if (watch) {
+        // In watch mode, display the paths once, then the files that change, until interrupted
         try {
-            FileExplorer explorer(path);
-            explorer.explore();  // Explore the file system at the given path
+            Watcher watcher(pathsToExplore, matcher.get());
+            watcher.run(clearTerminal);
         } catch (const std::exception& e) {
-            // Catch and display any errors during the exploration
-            std::cerr << SOFTWARE_NAME << ": error: " << e.what() << " while processing path `" << path << "`" << std::endl;
+            OutputWriter::standardOutput().flush();
+            std::cerr << SOFTWARE_NAME << ": error: " << e.what() << std::endl;
+            status = 1;
+        }
+    } else {
+        // Explore all the expanded paths, in order, with a single pipeline
+        try {
+            FileExplorer explorer(pathsToExplore, matcher.get());
+            explorer.explore();  // Explore the file system at the given paths
+        } catch (const std::exception& e) {
+            // Catch and display any errors during the exploration; with several paths, the failing one is not known
+            OutputWriter::standardOutput().flush();
+            std::cerr << SOFTWARE_NAME << ": error: " << e.what();
+            if (pathsToExplore.size() == 1) {
+                std::cerr << " while processing path `" << pathsToExplore.front() << "`";
+            }
+            std::cerr << std::endl;
         }
     }
 
-    return 0;  // Exit successfully
+    // Remember the new results for the next run
+    ClassificationCache::save();
+
+    if (Configuration::showStats && Configuration::statsFormat == StatsFormat::Json) {
+        Outputs::displayStatisticsJson();
+    } else if (Configuration::showStats) {
+        Outputs::displayOutputStatistics();
+        Outputs::displayClassifierStatistics();
+        Outputs::displayCacheStatistics();
+        Outputs::displayProfileStatistics();
+    }
+    OutputWriter::standardOutput().flush();
+
+    // Output that could not be written fails the run
+    if (OutputWriter::standardOutput().hasError()) {
+        status = 1;
+    }
+    return status;
 }